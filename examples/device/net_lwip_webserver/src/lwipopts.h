@@ -61,6 +61,10 @@
 
 #define PBUF_POOL_SIZE                  2
 
+/* received frames are passed in place by netif_tinyusb and must not be queued */
+#define TCP_QUEUE_OOSEQ                 0
+#define IP_REASSEMBLY                   0
+
 #define HTTPD_USE_CUSTOM_FSDATA         0
 
 #define LWIP_MULTICAST_PING             1
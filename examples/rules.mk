@@ -39,7 +39,8 @@ SRC_C += \
 	src/class/net/ncm_device.c \
 	src/class/usbtmc/usbtmc_device.c \
 	src/class/video/video_device.c \
-	src/class/vendor/vendor_device.c
+	src/class/vendor/vendor_device.c \
+	src/class/zero/zero_device.c
 
 # TinyUSB stack include
 INC += $(TOP)/src
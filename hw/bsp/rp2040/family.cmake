@@ -79,6 +79,7 @@ if (NOT TARGET _rp2040_family_inclusion_marker)
 			${TOP}/src/class/usbtmc/usbtmc_device.c
 			${TOP}/src/class/vendor/vendor_device.c
 			${TOP}/src/class/video/video_device.c
+			${TOP}/src/class/zero/zero_device.c
 			)
 
 	#------------------------------------
@@ -93,6 +94,7 @@ if (NOT TARGET _rp2040_family_inclusion_marker)
 			${TOP}/src/class/cdc/cdc_host.c
 			${TOP}/src/class/hid/hid_host.c
 			${TOP}/src/class/msc/msc_host.c
+			${TOP}/src/class/net/net_host.c
 			${TOP}/src/class/vendor/vendor_host.c
 			)
 
@@ -0,0 +1,184 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb.h"
+
+#include "netif_tinyusb.h"
+#include "lwip/pbuf.h"
+#include "lwip/etharp.h"
+#include "lwip/ethip6.h"
+
+#if !LWIP_SUPPORT_CUSTOM_PBUF
+#error "netif_tinyusb requires LWIP_SUPPORT_CUSTOM_PBUF"
+#endif
+
+#if ETH_PAD_SIZE
+#error "netif_tinyusb passes frames in place and requires ETH_PAD_SIZE 0"
+#endif
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+
+static struct netif *_netif;
+
+// pbuf referencing the driver receive buffer
+static struct pbuf_custom _rx_pbuf;
+
+// frame received but not yet passed to lwIP
+static struct pbuf *_rx_pending;
+
+// _rx_pbuf is referenced by lwIP
+static volatile bool _rx_busy;
+
+// set when lwIP frees the received pbuf, may be from lwIP thread
+static volatile bool _rx_released;
+
+static void rx_pbuf_free(struct pbuf *p)
+{
+  (void) p;
+  _rx_busy = false;
+  _rx_released = true;
+}
+
+static err_t linkoutput_fn(struct netif *netif, struct pbuf *p)
+{
+  (void) netif;
+
+  for (;;)
+  {
+    /* if TinyUSB isn't ready, we must signal back to lwip that there is nothing we can do */
+    if (!tud_ready()) return ERR_USE;
+
+    /* if the network driver can accept another packet, we make it happen */
+    if (tud_network_can_xmit(p->tot_len))
+    {
+      tud_network_xmit(p, 0);
+      return ERR_OK;
+    }
+
+    /* transfer execution to TinyUSB in the hopes that it will finish transmitting the prior packet */
+    tud_task();
+  }
+}
+
+//--------------------------------------------------------------------+
+// Network driver callbacks
+//--------------------------------------------------------------------+
+
+bool tud_network_recv_cb(const uint8_t *src, uint16_t size)
+{
+  // previous frame is still in use
+  if (_rx_busy || _netif == NULL || size == 0) return false;
+
+  _rx_pbuf.custom_free_function = rx_pbuf_free;
+
+  // reference driver buffer, it stays valid until tud_network_recv_renew()
+  struct pbuf *p = pbuf_alloced_custom(PBUF_RAW, size, PBUF_REF, &_rx_pbuf, (void *) (uintptr_t) src, size);
+  if (p == NULL) return false;
+
+  _rx_busy = true;
+  _rx_pending = p;
+  return true;
+}
+
+uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg)
+{
+  (void) arg;
+
+  struct pbuf *p = (struct pbuf *) ref;
+  uint16_t len = 0;
+
+  // serialise chain into transmit buffer
+  for (struct pbuf *q = p; q != NULL; q = q->next)
+  {
+    memcpy(dst + len, q->payload, q->len);
+    len = (uint16_t) (len + q->len);
+
+    if (q->len == q->tot_len) break;
+  }
+
+  return len;
+}
+
+void tud_network_init_cb(void)
+{
+  // network is re-initialized, driver has reclaimed its buffers
+  if (_rx_pending)
+  {
+    struct pbuf *p = _rx_pending;
+    _rx_pending = NULL;
+    pbuf_free(p);
+  }
+
+  _rx_released = false;
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+err_t netif_tinyusb_init(struct netif *netif)
+{
+  LWIP_ASSERT("netif != NULL", (netif != NULL));
+
+  netif->mtu = CFG_TUD_NET_MTU;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP | NETIF_FLAG_UP;
+  netif->state = NULL;
+  netif->name[0] = 'E';
+  netif->name[1] = 'X';
+  netif->linkoutput = linkoutput_fn;
+#if LWIP_IPV4
+  netif->output = etharp_output;
+#endif
+#if LWIP_IPV6
+  netif->output_ip6 = ethip6_output;
+#endif
+
+  _netif = netif;
+
+  return ERR_OK;
+}
+
+void netif_tinyusb_service(void)
+{
+  for (;;)
+  {
+    // give buffer back, driver may pass the next frame right away (e.g. next datagram of NTB)
+    if (_rx_released)
+    {
+      _rx_released = false;
+      tud_network_recv_renew();
+    }
+
+    if (_rx_pending == NULL) break;
+
+    struct pbuf *p = _rx_pending;
+    _rx_pending = NULL;
+
+    if (_netif->input(p, _netif) != ERR_OK) pbuf_free(p);
+  }
+}
@@ -0,0 +1,64 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/*
+ * lwIP network interface for the TinyUSB network class drivers (ECM/RNDIS or NCM).
+ *
+ * Received frames are passed to lwIP without copying: each one is wrapped in a
+ * pbuf_custom that references the driver receive buffer, the buffer is given back
+ * to the driver with tud_network_recv_renew() once lwIP frees the pbuf.
+ * Transmitted pbuf chains are serialised directly into the driver transmit buffer (NTB).
+ *
+ * Only one received frame is held at a time, reception pauses while lwIP keeps it.
+ * lwIP should therefore not queue received pbufs: set TCP_QUEUE_OOSEQ and IP_REASSEMBLY
+ * to 0 in lwipopts.h, otherwise reception stalls until the queued frame is released.
+ *
+ * This module implements tud_network_recv_cb(), tud_network_xmit_cb() and
+ * tud_network_init_cb(). With multiple NCM instances only instance 0 is served.
+ */
+
+#ifndef NETIF_TINYUSB_H
+#define NETIF_TINYUSB_H
+
+#include "lwip/netif.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Network interface init function, to be passed to netif_add() together with ethernet_input
+// (or tcpip_input with NO_SYS=0). Application sets netif->hwaddr and hwaddr_len before adding the interface.
+err_t netif_tinyusb_init(struct netif *netif);
+
+// Pass received frames to lwIP and return released receive buffers to the driver.
+// Must be called from the same context as tud_task(), e.g. right after it in the main loop.
+void netif_tinyusb_service(void);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* NETIF_TINYUSB_H */
@@ -277,6 +277,9 @@ typedef struct{
 	rndis_Reserved_t			Reserved;
 	}rndis_data_packet_t;
 
+/* Space of one packet message with up to _mtu bytes of data when aggregated into a transfer, 4 byte aligned */
+#define RNDIS_PACKET_MSG_SPACE(_mtu) ((sizeof(rndis_data_packet_t) + (_mtu) + 3u) & ~3u)
+
 typedef uint32_t rndis_ClassInformationOffset_t;
 typedef uint32_t rndis_Size_t;
 typedef uint32_t rndis_Type_t;
@@ -243,6 +243,9 @@ void rndis_class_set_handler(uint8_t *data, int size)
   {
     case REMOTE_NDIS_INITIALIZE_MSG:
       {
+        /* limit of transfers sent to host, read before message is overwritten by response */
+        netd_rndis_set_host_max_xfer(((rndis_initialize_msg_t *)encapsulated_buffer)->MaxTransferSize);
+
         rndis_initialize_cmplt_t *m;
         m = ((rndis_initialize_cmplt_t *)encapsulated_buffer);
         /* m->MessageID is same as before */
@@ -253,9 +256,9 @@ void rndis_class_set_handler(uint8_t *data, int size)
         m->Status = RNDIS_STATUS_SUCCESS;
         m->DeviceFlags = RNDIS_DF_CONNECTIONLESS;
         m->Medium = RNDIS_MEDIUM_802_3;
-        m->MaxPacketsPerTransfer = 1;
-        m->MaxTransferSize = CFG_TUD_NET_MTU + sizeof(rndis_data_packet_t);
-        m->PacketAlignmentFactor = 0;
+        m->MaxPacketsPerTransfer = CFG_TUD_RNDIS_PACKETS_PER_XFER;
+        m->MaxTransferSize = CFG_TUD_RNDIS_PACKETS_PER_XFER * RNDIS_PACKET_MSG_SPACE(CFG_TUD_NET_MTU);
+        m->PacketAlignmentFactor = (CFG_TUD_RNDIS_PACKETS_PER_XFER > 1) ? 2 : 0; /* 2^2 = 4 byte aligned messages */
         m->AfListOffset = 0;
         m->AfListSize = 0;
         rndis_state = rndis_initialized;
@@ -484,7 +484,7 @@ bool tud_audio_n_mounted(uint8_t func_id)
 uint16_t tud_audio_n_available(uint8_t func_id)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
-  return tu_fifo_count(&_audiod_fct[func_id].ep_out_ff);
+  return (uint16_t) tu_min32(tu_fifo_count(&_audiod_fct[func_id].ep_out_ff), UINT16_MAX);
 }
 
 uint16_t tud_audio_n_read(uint8_t func_id, void* buffer, uint16_t bufsize)
@@ -518,7 +518,7 @@ bool tud_audio_n_clear_rx_support_ff(uint8_t func_id, uint8_t ff_idx)
 uint16_t tud_audio_n_available_support_ff(uint8_t func_id, uint8_t ff_idx)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_rx_supp_ff);
-  return tu_fifo_count(&_audiod_fct[func_id].rx_supp_ff[ff_idx]);
+  return (uint16_t) tu_min32(tu_fifo_count(&_audiod_fct[func_id].rx_supp_ff[ff_idx]), UINT16_MAX);
 }
 
 uint16_t tud_audio_n_read_support_ff(uint8_t func_id, uint8_t ff_idx, void* buffer, uint16_t bufsize)
@@ -782,14 +782,13 @@ uint16_t tud_audio_n_flush_tx_support_ff(uint8_t func_id)                 // For
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
   audiod_function_t* audio = &_audiod_fct[func_id];
 
-  uint16_t n_bytes_copied = tu_fifo_count(&audio->tx_supp_ff[0]);
+  tu_fifo_idx_t n_items_copied = tu_fifo_count(&audio->tx_supp_ff[0]);
 
   TU_VERIFY(audiod_tx_done_cb(audio->rhport, audio));
 
-  n_bytes_copied -= tu_fifo_count(&audio->tx_supp_ff[0]);
-  n_bytes_copied = n_bytes_copied*audio->tx_supp_ff[0].item_size;
+  n_items_copied -= tu_fifo_count(&audio->tx_supp_ff[0]);
 
-  return n_bytes_copied;
+  return (uint16_t) tu_min32((uint32_t) n_items_copied * audio->tx_supp_ff[0].item_size, UINT16_MAX);
 }
 
 bool tud_audio_n_clear_tx_support_ff(uint8_t func_id, uint8_t ff_idx)
@@ -902,7 +901,7 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
 #else
   // No support FIFOs, if no linear buffer required schedule transmit, else put data into linear buffer and schedule
 
-  n_bytes_tx = tu_min16(tu_fifo_count(&audio->ep_in_ff), audio->ep_in_sz);      // Limit up to max packet size, more can not be done for ISO
+  n_bytes_tx = (uint16_t) tu_min32(tu_fifo_count(&audio->ep_in_ff), audio->ep_in_sz);      // Limit up to max packet size, more can not be done for ISO
 
 #if USE_LINEAR_BUFFER_TX
   tu_fifo_read_n(&audio->ep_in_ff, audio->lin_buf_in, n_bytes_tx);
@@ -1013,12 +1012,12 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
   uint8_t const n_ff_used               = audio->n_ff_used_tx;
   uint16_t const nBytesToCopy           = audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx;
   uint16_t const capPerFF               = audio->ep_in_sz / n_ff_used;                                        // Sample capacity per FIFO in bytes
-  uint16_t nBytesPerFFToSend            = tu_fifo_count(&audio->tx_supp_ff[0]);
+  uint16_t nBytesPerFFToSend            = (uint16_t) tu_min32(tu_fifo_count(&audio->tx_supp_ff[0]), capPerFF);
   uint8_t cnt_ff;
 
   for (cnt_ff = 1; cnt_ff < n_ff_used; cnt_ff++)
   {
-    uint16_t const count = tu_fifo_count(&audio->tx_supp_ff[cnt_ff]);
+    uint16_t const count = (uint16_t) tu_min32(tu_fifo_count(&audio->tx_supp_ff[cnt_ff]), capPerFF);
     if (count < nBytesPerFFToSend)
     {
       nBytesPerFFToSend = count;
@@ -1028,8 +1027,7 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
   // Check if there is enough
   if (nBytesPerFFToSend == 0)    return 0;
 
-  // Limit to maximum sample number - THIS IS A POSSIBLE ERROR SOURCE IF TOO MANY SAMPLE WOULD NEED TO BE SENT BUT CAN NOT!
-  nBytesPerFFToSend = tu_min16(nBytesPerFFToSend, capPerFF);
+  // Counts above are limited to maximum sample number - THIS IS A POSSIBLE ERROR SOURCE IF TOO MANY SAMPLE WOULD NEED TO BE SENT BUT CAN NOT!
 
   // Round to full number of samples (flooring)
   nBytesPerFFToSend = (nBytesPerFFToSend / nBytesToCopy) * nBytesToCopy;
@@ -1685,7 +1683,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             audio->feedback.frame_shift = desc_ep->bInterval -1;
 
             // Enable SOF interrupt if callback is implemented
-            if (tud_audio_feedback_interval_isr) usbd_sof_enable(rhport, true);
+            if (tud_audio_feedback_interval_isr) usbd_sof_consumer_enable(rhport, SOF_CONSUMER_AUDIO, true);
           }
 #endif
 #endif // CFG_TUD_AUDIO_ENABLE_EP_OUT
@@ -1759,7 +1757,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
       break;
     }
   }
-  if (disable) usbd_sof_enable(rhport, false);
+  if (disable) usbd_sof_consumer_enable(rhport, SOF_CONSUMER_AUDIO, false);
 #endif
 
   tud_control_status(rhport, p_request);
@@ -38,7 +38,10 @@
 //--------------------------------------------------------------------+
 enum
 {
-  BULK_PACKET_SIZE = (TUD_OPT_HIGH_SPEED ? 512 : 64)
+  BULK_PACKET_SIZE = (TUD_OPT_HIGH_SPEED ? 512 : 64),
+
+  // Largest transfer from/to FIFO, multiple of packet size
+  XFER_FIFO_MAX = 0xFE00
 };
 
 typedef struct
@@ -51,8 +54,27 @@ typedef struct
   // Bit 0:  DTR (Data Terminal Ready), Bit 1: RTS (Request to Send)
   uint8_t line_state;
 
+  // Start of data received by an OUT transfer directly into rx_ff, NULL if epout_buf is used
+  uint8_t const* rx_xfer_start;
+
+  // Framed receive: bytes of incomplete record, length prefix bytes seen and payload bytes still expected
+  uint32_t rx_rec_partial;
+  uint8_t  rx_rec_hdr_count;
+  uint16_t rx_rec_need;
+
+  // Complete records whose length did not fit into rx_rec_ff, located by scanning rx_ff when read.
+  // Written by receive and read side respectively, pending while different.
+  uint16_t rx_rec_unindexed_wr;
+  uint16_t rx_rec_unindexed_rd;
+
   /*------------- From this point, data is not cleared by bus reset -------------*/
   char    wanted_char;
+
+  // Framed receive mode
+  uint8_t rx_framing;
+  uint8_t rx_delimiter;
+
+  usbd_tx_coalesce_t tx_coalesce;
   cdc_line_coding_t line_coding;
 
   // FIFO
@@ -65,6 +87,10 @@ typedef struct
   OSAL_MUTEX_DEF(rx_ff_mutex);
   OSAL_MUTEX_DEF(tx_ff_mutex);
 
+  // Lengths of complete records in rx_ff
+  tu_fifo_t rx_rec_ff;
+  uint16_t  rx_rec_buf[CFG_TUD_CDC_RX_RECORD_MAX];
+
   // Endpoint Transfer buffer
   CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_CDC_EP_BUFSIZE];
   CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_CDC_EP_BUFSIZE];
@@ -78,10 +104,16 @@ typedef struct
 //--------------------------------------------------------------------+
 CFG_TUSB_MEM_SECTION static cdcd_interface_t _cdcd_itf[CFG_TUD_CDC];
 
+// Max packet size of bulk endpoints at current speed
+static inline uint16_t _bulk_mps(void)
+{
+  return (tud_speed_get() == TUSB_SPEED_HIGH) ? 512 : 64;
+}
+
 static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
 {
   uint8_t const rhport = 0;
-  uint16_t available = tu_fifo_remaining(&p_cdc->rx_ff);
+  uint16_t available = (uint16_t) tu_min32(tu_fifo_remaining(&p_cdc->rx_ff), XFER_FIFO_MAX);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
@@ -93,10 +125,31 @@ static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
   TU_VERIFY(usbd_edpt_claim(rhport, p_cdc->ep_out));
 
   // fifo can be changed before endpoint is claimed
-  available = tu_fifo_remaining(&p_cdc->rx_ff);
+  available = (uint16_t) tu_min32(tu_fifo_remaining(&p_cdc->rx_ff), XFER_FIFO_MAX);
 
   if ( available >= sizeof(p_cdc->epout_buf) )
   {
+    if ( CFG_TUD_CDC_XFER_FIFO && usbd_edpt_xfer_fifo_supported(rhport) )
+    {
+      // Receive as many whole packets as fit into the linear free space of rx_ff, transfer ends early on short
+      // packet. A packet must never straddle the wrap since not every DCD can split it.
+      tu_fifo_buffer_info_t info;
+      tu_fifo_get_write_info(&p_cdc->rx_ff, &info);
+
+      uint16_t const lin_len  = (uint16_t) tu_min32(info.len_lin, XFER_FIFO_MAX);
+      uint16_t const xfer_len = (uint16_t) (lin_len - (lin_len % _bulk_mps()));
+
+      if ( xfer_len )
+      {
+        // Remember where data starts to look for wanted char on completion
+        p_cdc->rx_xfer_start = (uint8_t const*) info.ptr_lin;
+
+        return usbd_edpt_xfer_fifo(rhport, p_cdc->ep_out, &p_cdc->rx_ff, xfer_len);
+      }
+    }
+
+    // Less than one packet before the wrap: receive into epout_buf and copy
+    p_cdc->rx_xfer_start = NULL;
     return usbd_edpt_xfer(rhport, p_cdc->ep_out, p_cdc->epout_buf, sizeof(p_cdc->epout_buf));
   }else
   {
@@ -107,6 +160,134 @@ static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
   }
 }
 
+//--------------------------------------------------------------------+
+// Framed receive
+//--------------------------------------------------------------------+
+static void _rx_record_clear(cdcd_interface_t* p_cdc)
+{
+  tu_fifo_clear(&p_cdc->rx_rec_ff);
+
+  p_cdc->rx_rec_partial      = 0;
+  p_cdc->rx_rec_hdr_count    = 0;
+  p_cdc->rx_rec_need         = 0;
+  p_cdc->rx_rec_unindexed_rd = p_cdc->rx_rec_unindexed_wr;
+}
+
+// Longest record in delimiter mode, limited by rx_ff and length tracking
+static inline uint32_t _rx_record_max(cdcd_interface_t const* p_cdc)
+{
+  return tu_min32(sizeof(p_cdc->rx_ff_buf), UINT16_MAX);
+}
+
+static void _rx_record_complete(cdcd_interface_t* p_cdc)
+{
+  uint16_t const len = (uint16_t) p_cdc->rx_rec_partial;
+
+  p_cdc->rx_rec_partial   = 0;
+  p_cdc->rx_rec_hdr_count = 0;
+
+  // Keep order: once a record is not tracked, following ones are not either until all of them are read
+  if ( (p_cdc->rx_rec_unindexed_wr != p_cdc->rx_rec_unindexed_rd) || !tu_fifo_write(&p_cdc->rx_rec_ff, &len) )
+  {
+    p_cdc->rx_rec_unindexed_wr++;
+  }
+}
+
+// Track record boundaries in received data, return true if any record is completed
+static bool _rx_record_scan(cdcd_interface_t* p_cdc, uint8_t const* data, uint32_t len)
+{
+  bool found = false;
+
+  while ( len )
+  {
+    uint32_t n;
+    bool complete;
+
+    if ( p_cdc->rx_framing == CDC_RX_FRAMING_DELIMITER )
+    {
+      // record is split if longer than it could ever be buffered
+      uint32_t const room = _rx_record_max(p_cdc) - p_cdc->rx_rec_partial;
+      uint32_t const scan_len = tu_min32(len, room);
+      uint8_t const* end = (uint8_t const*) memchr(data, p_cdc->rx_delimiter, scan_len);
+
+      n = end ? (uint32_t) (end - data + 1) : scan_len;
+      complete = (end != NULL) || (n == room);
+    }
+    else if ( p_cdc->rx_rec_hdr_count < 2 )
+    {
+      // length prefix, little endian
+      p_cdc->rx_rec_need |= (uint16_t) (data[0] << (8*p_cdc->rx_rec_hdr_count));
+      p_cdc->rx_rec_hdr_count++;
+
+      n = 1;
+      complete = (p_cdc->rx_rec_hdr_count == 2) && (p_cdc->rx_rec_need == 0);
+    }
+    else
+    {
+      n = tu_min32(len, p_cdc->rx_rec_need);
+      p_cdc->rx_rec_need = (uint16_t) (p_cdc->rx_rec_need - n);
+      complete = (p_cdc->rx_rec_need == 0);
+    }
+
+    p_cdc->rx_rec_partial += n;
+    data += n;
+    len  -= n;
+
+    if ( complete )
+    {
+      _rx_record_complete(p_cdc);
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+// Get raw length of first record in rx_ff when it is not tracked
+static uint32_t _rx_record_find(cdcd_interface_t* p_cdc)
+{
+  if ( p_cdc->rx_framing == CDC_RX_FRAMING_LENGTH16 )
+  {
+    uint8_t prefix[2];
+    TU_VERIFY(2 == tu_fifo_peek_n(&p_cdc->rx_ff, prefix, 2), 0);
+    return 2u + tu_u16(prefix[1], prefix[0]);
+  }
+
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_read_info(&p_cdc->rx_ff, &info);
+
+  uint32_t len;
+  uint8_t const* end = (uint8_t const*) memchr(info.ptr_lin, p_cdc->rx_delimiter, info.len_lin);
+
+  if ( end )
+  {
+    len = (uint32_t) (end - (uint8_t const*) info.ptr_lin + 1);
+  }else
+  {
+    len = info.len_lin;
+
+    if ( info.len_wrap )
+    {
+      end = (uint8_t const*) memchr(info.ptr_wrap, p_cdc->rx_delimiter, info.len_wrap);
+      len += end ? (uint32_t) (end - (uint8_t const*) info.ptr_wrap + 1) : info.len_wrap;
+    }
+  }
+
+  return tu_min32(len, _rx_record_max(p_cdc));
+}
+
+// Invoke wanted char callback for each occurrence in received data
+static void _rx_wanted_scan(uint8_t itf, cdcd_interface_t* p_cdc, uint8_t const* data, uint32_t len)
+{
+  uint8_t const* const end = data + len;
+
+  while ( (data = (uint8_t const*) memchr(data, (uint8_t) p_cdc->wanted_char, (size_t) (end - data))) != NULL )
+  {
+    data++;
+    if ( !tu_fifo_empty(&p_cdc->rx_ff) ) tud_cdc_rx_wanted_cb(itf, p_cdc->wanted_char);
+  }
+}
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
@@ -153,31 +334,148 @@ bool tud_cdc_n_peek(uint8_t itf, uint8_t* chr)
   return tu_fifo_peek(&_cdcd_itf[itf].rx_ff, chr);
 }
 
+uint32_t tud_cdc_n_read_peek_linear(uint8_t itf, uint8_t const** pp_buf)
+{
+  void const* p_data;
+  uint16_t const count = tu_fifo_read_peek_linear(&_cdcd_itf[itf].rx_ff, &p_data, UINT16_MAX);
+
+  *pp_buf = (uint8_t const*) p_data;
+  return count;
+}
+
+void tud_cdc_n_read_release(uint8_t itf, uint32_t count)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  tu_fifo_read_release(&p_cdc->rx_ff, (uint16_t) count);
+  _prep_out_transaction(p_cdc);
+}
+
 void tud_cdc_n_read_flush (uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  tu_fifo_clear(&p_cdc->rx_ff);
+
+  // keep write index, an OUT transfer may be receiving directly into rx_ff
+  tu_fifo_discard_n(&p_cdc->rx_ff, tu_fifo_count(&p_cdc->rx_ff));
+  _rx_record_clear(p_cdc);
+  _prep_out_transaction(p_cdc);
+}
+
+//--------------------------------------------------------------------+
+// FRAMED READ API
+//--------------------------------------------------------------------+
+bool tud_cdc_n_set_rx_framing(uint8_t itf, cdc_rx_framing_t framing, uint8_t delimiter)
+{
+  TU_VERIFY(itf < CFG_TUD_CDC);
+
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  p_cdc->rx_framing   = (uint8_t) framing;
+  p_cdc->rx_delimiter = delimiter;
+
+  // drop data received without boundary tracking
+  tud_cdc_n_read_flush(itf);
+
+  return true;
+}
+
+uint32_t tud_cdc_n_record_count(uint8_t itf)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  return tu_fifo_count(&p_cdc->rx_rec_ff) + (uint16_t) (p_cdc->rx_rec_unindexed_wr - p_cdc->rx_rec_unindexed_rd);
+}
+
+uint32_t tud_cdc_n_read_record(uint8_t itf, void* buffer, uint32_t bufsize)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  TU_VERIFY(p_cdc->rx_framing != CDC_RX_FRAMING_NONE, 0);
+
+  uint32_t rec_len;
+  uint16_t tracked_len;
+
+  if ( tu_fifo_read(&p_cdc->rx_rec_ff, &tracked_len) )
+  {
+    rec_len = tracked_len;
+  }else
+  {
+    TU_VERIFY(p_cdc->rx_rec_unindexed_wr != p_cdc->rx_rec_unindexed_rd, 0);
+    rec_len = _rx_record_find(p_cdc);
+    p_cdc->rx_rec_unindexed_rd++;
+  }
+
+  if ( p_cdc->rx_framing == CDC_RX_FRAMING_LENGTH16 )
+  {
+    // remove length prefix
+    tu_fifo_discard_n(&p_cdc->rx_ff, 2);
+    rec_len -= 2;
+  }
+
+  uint16_t const count = tu_fifo_read_n(&p_cdc->rx_ff, buffer, (uint16_t) tu_min32(rec_len, bufsize));
+
+  // discard what does not fit into buffer
+  if ( rec_len > count ) tu_fifo_discard_n(&p_cdc->rx_ff, (tu_fifo_idx_t) (rec_len - count));
+
   _prep_out_transaction(p_cdc);
+
+  return count;
 }
 
 //--------------------------------------------------------------------+
 // WRITE API
 //--------------------------------------------------------------------+
-uint32_t tud_cdc_n_write(uint8_t itf, void const* buffer, uint32_t bufsize)
+// flush according to coalescing policy after data is queued
+static void _write_flush_if_packet(uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  uint16_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, (uint16_t) bufsize);
 
-  // flush if queue more than packet size
   // may need to suppress -Wunreachable-code since most of the time CFG_TUD_CDC_TX_BUFSIZE < BULK_PACKET_SIZE
-  if ( (tu_fifo_count(&p_cdc->tx_ff) >= BULK_PACKET_SIZE) || ((CFG_TUD_CDC_TX_BUFSIZE < BULK_PACKET_SIZE) && tu_fifo_full(&p_cdc->tx_ff)) )
+  if ( usbd_tx_coalesce_flush_now(&p_cdc->tx_coalesce, tu_fifo_count(&p_cdc->tx_ff), BULK_PACKET_SIZE) ||
+       ((CFG_TUD_CDC_TX_BUFSIZE < BULK_PACKET_SIZE) && tu_fifo_full(&p_cdc->tx_ff)) )
   {
     tud_cdc_n_write_flush(itf);
   }
 
+  usbd_tx_coalesce_arm(&p_cdc->tx_coalesce, tu_fifo_count(&p_cdc->tx_ff));
+}
+
+bool tud_cdc_n_set_tx_coalesce(uint8_t itf, tud_tx_coalesce_t policy, uint16_t frames)
+{
+  TU_VERIFY(itf < CFG_TUD_CDC);
+  TU_VERIFY(policy != TUD_TX_COALESCE_FRAMES || frames);
+
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  // applied again once interface is opened
+  return usbd_tx_coalesce_set(0, &p_cdc->tx_coalesce, policy, frames, p_cdc->ep_in != 0);
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, void const* buffer, uint32_t bufsize)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  uint16_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, (uint16_t) bufsize);
+
+  _write_flush_if_packet(itf);
+
   return ret;
 }
 
+uint32_t tud_cdc_n_write_reserve(uint8_t itf, uint8_t** pp_buf, uint32_t bufsize)
+{
+  void* p_data;
+  uint16_t const count = tu_fifo_write_reserve(&_cdcd_itf[itf].tx_ff, &p_data, (uint16_t) tu_min32(bufsize, UINT16_MAX));
+
+  *pp_buf = (uint8_t*) p_data;
+  return count;
+}
+
+uint32_t tud_cdc_n_write_commit(uint8_t itf, uint32_t count)
+{
+  tu_fifo_write_commit(&_cdcd_itf[itf].tx_ff, (uint16_t) count);
+
+  _write_flush_if_packet(itf);
+
+  return count;
+}
+
 uint32_t tud_cdc_n_write_flush (uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
@@ -193,6 +491,24 @@ uint32_t tud_cdc_n_write_flush (uint8_t itf)
   // Claim the endpoint
   TU_VERIFY( usbd_edpt_claim(rhport, p_cdc->ep_in), 0 );
 
+  usbd_tx_coalesce_disarm(&p_cdc->tx_coalesce);
+
+  // Send all queued data in a single multi-packet transfer directly from FIFO if supported. Not used while
+  // tx_ff is overwritable (terminal not connected) since writer could then overwrite data being sent.
+  if ( CFG_TUD_CDC_XFER_FIFO && usbd_edpt_xfer_fifo_supported(rhport) && !p_cdc->tx_ff.overwritable )
+  {
+    uint16_t const count = (uint16_t) tu_min32(tu_fifo_count(&p_cdc->tx_ff), XFER_FIFO_MAX);
+
+    if ( count )
+    {
+      TU_ASSERT( usbd_edpt_xfer_fifo(rhport, p_cdc->ep_in, &p_cdc->tx_ff, count), 0 );
+      return count;
+    }
+
+    usbd_edpt_release(rhport, p_cdc->ep_in);
+    return 0;
+  }
+
   // Pull data from FIFO
   uint16_t const count = tu_fifo_read_n(&p_cdc->tx_ff, p_cdc->epin_buf, sizeof(p_cdc->epin_buf));
 
@@ -248,6 +564,30 @@ void cdcd_init(void)
 
     tu_fifo_config_mutex(&p_cdc->rx_ff, NULL, osal_mutex_create(&p_cdc->rx_ff_mutex));
     tu_fifo_config_mutex(&p_cdc->tx_ff, osal_mutex_create(&p_cdc->tx_ff_mutex), NULL);
+
+    tu_fifo_config(&p_cdc->rx_rec_ff, p_cdc->rx_rec_buf, CFG_TUD_CDC_RX_RECORD_MAX, sizeof(uint16_t), false);
+  }
+}
+
+// Deferred from SOF when frame countdown expired
+static void _cdcd_flush_deferred(void* param)
+{
+  tud_cdc_n_write_flush((uint8_t) (uintptr_t) param);
+}
+
+void cdcd_sof(uint8_t rhport, uint32_t frame_count)
+{
+  (void) rhport;
+  (void) frame_count;
+
+  for(uint8_t i=0; i<CFG_TUD_CDC; i++)
+  {
+    cdcd_interface_t* p_cdc = &_cdcd_itf[i];
+
+    if ( usbd_tx_coalesce_sof(&p_cdc->tx_coalesce) )
+    {
+      usbd_defer_func(_cdcd_flush_deferred, (void*) (uintptr_t) i, true);
+    }
   }
 }
 
@@ -259,8 +599,10 @@ void cdcd_reset(uint8_t rhport)
   {
     cdcd_interface_t* p_cdc = &_cdcd_itf[i];
 
+    usbd_tx_coalesce_update(rhport, &p_cdc->tx_coalesce, false);
     tu_memclr(p_cdc, ITF_MEM_RESET_SIZE);
     tu_fifo_clear(&p_cdc->rx_ff);
+    tu_fifo_clear(&p_cdc->rx_rec_ff);
     tu_fifo_clear(&p_cdc->tx_ff);
     tu_fifo_set_overwritable(&p_cdc->tx_ff, true);
   }
@@ -323,6 +665,8 @@ uint16_t cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
     drv_len += 2*sizeof(tusb_desc_endpoint_t);
   }
 
+  usbd_tx_coalesce_update(rhport, &p_cdc->tx_coalesce, p_cdc->ep_in != 0);
+
   // Prepare for incoming data
   _prep_out_transaction(p_cdc);
 
@@ -432,18 +776,28 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   // Received new data
   if ( ep_addr == p_cdc->ep_out )
   {
-    tu_fifo_write_n(&p_cdc->rx_ff, p_cdc->epout_buf, (uint16_t) xferred_bytes);
-    
+    uint8_t const* rx_data = p_cdc->rx_xfer_start;
+
+    if ( rx_data )
+    {
+      // received directly into linear part of rx_ff
+      p_cdc->rx_xfer_start = NULL;
+    }else
+    {
+      tu_fifo_write_n(&p_cdc->rx_ff, p_cdc->epout_buf, (uint16_t) xferred_bytes);
+      rx_data = p_cdc->epout_buf;
+    }
+
+    // Track record boundaries
+    if ( p_cdc->rx_framing != CDC_RX_FRAMING_NONE )
+    {
+      if ( _rx_record_scan(p_cdc, rx_data, xferred_bytes) && tud_cdc_rx_record_cb ) tud_cdc_rx_record_cb(itf);
+    }
+
     // Check for wanted char and invoke callback if needed
     if ( tud_cdc_rx_wanted_cb && (((signed char) p_cdc->wanted_char) != -1) )
     {
-      for ( uint32_t i = 0; i < xferred_bytes; i++ )
-      {
-        if ( (p_cdc->wanted_char == p_cdc->epout_buf[i]) && !tu_fifo_empty(&p_cdc->rx_ff) )
-        {
-          tud_cdc_rx_wanted_cb(itf, p_cdc->wanted_char);
-        }
-      }
+      _rx_wanted_scan(itf, p_cdc, rx_data, xferred_bytes);
     }
     
     // invoke receive callback (if there is still data)
@@ -465,7 +819,7 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     {
       // If there is no data left, a ZLP should be sent if
       // xferred_bytes is multiple of EP Packet size and not zero
-      if ( !tu_fifo_count(&p_cdc->tx_ff) && xferred_bytes && (0 == (xferred_bytes & (BULK_PACKET_SIZE-1))) )
+      if ( !tu_fifo_count(&p_cdc->tx_ff) && xferred_bytes && (0 == (xferred_bytes & (_bulk_mps()-1u))) )
       {
         if ( usbd_edpt_claim(rhport, p_cdc->ep_in) )
         {
@@ -41,10 +41,30 @@
   #define CFG_TUD_CDC_EP_BUFSIZE    (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #endif
 
+// Transfer bulk data directly from/to RX/TX FIFO with usbd_edpt_xfer_fifo() instead of through the endpoint
+// buffers. Enabled by default only for ports whose bulk FIFO transfer is verified (TUP_DCD_EDPT_XFER_FIFO_BULK).
+#ifndef CFG_TUD_CDC_XFER_FIFO
+  #define CFG_TUD_CDC_XFER_FIFO     TUP_DCD_EDPT_XFER_FIFO_BULK
+#endif
+
+// Number of complete record lengths tracked in framed receive mode. More records can be
+// buffered in the RX FIFO, their boundaries are then located when read.
+#ifndef CFG_TUD_CDC_RX_RECORD_MAX
+  #define CFG_TUD_CDC_RX_RECORD_MAX 16
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
 
+// Framed receive mode
+typedef enum
+{
+  CDC_RX_FRAMING_NONE = 0 , // plain byte stream (default)
+  CDC_RX_FRAMING_DELIMITER, // record ends with delimiter byte e.g '\n', SLIP END (0xC0) or COBS (0x00), delimiter is kept
+  CDC_RX_FRAMING_LENGTH16 , // record starts with 16-bit little endian payload length, prefix is removed when read
+} cdc_rx_framing_t;
+
 /** \addtogroup CDC_Serial Serial
  *  @{
  *  \defgroup   CDC_Serial_Device Device
@@ -83,6 +103,25 @@ void     tud_cdc_n_read_flush      (uint8_t itf);
 // Get a byte from FIFO without removing it
 bool     tud_cdc_n_peek            (uint8_t itf, uint8_t* ui8);
 
+// Zero-copy read: get pointer to received bytes inside RX FIFO, return number of linear bytes there.
+// Must be followed by tud_cdc_n_read_release() with number of bytes consumed (can be zero).
+uint32_t tud_cdc_n_read_peek_linear(uint8_t itf, uint8_t const** pp_buf);
+
+// Remove bytes consumed after tud_cdc_n_read_peek_linear()
+void     tud_cdc_n_read_release    (uint8_t itf, uint32_t count);
+
+// Enable framed receive mode, record boundaries are tracked as data is received. Records must then be read with
+// tud_cdc_n_read_record() only. Records must fit into RX FIFO: in delimiter mode longer records are split
+// at FIFO size, in length mode they stall reception until tud_cdc_n_read_flush(). RX FIFO is cleared.
+bool     tud_cdc_n_set_rx_framing  (uint8_t itf, cdc_rx_framing_t framing, uint8_t delimiter);
+
+// Get the number of complete records available for reading
+uint32_t tud_cdc_n_record_count    (uint8_t itf);
+
+// Read one complete record, return number of bytes copied or 0 if there is none.
+// Bytes of the record that do not fit into buffer are discarded.
+uint32_t tud_cdc_n_read_record     (uint8_t itf, void* buffer, uint32_t bufsize);
+
 // Write bytes to TX FIFO, data may remain in the FIFO for a while
 uint32_t tud_cdc_n_write           (uint8_t itf, void const* buffer, uint32_t bufsize);
 
@@ -94,9 +133,21 @@ uint32_t tud_cdc_n_write_char      (uint8_t itf, char ch);
 static inline
 uint32_t tud_cdc_n_write_str       (uint8_t itf, char const* str);
 
+// Zero-copy write: get pointer to free linear space inside TX FIFO of up to bufsize bytes, return its size.
+// Data is written directly there e.g by DMA, then tud_cdc_n_write_commit() must be called (count can be zero).
+uint32_t tud_cdc_n_write_reserve   (uint8_t itf, uint8_t** pp_buf, uint32_t bufsize);
+
+// Commit bytes written after tud_cdc_n_write_reserve(), flushed like tud_cdc_n_write()
+uint32_t tud_cdc_n_write_commit    (uint8_t itf, uint32_t count);
+
 // Force sending data if possible, return number of forced bytes
 uint32_t tud_cdc_n_write_flush     (uint8_t itf);
 
+// Set TX coalescing policy (default TUD_TX_COALESCE_PACKET). With TUD_TX_COALESCE_FRAMES data left in TX FIFO
+// is flushed at most `frames` SOFs (1 ms FS, 125 us HS) after it is written, no tud_cdc_n_write_flush() needed.
+// Can be set before the stack is initialized, SOF interrupt is only enabled while the interface is opened.
+bool tud_cdc_n_set_tx_coalesce     (uint8_t itf, tud_tx_coalesce_t policy, uint16_t frames);
+
 // Return the number of bytes (characters) available for writing to TX FIFO buffer in a single n_write operation.
 uint32_t tud_cdc_n_write_available (uint8_t itf);
 
@@ -116,11 +167,19 @@ static inline int32_t  tud_cdc_read_char       (void);
 static inline uint32_t tud_cdc_read            (void* buffer, uint32_t bufsize);
 static inline void     tud_cdc_read_flush      (void);
 static inline bool     tud_cdc_peek            (uint8_t* ui8);
+static inline uint32_t tud_cdc_read_peek_linear(uint8_t const** pp_buf);
+static inline void     tud_cdc_read_release    (uint32_t count);
+static inline bool     tud_cdc_set_rx_framing  (cdc_rx_framing_t framing, uint8_t delimiter);
+static inline uint32_t tud_cdc_record_count    (void);
+static inline uint32_t tud_cdc_read_record     (void* buffer, uint32_t bufsize);
 
 static inline uint32_t tud_cdc_write_char      (char ch);
 static inline uint32_t tud_cdc_write           (void const* buffer, uint32_t bufsize);
 static inline uint32_t tud_cdc_write_str       (char const* str);
+static inline uint32_t tud_cdc_write_reserve   (uint8_t** pp_buf, uint32_t bufsize);
+static inline uint32_t tud_cdc_write_commit    (uint32_t count);
 static inline uint32_t tud_cdc_write_flush     (void);
+static inline bool     tud_cdc_set_tx_coalesce (tud_tx_coalesce_t policy, uint16_t frames);
 static inline uint32_t tud_cdc_write_available (void);
 static inline bool     tud_cdc_write_clear     (void);
 
@@ -134,6 +193,9 @@ TU_ATTR_WEAK void tud_cdc_rx_cb(uint8_t itf);
 // Invoked when received `wanted_char`
 TU_ATTR_WEAK void tud_cdc_rx_wanted_cb(uint8_t itf, char wanted_char);
 
+// Invoked in framed receive mode when new complete records are available
+TU_ATTR_WEAK void tud_cdc_rx_record_cb(uint8_t itf);
+
 // Invoked when a TX is complete and therefore space becomes available in TX buffer
 TU_ATTR_WEAK void tud_cdc_tx_complete_cb(uint8_t itf);
 
@@ -210,6 +272,31 @@ static inline bool tud_cdc_peek (uint8_t* ui8)
   return tud_cdc_n_peek(0, ui8);
 }
 
+static inline uint32_t tud_cdc_read_peek_linear (uint8_t const** pp_buf)
+{
+  return tud_cdc_n_read_peek_linear(0, pp_buf);
+}
+
+static inline void tud_cdc_read_release (uint32_t count)
+{
+  tud_cdc_n_read_release(0, count);
+}
+
+static inline bool tud_cdc_set_rx_framing (cdc_rx_framing_t framing, uint8_t delimiter)
+{
+  return tud_cdc_n_set_rx_framing(0, framing, delimiter);
+}
+
+static inline uint32_t tud_cdc_record_count (void)
+{
+  return tud_cdc_n_record_count(0);
+}
+
+static inline uint32_t tud_cdc_read_record (void* buffer, uint32_t bufsize)
+{
+  return tud_cdc_n_read_record(0, buffer, bufsize);
+}
+
 static inline uint32_t tud_cdc_write_char (char ch)
 {
   return tud_cdc_n_write_char(0, ch);
@@ -225,11 +312,26 @@ static inline uint32_t tud_cdc_write_str (char const* str)
   return tud_cdc_n_write_str(0, str);
 }
 
+static inline uint32_t tud_cdc_write_reserve (uint8_t** pp_buf, uint32_t bufsize)
+{
+  return tud_cdc_n_write_reserve(0, pp_buf, bufsize);
+}
+
+static inline uint32_t tud_cdc_write_commit (uint32_t count)
+{
+  return tud_cdc_n_write_commit(0, count);
+}
+
 static inline uint32_t tud_cdc_write_flush (void)
 {
   return tud_cdc_n_write_flush(0);
 }
 
+static inline bool tud_cdc_set_tx_coalesce (tud_tx_coalesce_t policy, uint16_t frames)
+{
+  return tud_cdc_n_set_tx_coalesce(0, policy, frames);
+}
+
 static inline uint32_t tud_cdc_write_available(void)
 {
   return tud_cdc_n_write_available(0);
@@ -251,6 +353,7 @@ void     cdcd_reset           (uint8_t rhport);
 uint16_t cdcd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     cdcd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     cdcd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     cdcd_sof             (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
  }
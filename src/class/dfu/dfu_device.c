@@ -48,11 +48,20 @@ typedef struct
   dfu_state_t state;
   dfu_status_t status;
 
-  bool flashing_in_progress;
-  uint16_t block;
-  uint16_t length;
+  bool flashing_in_progress;  // manifestation requested or in progress
+  bool manifest_pending;      // manifestation waits for queued blocks to be flashed
 
-  CFG_TUSB_MEM_ALIGN uint8_t transfer_buf[CFG_TUD_DFU_XFER_BUFSIZE];
+  // Download blocks are queued in transfer_buf[] and flashed in order starting at prog_idx
+  bool dn_pending;            // block received after the queued ones, queued on next GETSTATUS
+  bool dn_flashing;           // tud_dfu_download_cb() invoked for block at prog_idx
+  bool in_flash_cb;           // tud_dfu_download_cb() or tud_dfu_manifest_cb() is running in USB task
+  uint8_t prog_idx;
+  uint8_t prog_count;         // number of queued blocks, including the one being flashed
+
+  uint16_t block[CFG_TUD_DFU_XFER_BUFCOUNT];
+  uint16_t length[CFG_TUD_DFU_XFER_BUFCOUNT];
+
+  CFG_TUSB_MEM_ALIGN uint8_t transfer_buf[CFG_TUD_DFU_XFER_BUFCOUNT][CFG_TUD_DFU_XFER_BUFSIZE];
 } dfu_state_ctx_t;
 
 // Only a single dfu state is allowed
@@ -63,6 +72,68 @@ static void reset_state(void)
   _dfu_ctx.state = DFU_IDLE;
   _dfu_ctx.status = DFU_STATUS_OK;
   _dfu_ctx.flashing_in_progress = false;
+  _dfu_ctx.manifest_pending = false;
+
+  _dfu_ctx.dn_pending = false;
+  _dfu_ctx.dn_flashing = false;
+  _dfu_ctx.prog_idx = 0;
+  _dfu_ctx.prog_count = 0;
+}
+
+// Start flashing next queued block, or manifestation once all blocks are flashed
+static void flash_next(void)
+{
+  if ( _dfu_ctx.dn_flashing ) return;
+
+  if ( _dfu_ctx.prog_count )
+  {
+    uint8_t const idx = _dfu_ctx.prog_idx;
+
+    // flashing can be finished within the callback, which then flashes the next block recursively
+    bool const in_cb = _dfu_ctx.in_flash_cb;
+    _dfu_ctx.in_flash_cb = true;
+    _dfu_ctx.dn_flashing = true;
+    tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.block[idx], _dfu_ctx.transfer_buf[idx], _dfu_ctx.length[idx]);
+    _dfu_ctx.in_flash_cb = in_cb;
+  }
+  else if ( _dfu_ctx.manifest_pending )
+  {
+    bool const in_cb = _dfu_ctx.in_flash_cb;
+    _dfu_ctx.in_flash_cb = true;
+    _dfu_ctx.manifest_pending = false;
+    tud_dfu_manifest_cb(_dfu_ctx.alt);
+    _dfu_ctx.in_flash_cb = in_cb;
+  }
+}
+
+// Called by tud_dfu_finish_flashing() when a download block is complete, deferred to USB task if needed
+static void download_complete(void* param)
+{
+  uint8_t const status = (uint8_t) (uintptr_t) param;
+
+  // state is reset (e.g abort) while flashing
+  if ( !_dfu_ctx.dn_flashing ) return;
+
+  _dfu_ctx.dn_flashing = false;
+
+  if ( status != DFU_STATUS_OK )
+  {
+    // failed while flashing, move to dfuError and drop queued blocks
+    _dfu_ctx.state = DFU_ERROR;
+    _dfu_ctx.status = (dfu_status_t) status;
+    _dfu_ctx.prog_count = 0;
+    _dfu_ctx.dn_pending = false;
+    _dfu_ctx.flashing_in_progress = false;
+    _dfu_ctx.manifest_pending = false;
+    return;
+  }
+
+  _dfu_ctx.prog_idx = (uint8_t) ((_dfu_ctx.prog_idx + 1) % CFG_TUD_DFU_XFER_BUFCOUNT);
+  _dfu_ctx.prog_count--;
+
+  if ( _dfu_ctx.state == DFU_DNBUSY ) _dfu_ctx.state = DFU_DNLOAD_SYNC;
+
+  flash_next();
 }
 
 static bool reply_getstatus(uint8_t rhport, tusb_control_request_t const * request, dfu_state_t state, dfu_status_t status, uint32_t timeout);
@@ -285,9 +356,9 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
           TU_VERIFY(tud_dfu_upload_cb);
           TU_VERIFY(request->wLength <= CFG_TUD_DFU_XFER_BUFSIZE);
 
-          uint16_t const xfer_len = tud_dfu_upload_cb(_dfu_ctx.alt, request->wValue, _dfu_ctx.transfer_buf, request->wLength);
+          uint16_t const xfer_len = tud_dfu_upload_cb(_dfu_ctx.alt, request->wValue, _dfu_ctx.transfer_buf[0], request->wLength);
 
-          return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf, xfer_len);
+          return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf[0], xfer_len);
         }
       break;
 
@@ -298,21 +369,25 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
           TU_VERIFY(_dfu_ctx.state == DFU_IDLE || _dfu_ctx.state == DFU_DNLOAD_IDLE);
           TU_VERIFY(request->wLength <= CFG_TUD_DFU_XFER_BUFSIZE);
 
-          // set to true for both download and manifest
-          _dfu_ctx.flashing_in_progress = true;
-
-          // save block and length for flashing
-          _dfu_ctx.block  = request->wValue;
-          _dfu_ctx.length = request->wLength;
-
           if ( request->wLength )
           {
+            // a buffer is free since dfuDNLOAD-IDLE is only reported then
+            TU_VERIFY(_dfu_ctx.prog_count < CFG_TUD_DFU_XFER_BUFCOUNT);
+
+            // save block and length for flashing
+            uint8_t const idx = (uint8_t) ((_dfu_ctx.prog_idx + _dfu_ctx.prog_count) % CFG_TUD_DFU_XFER_BUFCOUNT);
+            _dfu_ctx.block[idx]  = request->wValue;
+            _dfu_ctx.length[idx] = request->wLength;
+            _dfu_ctx.dn_pending  = true;
+
             // Download with payload -> transition to DOWNLOAD SYNC
             _dfu_ctx.state = DFU_DNLOAD_SYNC;
-            return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf, request->wLength);
+            return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf[idx], request->wLength);
           }
           else
           {
+            _dfu_ctx.flashing_in_progress = true;
+
             // Download is complete -> transition to MANIFEST SYNC
             _dfu_ctx.state = DFU_MANIFEST_SYNC;
             return tud_control_status(rhport, request);
@@ -324,6 +399,7 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
         switch ( _dfu_ctx.state )
         {
           case DFU_DNLOAD_SYNC:
+          case DFU_DNBUSY:
             return process_download_get_status(rhport, stage, request);
           break;
 
@@ -347,17 +423,16 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
   return true;
 }
 
-void tud_dfu_finish_flashing(uint8_t status)
+// Called by tud_dfu_finish_flashing() when manifestation is complete
+static void manifest_complete(void* param)
 {
+  uint8_t const status = (uint8_t) (uintptr_t) param;
+
   _dfu_ctx.flashing_in_progress = false;
 
   if ( status == DFU_STATUS_OK )
   {
-    if (_dfu_ctx.state == DFU_DNBUSY)
-    {
-      _dfu_ctx.state = DFU_DNLOAD_SYNC;
-    }
-    else if (_dfu_ctx.state == DFU_MANIFEST)
+    if (_dfu_ctx.state == DFU_MANIFEST)
     {
       _dfu_ctx.state = (_dfu_ctx.attrs & DFU_ATTR_MANIFESTATION_TOLERANT)
                                ? DFU_MANIFEST_SYNC : DFU_MANIFEST_WAIT_RESET;
@@ -371,6 +446,31 @@ void tud_dfu_finish_flashing(uint8_t status)
   }
 }
 
+void tud_dfu_finish_flashing(uint8_t status)
+{
+  if ( _dfu_ctx.dn_flashing )
+  {
+#if CFG_TUD_DFU_XFER_BUFCOUNT > 1
+    // called from another task: release block buffer and flash the next one in USB task
+    if ( !_dfu_ctx.in_flash_cb )
+    {
+      usbd_defer_func(download_complete, (void*) (uintptr_t) status, false);
+      return;
+    }
+#endif
+
+    download_complete((void*) (uintptr_t) status);
+    return;
+  }
+
+  manifest_complete((void*) (uintptr_t) status);
+}
+
+void tud_dfu_finish_flashing_isr(uint8_t status)
+{
+  usbd_defer_func(_dfu_ctx.dn_flashing ? download_complete : manifest_complete, (void*) (uintptr_t) status, true);
+}
+
 static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
   if ( stage == CONTROL_STAGE_SETUP )
@@ -379,7 +479,10 @@ static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_cont
     dfu_state_t next_state;
     uint32_t timeout;
 
-    if ( _dfu_ctx.flashing_in_progress )
+    // host is held off only when there is no free buffer for the next block
+    uint8_t const queued = (uint8_t) (_dfu_ctx.prog_count + (_dfu_ctx.dn_pending ? 1 : 0));
+
+    if ( queued >= CFG_TUD_DFU_XFER_BUFCOUNT )
     {
       next_state = DFU_DNBUSY;
       timeout = tud_dfu_get_timeout_cb(_dfu_ctx.alt, (uint8_t) next_state);
@@ -394,14 +497,15 @@ static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_cont
   }
   else if ( stage == CONTROL_STAGE_ACK )
   {
-    if ( _dfu_ctx.flashing_in_progress )
+    // queue received block
+    if ( _dfu_ctx.dn_pending )
     {
-      _dfu_ctx.state = DFU_DNBUSY;
-      tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.block, _dfu_ctx.transfer_buf, _dfu_ctx.length);
-    }else
-    {
-      _dfu_ctx.state = DFU_DNLOAD_IDLE;
+      _dfu_ctx.dn_pending = false;
+      _dfu_ctx.prog_count++;
     }
+
+    _dfu_ctx.state = (_dfu_ctx.prog_count >= CFG_TUD_DFU_XFER_BUFCOUNT) ? DFU_DNBUSY : DFU_DNLOAD_IDLE;
+    flash_next();
   }
 
   return true;
@@ -433,7 +537,10 @@ static bool process_manifest_get_status(uint8_t rhport, uint8_t stage, tusb_cont
     if ( _dfu_ctx.flashing_in_progress )
     {
       _dfu_ctx.state = DFU_MANIFEST;
-      tud_dfu_manifest_cb(_dfu_ctx.alt);
+
+      // blocks still being flashed are completed first
+      _dfu_ctx.manifest_pending = true;
+      flash_next();
     }
     else
     {
@@ -41,6 +41,12 @@
   #error "CFG_TUD_DFU_XFER_BUFSIZE must be defined, it has to be set to the buffer size used in TUD_DFU_DESCRIPTOR"
 #endif
 
+// Number of download buffers. With more than one, the next block is received while the
+// previous one is still being flashed, and the host is only held off (dfuDNBUSY) when all buffers are in use.
+#ifndef CFG_TUD_DFU_XFER_BUFCOUNT
+  #define CFG_TUD_DFU_XFER_BUFCOUNT 1
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -48,8 +54,14 @@
 // Must be called when the application is done with flashing started by
 // tud_dfu_download_cb() and tud_dfu_manifest_cb().
 // status is DFU_STATUS_OK if successful, any other error status will cause state to enter dfuError
+// Can be called within the flashing callback. With CFG_TUD_DFU_XFER_BUFCOUNT > 1 it can also be called from
+// another task, the next queued block is then passed to tud_dfu_download_cb() from the USB task.
 void tud_dfu_finish_flashing(uint8_t status);
 
+// Same as tud_dfu_finish_flashing() but to be called from interrupt (e.g flash controller),
+// completion is deferred to the USB task
+void tud_dfu_finish_flashing_isr(uint8_t status);
+
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
@@ -59,11 +71,15 @@ void tud_dfu_finish_flashing(uint8_t status);
 // Invoked right before tud_dfu_download_cb() (state=DFU_DNBUSY) or tud_dfu_manifest_cb() (state=DFU_MANIFEST)
 // Application return timeout in milliseconds (bwPollTimeout) for the next download/manifest operation.
 // During this period, USB host won't try to communicate with us.
+// With CFG_TUD_DFU_XFER_BUFCOUNT > 1, DFU_DNBUSY is only reported when all buffers are in use, the timeout
+// is then the time until the block being flashed completes.
 uint32_t tud_dfu_get_timeout_cb(uint8_t alt, uint8_t state);
 
 // Invoked when received DFU_DNLOAD (wLength>0) following by DFU_GETSTATUS (state=DFU_DNBUSY) requests
 // This callback could be returned before flashing op is complete (async).
 // Once finished flashing, application must call tud_dfu_finish_flashing()
+// With CFG_TUD_DFU_XFER_BUFCOUNT > 1 blocks are passed one at a time in order, data stays valid until
+// tud_dfu_finish_flashing(). A flashing error is reported to the host with the following request.
 void tud_dfu_download_cb (uint8_t alt, uint16_t block_num, uint8_t const *data, uint16_t length);
 
 // Invoked when download process is complete, received DFU_DNLOAD (wLength=0) following by DFU_GETSTATUS (state=Manifest)
@@ -93,7 +93,7 @@ bool tud_midi_n_mounted (uint8_t itf)
 static void _prep_out_transaction (midid_interface_t* p_midi)
 {
   uint8_t const rhport = 0;
-  uint16_t available = tu_fifo_remaining(&p_midi->rx_ff);
+  tu_fifo_idx_t available = tu_fifo_remaining(&p_midi->rx_ff);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
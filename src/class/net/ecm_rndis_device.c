@@ -56,13 +56,39 @@ typedef struct
   // keep a copy of endpoint attribute instead
   uint8_t const * ecm_desc_epdata;
 
+  // RNDIS: MaxTransferSize of host from REMOTE_NDIS_INITIALIZE_MSG, 0 if not known
+  uint32_t rndis_host_max_xfer;
+
+  // Receive ring: buffers are filled in order, packets of the oldest one are passed to application
+  uint8_t  rx_head;
+  uint8_t  rx_count;
+  uint16_t rx_len[CFG_TUD_NET_RX_BUFCOUNT];
+  uint16_t rx_offset;      // parse offset in oldest buffer
+  bool     rx_held;        // packet is held by application until tud_network_recv_renew()
+  bool     rx_delivering;
+
+  // Transmit ring: closed buffers are sent in order, the one after them is being filled
+  uint8_t  tx_head;
+  uint8_t  tx_count;
+  uint16_t tx_len[CFG_TUD_NET_TX_BUFCOUNT];
+  uint16_t tx_fill_len;
+  uint8_t  tx_fill_packets;
+  bool     tx_busy;
+  bool     tx_zlp;
+
 } netd_interface_t;
 
 #define CFG_TUD_NET_PACKET_PREFIX_LEN sizeof(rndis_data_packet_t)
 #define CFG_TUD_NET_PACKET_SUFFIX_LEN 0
 
-CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t received[CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN];
-CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t transmitted[CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN];
+// Transfer buffer holds up to CFG_TUD_RNDIS_PACKETS_PER_XFER packet messages
+#define NETD_XFER_SIZE  (CFG_TUD_RNDIS_PACKETS_PER_XFER * RNDIS_PACKET_MSG_SPACE(CFG_TUD_NET_MTU) + CFG_TUD_NET_PACKET_PREFIX_LEN)
+
+// transfer and buffer lengths are 16-bit
+TU_VERIFY_STATIC(NETD_XFER_SIZE <= 0xFFFF, "CFG_TUD_RNDIS_PACKETS_PER_XFER * CFG_TUD_NET_MTU too large");
+
+CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t received[CFG_TUD_NET_RX_BUFCOUNT][NETD_XFER_SIZE];
+CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t transmitted[CFG_TUD_NET_TX_BUFCOUNT][NETD_XFER_SIZE];
 
 struct ecm_notify_struct
 {
@@ -104,17 +130,20 @@ CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static union
 // TODO remove CFG_TUSB_MEM_SECTION
 CFG_TUSB_MEM_SECTION static netd_interface_t _netd_itf;
 
-static bool can_xmit;
+static void rx_arm(void);
+static void rx_deliver(void);
 
 void tud_network_recv_renew(void)
 {
-  usbd_edpt_xfer(0, _netd_itf.ep_out, received, sizeof(received));
+  _netd_itf.rx_held = false;
+
+  rx_deliver();
+  rx_arm();
 }
 
-static void do_in_xfer(uint8_t *buf, uint16_t len)
+void netd_rndis_set_host_max_xfer(uint32_t max_xfer_size)
 {
-  can_xmit = false;
-  usbd_edpt_xfer(0, _netd_itf.ep_in, buf, len);
+  _netd_itf.rndis_host_max_xfer = max_xfer_size;
 }
 
 void netd_report(uint8_t *buf, uint16_t len)
@@ -214,11 +243,8 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
 
     tud_network_init_cb();
 
-    // we are ready to transmit a packet
-    can_xmit = true;
-
     // prepare for incoming packets
-    tud_network_recv_renew();
+    rx_arm();
   }
 
   drv_len += 2*sizeof(tusb_desc_endpoint_t);
@@ -279,8 +305,7 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
                 // TODO should be merge with RNDIS's after endpoint opened
                 // Also should have opposite callback for application to disable network !!
                 tud_network_init_cb();
-                can_xmit = true; // we are ready to transmit a packet
-                tud_network_recv_renew(); // prepare for incoming packets
+                rx_arm(); // prepare for incoming packets
               }
             }else
             {
@@ -348,43 +373,148 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
   return true;
 }
 
-static void handle_incoming_packet(uint32_t len)
+//--------------------------------------------------------------------+
+// Receive
+//--------------------------------------------------------------------+
+
+// Receive into next free buffer of the ring
+static void rx_arm(void)
 {
-  uint8_t *pnt = received;
-  uint32_t size = 0;
+  uint8_t const rhport = 0;
 
-  if (_netd_itf.ecm_mode)
+  if ( _netd_itf.ep_out && (_netd_itf.rx_count < CFG_TUD_NET_RX_BUFCOUNT) && !usbd_edpt_busy(rhport, _netd_itf.ep_out) )
   {
-    size = len;
+    uint8_t const idx = (uint8_t) ((_netd_itf.rx_head + _netd_itf.rx_count) % CFG_TUD_NET_RX_BUFCOUNT);
+    usbd_edpt_xfer(rhport, _netd_itf.ep_out, received[idx], NETD_XFER_SIZE);
   }
-  else
+}
+
+// Get next packet of oldest received buffer, return false if there is none left
+static bool rx_next_packet(uint8_t const ** p_packet, uint16_t* p_size)
+{
+  uint8_t const* buf = received[_netd_itf.rx_head];
+  uint16_t const len = _netd_itf.rx_len[_netd_itf.rx_head];
+  uint16_t const offset = _netd_itf.rx_offset;
+
+  if ( offset >= len ) return false;
+
+  if ( _netd_itf.ecm_mode )
   {
-    rndis_data_packet_t *r = (rndis_data_packet_t *) ((void*) pnt);
-    if (len >= sizeof(rndis_data_packet_t))
-      if ( (r->MessageType == REMOTE_NDIS_PACKET_MSG) && (r->MessageLength <= len))
-        if ( (r->DataOffset + offsetof(rndis_data_packet_t, DataOffset) + r->DataLength) <= len)
-        {
-          pnt = &received[r->DataOffset + offsetof(rndis_data_packet_t, DataOffset)];
-          size = r->DataLength;
-        }
+    // single frame per transfer
+    *p_packet = buf;
+    *p_size   = len;
+    _netd_itf.rx_offset = len;
+    return true;
+  }
+
+  // host can aggregate multiple packet messages into a transfer, aligned as advertised
+  rndis_data_packet_t const *r = (rndis_data_packet_t const *) ((void const*) (buf + offset));
+  uint32_t const remaining = (uint32_t) (len - offset);
+
+  if ( (remaining >= sizeof(rndis_data_packet_t)) && (r->MessageType == REMOTE_NDIS_PACKET_MSG) &&
+       (r->MessageLength >= sizeof(rndis_data_packet_t)) && (r->MessageLength <= remaining) &&
+       (r->DataOffset + offsetof(rndis_data_packet_t, DataOffset) + r->DataLength <= r->MessageLength) )
+  {
+    *p_packet = buf + offset + offsetof(rndis_data_packet_t, DataOffset) + r->DataOffset;
+    *p_size   = (uint16_t) r->DataLength;
+    _netd_itf.rx_offset = (uint16_t) (offset + r->MessageLength);
+    return true;
   }
 
-  if (!tud_network_recv_cb(pnt, (uint16_t) size))
+  // malformed, drop rest of transfer
+  _netd_itf.rx_offset = len;
+  return false;
+}
+
+// Pass received packets to application one at a time, release buffers once all their packets are consumed
+static void rx_deliver(void)
+{
+  // application may renew within tud_network_recv_cb()
+  if ( _netd_itf.rx_delivering ) return;
+  _netd_itf.rx_delivering = true;
+
+  while ( !_netd_itf.rx_held && _netd_itf.rx_count )
   {
-    /* if a buffer was never handled by user code, we must renew on the user's behalf */
-    tud_network_recv_renew();
+    uint8_t const* packet;
+    uint16_t size;
+
+    if ( rx_next_packet(&packet, &size) )
+    {
+      _netd_itf.rx_held = true;
+
+      // if a buffer was never handled by user code, we must renew on the user's behalf
+      if ( !tud_network_recv_cb(packet, size) ) _netd_itf.rx_held = false;
+    }else
+    {
+      _netd_itf.rx_head   = (uint8_t) ((_netd_itf.rx_head + 1) % CFG_TUD_NET_RX_BUFCOUNT);
+      _netd_itf.rx_count--;
+      _netd_itf.rx_offset = 0;
+
+      rx_arm();
+    }
+  }
+
+  _netd_itf.rx_delivering = false;
+}
+
+//--------------------------------------------------------------------+
+// Transmit
+//--------------------------------------------------------------------+
+
+// Check if buffer being filled has room for another packet
+static bool tx_fill_has_room(void)
+{
+  if ( _netd_itf.tx_count >= CFG_TUD_NET_TX_BUFCOUNT ) return false;
+  if ( _netd_itf.tx_fill_len == 0 ) return true;
+
+  // ECM sends one frame per transfer, RNDIS aggregates while IN endpoint is busy
+  if ( _netd_itf.ecm_mode ) return false;
+
+  uint32_t const max_xfer = _netd_itf.rndis_host_max_xfer ? tu_min32(_netd_itf.rndis_host_max_xfer, NETD_XFER_SIZE) : 0;
+
+  return (_netd_itf.tx_fill_packets < CFG_TUD_RNDIS_PACKETS_PER_XFER) &&
+         (_netd_itf.tx_fill_len + RNDIS_PACKET_MSG_SPACE(CFG_TUD_NET_MTU) <= max_xfer);
+}
+
+static void tx_fill_close(void)
+{
+  uint8_t const idx = (uint8_t) ((_netd_itf.tx_head + _netd_itf.tx_count) % CFG_TUD_NET_TX_BUFCOUNT);
+
+  _netd_itf.tx_len[idx] = _netd_itf.tx_fill_len;
+  _netd_itf.tx_count++;
+
+  _netd_itf.tx_fill_len     = 0;
+  _netd_itf.tx_fill_packets = 0;
+}
+
+// Send oldest closed buffer, or the one being filled if nothing else is pending
+static void tx_kick(void)
+{
+  if ( _netd_itf.tx_busy ) return;
+
+  if ( !_netd_itf.tx_count && _netd_itf.tx_fill_len ) tx_fill_close();
+
+  if ( _netd_itf.tx_count )
+  {
+    _netd_itf.tx_busy = true;
+    usbd_edpt_xfer(0, _netd_itf.ep_in, transmitted[_netd_itf.tx_head], _netd_itf.tx_len[_netd_itf.tx_head]);
   }
 }
 
 bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
-  (void) rhport;
   (void) result;
 
   /* new packet received */
   if ( ep_addr == _netd_itf.ep_out )
   {
-    handle_incoming_packet(xferred_bytes);
+    uint8_t const idx = (uint8_t) ((_netd_itf.rx_head + _netd_itf.rx_count) % CFG_TUD_NET_RX_BUFCOUNT);
+
+    _netd_itf.rx_len[idx] = (uint16_t) xferred_bytes;
+    _netd_itf.rx_count++;
+
+    rx_arm();
+    rx_deliver();
   }
 
   /* data transmission finished */
@@ -392,14 +522,21 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   {
     /* TinyUSB requires the class driver to implement ZLP (since ZLP usage is class-specific) */
 
-    if ( xferred_bytes && (0 == (xferred_bytes % CFG_TUD_NET_ENDPOINT_SIZE)) )
+    if ( !_netd_itf.tx_zlp && xferred_bytes && (0 == (xferred_bytes % CFG_TUD_NET_ENDPOINT_SIZE)) )
     {
-      do_in_xfer(NULL, 0); /* a ZLP is needed */
+      _netd_itf.tx_zlp = true;
+      usbd_edpt_xfer(rhport, _netd_itf.ep_in, NULL, 0); /* a ZLP is needed */
     }
     else
     {
-      /* we're finally finished */
-      can_xmit = true;
+      /* we're finally finished, release buffer and send what has been queued meanwhile */
+      _netd_itf.tx_zlp  = false;
+      _netd_itf.tx_busy = false;
+
+      _netd_itf.tx_head = (uint8_t) ((_netd_itf.tx_head + 1) % CFG_TUD_NET_TX_BUFCOUNT);
+      _netd_itf.tx_count--;
+
+      tx_kick();
     }
   }
 
@@ -415,33 +552,45 @@ bool tud_network_can_xmit(uint16_t size)
 {
   (void)size;
 
-  return can_xmit;
+  return _netd_itf.ep_in && tx_fill_has_room();
 }
 
 void tud_network_xmit(void *ref, uint16_t arg)
 {
-  uint8_t *data;
-  uint16_t len;
-
-  if (!can_xmit)
+  if (!tud_network_can_xmit(0))
     return;
 
-  len = (_netd_itf.ecm_mode) ? 0 : CFG_TUD_NET_PACKET_PREFIX_LEN;
-  data = transmitted + len;
+  uint8_t const idx = (uint8_t) ((_netd_itf.tx_head + _netd_itf.tx_count) % CFG_TUD_NET_TX_BUFCOUNT);
+  uint8_t *msg = transmitted[idx] + _netd_itf.tx_fill_len;
 
-  len += tud_network_xmit_cb(data, ref, arg);
-
-  if (!_netd_itf.ecm_mode)
+  if (_netd_itf.ecm_mode)
   {
-    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) transmitted);
+    _netd_itf.tx_fill_len = tud_network_xmit_cb(msg, ref, arg);
+  }
+  else
+  {
+    uint16_t const len = tud_network_xmit_cb(msg + CFG_TUD_NET_PACKET_PREFIX_LEN, ref, arg);
+
+    // when aggregating, pad message so that the next one appended is aligned as well
+    uint32_t const msg_len = (CFG_TUD_RNDIS_PACKETS_PER_XFER > 1) ? ((CFG_TUD_NET_PACKET_PREFIX_LEN + len + 3u) & ~3u)
+                                                                  : (CFG_TUD_NET_PACKET_PREFIX_LEN + len);
+
+    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) msg);
     memset(hdr, 0, sizeof(rndis_data_packet_t));
     hdr->MessageType = REMOTE_NDIS_PACKET_MSG;
-    hdr->MessageLength = len;
+    hdr->MessageLength = msg_len;
     hdr->DataOffset = sizeof(rndis_data_packet_t) - offsetof(rndis_data_packet_t, DataOffset);
-    hdr->DataLength = len - sizeof(rndis_data_packet_t);
+    hdr->DataLength = len;
+
+    _netd_itf.tx_fill_len = (uint16_t) (_netd_itf.tx_fill_len + msg_len);
   }
 
-  do_in_xfer(transmitted, len);
+  _netd_itf.tx_fill_packets++;
+
+  // close buffer once it can not take another packet
+  if (!tx_fill_has_room()) tx_fill_close();
+
+  tx_kick();
 }
 
 #endif
@@ -62,6 +62,100 @@ typedef enum
   NCM_SET_CRC_MODE                                 = 0x8A,
 } ncm_request_code_t;
 
+// Network Transfer Block signatures (NCM 1.0 Table 3-1, 3-2, 3-3, 3-4)
+#define NTH16_SIGNATURE      0x484D434E
+#define NDP16_SIGNATURE_NCM0 0x304D434E
+#define NDP16_SIGNATURE_NCM1 0x314D434E
+#define NTH32_SIGNATURE      0x686D636E
+#define NDP32_SIGNATURE_NCM0 0x306D636E
+#define NDP32_SIGNATURE_NCM1 0x316D636E
+
+// NTB format selected by SET_NTB_FORMAT (NCM 1.0 Section 6.2.5)
+typedef enum
+{
+  NCM_NTB_FORMAT_16 = 0x00,
+  NCM_NTB_FORMAT_32 = 0x01,
+} ncm_ntb_format_t;
+
+// bmNtbFormatsSupported of NTB parameters
+enum
+{
+  NCM_NTB_FORMATS_SUPPORTED_16 = TU_BIT(0),
+  NCM_NTB_FORMATS_SUPPORTED_32 = TU_BIT(1),
+};
+
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t wLength;
+  uint16_t bmNtbFormatsSupported;
+  uint32_t dwNtbInMaxSize;
+  uint16_t wNdbInDivisor;
+  uint16_t wNdbInPayloadRemainder;
+  uint16_t wNdbInAlignment;
+  uint16_t wReserved;
+  uint32_t dwNtbOutMaxSize;
+  uint16_t wNdbOutDivisor;
+  uint16_t wNdbOutPayloadRemainder;
+  uint16_t wNdbOutAlignment;
+  uint16_t wNtbOutMaxDatagrams;
+} ntb_parameters_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwSignature;
+  uint16_t wHeaderLength;
+  uint16_t wSequence;
+  uint16_t wBlockLength;
+  uint16_t wNdpIndex;
+} nth16_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t wDatagramIndex;
+  uint16_t wDatagramLength;
+} ndp16_datagram_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwSignature;
+  uint16_t wLength;
+  uint16_t wNextNdpIndex;
+  ndp16_datagram_t datagram[];
+} ndp16_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwSignature;
+  uint16_t wHeaderLength;
+  uint16_t wSequence;
+  uint32_t dwBlockLength;
+  uint32_t dwNdpIndex;
+} nth32_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwDatagramIndex;
+  uint32_t dwDatagramLength;
+} ndp32_datagram_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwSignature;
+  uint16_t wLength;
+  uint16_t wReserved6;
+  uint32_t dwNextNdpIndex;
+  uint32_t dwReserved12;
+  ndp32_datagram_t datagram[];
+} ndp32_t;
+
+// Data of SET_NTB_INPUT_SIZE / GET_NTB_INPUT_SIZE, wNtbInMaxDatagrams is optional (NCM 1.0 Table 6-5)
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t dwNtbInMaxSize;
+  uint16_t wNtbInMaxDatagrams;
+  uint16_t wReserved;
+} ntb_input_size_t;
+
 #ifdef __cplusplus
  }
 #endif
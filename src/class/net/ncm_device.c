@@ -38,54 +38,35 @@
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
 
-#define NTH16_SIGNATURE      0x484D434E
-#define NDP16_SIGNATURE_NCM0 0x304D434E
-#define NDP16_SIGNATURE_NCM1 0x314D434E
+TU_VERIFY_STATIC(CFG_TUD_NCM_NTB32 || (CFG_TUD_NCM_IN_NTB_MAX_SIZE <= 0xFFFF && CFG_TUD_NCM_OUT_NTB_MAX_SIZE <= 0xFFFF),
+                 "NTB size above 64 KiB requires CFG_TUD_NCM_NTB32");
+
+// NTB headers, the host can select the larger 32-bit format when supported
+#if CFG_TUD_NCM_NTB32
+  #define NCM_NTB_HEADER_MAX(_n)  (sizeof(nth32_t) + sizeof(ndp32_t) + ((_n) + 1) * sizeof(ndp32_datagram_t))
+#else
+  #define NCM_NTB_HEADER_MAX(_n)  (sizeof(nth16_t) + sizeof(ndp16_t) + ((_n) + 1) * sizeof(ndp16_datagram_t))
+#endif
 
-typedef struct TU_ATTR_PACKED
-{
-  uint16_t wLength;
-  uint16_t bmNtbFormatsSupported;
-  uint32_t dwNtbInMaxSize;
-  uint16_t wNdbInDivisor;
-  uint16_t wNdbInPayloadRemainder;
-  uint16_t wNdbInAlignment;
-  uint16_t wReserved;
-  uint32_t dwNtbOutMaxSize;
-  uint16_t wNdbOutDivisor;
-  uint16_t wNdbOutPayloadRemainder;
-  uint16_t wNdbOutAlignment;
-  uint16_t wNtbOutMaxDatagrams;
-} ntb_parameters_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint32_t dwSignature;
-  uint16_t wHeaderLength;
-  uint16_t wSequence;
-  uint16_t wBlockLength;
-  uint16_t wNdpIndex;
-} nth16_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint16_t wDatagramIndex;
-  uint16_t wDatagramLength;
-} ndp16_datagram_t;
+TU_VERIFY_STATIC(CFG_TUD_NCM_IN_NTB_MAX_SIZE >= NCM_NTB_HEADER_MAX(CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB) + CFG_TUD_NET_MTU,
+                 "CFG_TUD_NCM_IN_NTB_MAX_SIZE too small for CFG_TUD_NET_MTU");
 
-typedef struct TU_ATTR_PACKED
+enum
 {
-  uint32_t dwSignature;
-  uint16_t wLength;
-  uint16_t wNextNdpIndex;
-  ndp16_datagram_t datagram[];
-} ndp16_t;
+  // Largest transfer submitted at once, NTBs bigger than this are sent/received in several transfers.
+  // Multiple of packet size.
+  NCM_XFER_MAX = 0xFE00
+};
 
 typedef union TU_ATTR_PACKED {
   struct {
     nth16_t nth;
     ndp16_t ndp;
   };
+  struct {
+    nth32_t nth32;
+    ndp32_t ndp32;
+  };
   uint8_t data[CFG_TUD_NCM_IN_NTB_MAX_SIZE];
 } transmit_ntb_t;
 
@@ -103,9 +84,14 @@ typedef struct
   uint8_t ep_notif;
   uint8_t ep_in;
   uint8_t ep_out;
+  uint16_t ep_in_mps;
+
+  uint8_t ntb_format;             // ncm_ntb_format_t selected by host, NTB-16 after reset
 
-  const ndp16_t *ndp;
-  uint8_t num_datagrams, current_datagram_index;
+  const uint8_t *ndp;             // NDP16 or NDP32 of received NTB depending on ntb_format
+  uint16_t num_datagrams, current_datagram_index;
+  uint32_t rx_len;                // Bytes of NTB received so far
+  uint16_t rx_chunk;              // Size of transfer submitted to OUT endpoint
 
   enum {
     REPORT_SPEED,
@@ -116,23 +102,38 @@ typedef struct
 
   uint8_t  current_ntb;           // Index in transmit_ntb[] that is currently being filled with datagrams
   uint8_t  datagram_count;        // Number of datagrams in transmit_ntb[current_ntb]
-  uint16_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
-  uint16_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
+  uint32_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
+  uint32_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
   uint8_t  max_datagrams_per_ntb; // Maximum number of datagrams per NTB; initially CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB
 
   uint16_t nth_sequence;          // Sequence number counter for transmitted NTBs
 
   bool transferring;
+  bool tx_zlp;                    // ZLP terminating the NTB has been queued
+  uint8_t  tx_ntb;                // Index in transmit_ntb[] that is being sent
+  uint32_t tx_total;              // Length of NTB being sent
+  uint32_t tx_sent;               // Bytes of NTB sent so far
+
+  ntb_input_size_t ntb_input_size; // Data stage of SET_NTB_INPUT_SIZE / GET_NTB_INPUT_SIZE
+
+  //------------- From this point, data is not cleared by bus reset -------------//
+
+  // Endpoint Transfer buffers
+  CFG_TUSB_MEM_ALIGN struct ecm_notify_struct notify;
+  CFG_TUSB_MEM_ALIGN transmit_ntb_t transmit_ntb[2];
+  CFG_TUSB_MEM_ALIGN uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
 
 } ncm_interface_t;
 
+#define ITF_MEM_RESET_SIZE   offsetof(ncm_interface_t, notify)
+
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
 
 CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static const ntb_parameters_t ntb_parameters = {
     .wLength                 = sizeof(ntb_parameters_t),
-    .bmNtbFormatsSupported   = 0x01,
+    .bmNtbFormatsSupported   = NCM_NTB_FORMATS_SUPPORTED_16 | (CFG_TUD_NCM_NTB32 ? NCM_NTB_FORMATS_SUPPORTED_32 : 0),
     .dwNtbInMaxSize          = CFG_TUD_NCM_IN_NTB_MAX_SIZE,
     .wNdbInDivisor           = 4,
     .wNdbInPayloadRemainder  = 0,
@@ -145,58 +146,156 @@ CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static const ntb_parameters_t ntb_parame
     .wNtbOutMaxDatagrams     = 0
 };
 
-CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static transmit_ntb_t transmit_ntb[2];
+CFG_TUSB_MEM_SECTION static ncm_interface_t ncm_interface[CFG_TUD_NCM];
 
-CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
+static inline uint8_t ncm_get_index(ncm_interface_t const* ncm) {
+  return (uint8_t) (ncm - ncm_interface);
+}
 
-static ncm_interface_t ncm_interface;
+//------------- Application callbacks, indexed when there are multiple instances -------------//
+static inline bool ncm_recv_cb(ncm_interface_t const* ncm, const uint8_t *src, uint16_t size) {
+#if CFG_TUD_NCM > 1
+  return tud_network_n_recv_cb(ncm_get_index(ncm), src, size);
+#else
+  (void) ncm;
+  return tud_network_recv_cb(src, size);
+#endif
+}
+
+static inline uint16_t ncm_xmit_cb(ncm_interface_t const* ncm, uint8_t *dst, void *ref, uint16_t arg) {
+#if CFG_TUD_NCM > 1
+  return tud_network_n_xmit_cb(ncm_get_index(ncm), dst, ref, arg);
+#else
+  (void) ncm;
+  return tud_network_xmit_cb(dst, ref, arg);
+#endif
+}
+
+static inline void ncm_link_state_cb(ncm_interface_t const* ncm, bool state) {
+#if CFG_TUD_NCM > 1
+  tud_network_n_link_state_cb(ncm_get_index(ncm), state);
+#else
+  (void) ncm;
+  tud_network_link_state_cb(state);
+#endif
+}
 
 /*
  * Set up the NTB state in ncm_interface to be ready to add datagrams.
  */
-static void ncm_prepare_for_tx(void) {
-  ncm_interface.datagram_count = 0;
+static void ncm_prepare_for_tx(ncm_interface_t* ncm) {
+  ncm->datagram_count = 0;
   // datagrams start after all the headers
-  ncm_interface.next_datagram_offset = sizeof(nth16_t) + sizeof(ndp16_t)
-      + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t));
+  if (ncm->ntb_format == NCM_NTB_FORMAT_32) {
+    ncm->next_datagram_offset = sizeof(nth32_t) + sizeof(ndp32_t)
+        + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp32_datagram_t));
+  } else {
+    ncm->next_datagram_offset = sizeof(nth16_t) + sizeof(ndp16_t)
+        + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t));
+  }
+}
+
+/*
+ * Set maximum size of transmitted NTBs, limited by buffer size and the NTB format.
+ */
+static void ncm_set_ntb_in_size(ncm_interface_t* ncm, uint32_t size) {
+  size = tu_min32(size, CFG_TUD_NCM_IN_NTB_MAX_SIZE);
+  if (ncm->ntb_format == NCM_NTB_FORMAT_16) {
+    size = tu_min32(size, 0xFFFF);
+  }
+  ncm->ntb_in_size = size;
+}
+
+/*
+ * Send next part of the NTB being transmitted.
+ */
+static void ncm_tx_next_chunk(ncm_interface_t* ncm) {
+  uint32_t const remaining = ncm->tx_total - ncm->tx_sent;
+  usbd_edpt_xfer(0, ncm->ep_in, ncm->transmit_ntb[ncm->tx_ntb].data + ncm->tx_sent,
+                 (uint16_t) tu_min32(remaining, NCM_XFER_MAX));
+}
+
+/*
+ * Receive (next part of) an NTB into receive_ntb.
+ */
+static void ncm_rx_arm(ncm_interface_t* ncm) {
+  ncm->rx_chunk = (uint16_t) tu_min32(sizeof(ncm->receive_ntb) - ncm->rx_len, NCM_XFER_MAX);
+  usbd_edpt_xfer(0, ncm->ep_out, ncm->receive_ntb + ncm->rx_len, ncm->rx_chunk);
+}
+
+/*
+ * Get index and length of a datagram from the NDP of the received NTB.
+ */
+static void ncm_rx_datagram(ncm_interface_t const* ncm, uint16_t i, uint32_t *index, uint32_t *length) {
+  if (ncm->ntb_format == NCM_NTB_FORMAT_32) {
+    const ndp32_t *ndp = (const ndp32_t *) ncm->ndp;
+    *index  = ndp->datagram[i].dwDatagramIndex;
+    *length = ndp->datagram[i].dwDatagramLength;
+  } else {
+    const ndp16_t *ndp = (const ndp16_t *) ncm->ndp;
+    *index  = ndp->datagram[i].wDatagramIndex;
+    *length = ndp->datagram[i].wDatagramLength;
+  }
 }
 
 /*
  * If not already transmitting, start sending the current NTB to the host and swap buffers
  * to start filling the other one with datagrams.
  */
-static void ncm_start_tx(void) {
-  if (ncm_interface.transferring) {
+static void ncm_start_tx(ncm_interface_t* ncm) {
+  if (ncm->transferring) {
     return;
   }
 
-  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t ntb_length = ncm_interface.next_datagram_offset;
-
-  // Fill in NTB header
-  ntb->nth.dwSignature = NTH16_SIGNATURE;
-  ntb->nth.wHeaderLength = sizeof(nth16_t);
-  ntb->nth.wSequence = ncm_interface.nth_sequence++;
-  ntb->nth.wBlockLength = ntb_length;
-  ntb->nth.wNdpIndex = sizeof(nth16_t);
-
-  // Fill in NDP16 header and terminator
-  ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
-  ntb->ndp.wLength = sizeof(ndp16_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp16_datagram_t);
-  ntb->ndp.wNextNdpIndex = 0;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = 0;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = 0;
+  transmit_ntb_t *ntb = &ncm->transmit_ntb[ncm->current_ntb];
+  uint32_t ntb_length = ncm->next_datagram_offset;
+
+  if (ncm->ntb_format == NCM_NTB_FORMAT_32) {
+    // Fill in NTB header
+    ntb->nth32.dwSignature = NTH32_SIGNATURE;
+    ntb->nth32.wHeaderLength = sizeof(nth32_t);
+    ntb->nth32.wSequence = ncm->nth_sequence++;
+    ntb->nth32.dwBlockLength = ntb_length;
+    ntb->nth32.dwNdpIndex = sizeof(nth32_t);
+
+    // Fill in NDP32 header and terminator
+    ntb->ndp32.dwSignature = NDP32_SIGNATURE_NCM0;
+    ntb->ndp32.wLength = (uint16_t) (sizeof(ndp32_t) + (ncm->datagram_count + 1) * sizeof(ndp32_datagram_t));
+    ntb->ndp32.wReserved6 = 0;
+    ntb->ndp32.dwNextNdpIndex = 0;
+    ntb->ndp32.dwReserved12 = 0;
+    ntb->ndp32.datagram[ncm->datagram_count].dwDatagramIndex = 0;
+    ntb->ndp32.datagram[ncm->datagram_count].dwDatagramLength = 0;
+  } else {
+    // Fill in NTB header
+    ntb->nth.dwSignature = NTH16_SIGNATURE;
+    ntb->nth.wHeaderLength = sizeof(nth16_t);
+    ntb->nth.wSequence = ncm->nth_sequence++;
+    ntb->nth.wBlockLength = (uint16_t) ntb_length;
+    ntb->nth.wNdpIndex = sizeof(nth16_t);
+
+    // Fill in NDP16 header and terminator
+    ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
+    ntb->ndp.wLength = sizeof(ndp16_t) + (ncm->datagram_count + 1) * sizeof(ndp16_datagram_t);
+    ntb->ndp.wNextNdpIndex = 0;
+    ntb->ndp.datagram[ncm->datagram_count].wDatagramIndex = 0;
+    ntb->ndp.datagram[ncm->datagram_count].wDatagramLength = 0;
+  }
 
   // Kick off an endpoint transfer
-  usbd_edpt_xfer(0, ncm_interface.ep_in, ntb->data, ntb_length);
-  ncm_interface.transferring = true;
+  ncm->tx_ntb = ncm->current_ntb;
+  ncm->tx_total = ntb_length;
+  ncm->tx_sent = 0;
+  ncm->tx_zlp = false;
+  ncm_tx_next_chunk(ncm);
+  ncm->transferring = true;
 
   // Swap to the other NTB and clear it out
-  ncm_interface.current_ntb = 1 - ncm_interface.current_ntb;
-  ncm_prepare_for_tx();
+  ncm->current_ntb = 1 - ncm->current_ntb;
+  ncm_prepare_for_tx(ncm);
 }
 
-static struct ecm_notify_struct ncm_notify_connected =
+static const struct ecm_notify_struct ncm_notify_connected =
 {
     .header = {
         .bmRequestType_bit = {
@@ -210,7 +309,7 @@ static struct ecm_notify_struct ncm_notify_connected =
     },
 };
 
-static struct ecm_notify_struct ncm_notify_speed_change =
+static const struct ecm_notify_struct ncm_notify_speed_change =
 {
     .header = {
         .bmRequestType_bit = {
@@ -225,20 +324,28 @@ static struct ecm_notify_struct ncm_notify_speed_change =
     .uplink = 10000000,
 };
 
-void tud_network_recv_renew(void)
+void tud_network_n_recv_renew(uint8_t idx)
 {
-  if (!ncm_interface.num_datagrams)
+  TU_VERIFY(idx < CFG_TUD_NCM, );
+  ncm_interface_t* ncm = &ncm_interface[idx];
+
+  if (!ncm->num_datagrams)
   {
-    usbd_edpt_xfer(0, ncm_interface.ep_out, receive_ntb, sizeof(receive_ntb));
+    ncm_rx_arm(ncm);
     return;
   }
 
-  const ndp16_t *ndp = ncm_interface.ndp;
-  const int i = ncm_interface.current_datagram_index;
-  ncm_interface.current_datagram_index++;
-  ncm_interface.num_datagrams--;
+  uint32_t index, length;
+  ncm_rx_datagram(ncm, ncm->current_datagram_index, &index, &length);
+  ncm->current_datagram_index++;
+  ncm->num_datagrams--;
 
-  tud_network_recv_cb(receive_ntb + ndp->datagram[i].wDatagramIndex, ndp->datagram[i].wDatagramLength);
+  ncm_recv_cb(ncm, ncm->receive_ntb + index, (uint16_t) length);
+}
+
+void tud_network_recv_renew(void)
+{
+  tud_network_n_recv_renew(0);
 }
 
 //--------------------------------------------------------------------+
@@ -247,10 +354,15 @@ void tud_network_recv_renew(void)
 
 void netd_init(void)
 {
-  tu_memclr(&ncm_interface, sizeof(ncm_interface));
-  ncm_interface.ntb_in_size = CFG_TUD_NCM_IN_NTB_MAX_SIZE;
-  ncm_interface.max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB;
-  ncm_prepare_for_tx();
+  for (uint8_t i = 0; i < CFG_TUD_NCM; i++)
+  {
+    ncm_interface_t* ncm = &ncm_interface[i];
+
+    tu_memclr(ncm, ITF_MEM_RESET_SIZE);
+    ncm_set_ntb_in_size(ncm, CFG_TUD_NCM_IN_NTB_MAX_SIZE);
+    ncm->max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB;
+    ncm_prepare_for_tx(ncm);
+  }
 }
 
 void netd_reset(uint8_t rhport)
@@ -262,11 +374,23 @@ void netd_reset(uint8_t rhport)
 
 uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len)
 {
-  // confirm interface hasn't already been allocated
-  TU_ASSERT(0 == ncm_interface.ep_notif, 0);
+  TU_VERIFY(TUSB_CLASS_CDC == itf_desc->bInterfaceClass &&
+            CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL == itf_desc->bInterfaceSubClass, 0);
+
+  // Find available interface
+  ncm_interface_t* ncm = NULL;
+  for (uint8_t i = 0; i < CFG_TUD_NCM; i++)
+  {
+    if (0 == ncm_interface[i].ep_in && 0 == ncm_interface[i].ep_notif)
+    {
+      ncm = &ncm_interface[i];
+      break;
+    }
+  }
+  TU_ASSERT(ncm, 0);
 
   //------------- Management Interface -------------//
-  ncm_interface.itf_num = itf_desc->bInterfaceNumber;
+  ncm->itf_num = itf_desc->bInterfaceNumber;
 
   uint16_t drv_len = sizeof(tusb_desc_interface_t);
   uint8_t const * p_desc = tu_desc_next( itf_desc );
@@ -283,7 +407,7 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   {
     TU_ASSERT( usbd_edpt_open(rhport, (tusb_desc_endpoint_t const *) p_desc), 0 );
 
-    ncm_interface.ep_notif = ((tusb_desc_endpoint_t const *) p_desc)->bEndpointAddress;
+    ncm->ep_notif = ((tusb_desc_endpoint_t const *) p_desc)->bEndpointAddress;
 
     drv_len += tu_desc_len(p_desc);
     p_desc   = tu_desc_next(p_desc);
@@ -307,26 +431,37 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   // Pair of endpoints
   TU_ASSERT(TUSB_DESC_ENDPOINT == tu_desc_type(p_desc), 0);
 
-  TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &ncm_interface.ep_out, &ncm_interface.ep_in) );
+  TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &ncm->ep_out, &ncm->ep_in) );
+
+  // packet size of IN endpoint to terminate NTBs with ZLP
+  for (uint8_t i = 0; i < 2; i++) {
+    tusb_desc_endpoint_t const * desc_ep = (tusb_desc_endpoint_t const *) p_desc;
+    if (desc_ep->bEndpointAddress == ncm->ep_in) {
+      ncm->ep_in_mps = tu_edpt_packet_size(desc_ep);
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
 
   drv_len += 2*sizeof(tusb_desc_endpoint_t);
 
   return drv_len;
 }
 
-static void ncm_report(void)
+static void ncm_report(ncm_interface_t* ncm)
 {
   uint8_t const rhport = 0;
-  if (ncm_interface.report_state == REPORT_SPEED) {
-    ncm_notify_speed_change.header.wIndex = ncm_interface.itf_num;
-    usbd_edpt_xfer(rhport, ncm_interface.ep_notif, (uint8_t *) &ncm_notify_speed_change, sizeof(ncm_notify_speed_change));
-    ncm_interface.report_state = REPORT_CONNECTED;
-    ncm_interface.report_pending = true;
-  } else if (ncm_interface.report_state == REPORT_CONNECTED) {
-    ncm_notify_connected.header.wIndex = ncm_interface.itf_num;
-    usbd_edpt_xfer(rhport, ncm_interface.ep_notif, (uint8_t *) &ncm_notify_connected, sizeof(ncm_notify_connected));
-    ncm_interface.report_state = REPORT_DONE;
-    ncm_interface.report_pending = true;
+  if (ncm->report_state == REPORT_SPEED) {
+    ncm->notify = ncm_notify_speed_change;
+    ncm->notify.header.wIndex = ncm->itf_num;
+    usbd_edpt_xfer(rhport, ncm->ep_notif, (uint8_t *) &ncm->notify, sizeof(ncm->notify));
+    ncm->report_state = REPORT_CONNECTED;
+    ncm->report_pending = true;
+  } else if (ncm->report_state == REPORT_CONNECTED) {
+    ncm->notify = ncm_notify_connected;
+    ncm->notify.header.wIndex = ncm->itf_num;
+    usbd_edpt_xfer(rhport, ncm->ep_notif, (uint8_t *) &ncm->notify, sizeof(ncm->notify));
+    ncm->report_state = REPORT_DONE;
+    ncm->report_pending = true;
   }
 }
 
@@ -335,10 +470,42 @@ TU_ATTR_WEAK void tud_network_link_state_cb(bool state)
   (void)state;
 }
 
+TU_ATTR_WEAK void tud_network_n_link_state_cb(uint8_t idx, bool state)
+{
+  (void)idx;
+  (void)state;
+}
+
+// Find instance owning the management or data interface
+static ncm_interface_t* ncm_find_by_itf(uint8_t itf_num)
+{
+  for (uint8_t i = 0; i < CFG_TUD_NCM; i++)
+  {
+    ncm_interface_t* ncm = &ncm_interface[i];
+    if ((ncm->ep_in || ncm->ep_notif) && (ncm->itf_num == itf_num || ncm->itf_num + 1 == itf_num)) return ncm;
+  }
+  return NULL;
+}
+
 // Handle class control request
 // return false to stall control endpoint (e.g unsupported request)
 bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
+  ncm_interface_t* ncm = ncm_find_by_itf((uint8_t) request->wIndex);
+  TU_VERIFY(ncm);
+
+  // apply NTB input size once received
+  if ( stage == CONTROL_STAGE_DATA && request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
+       request->bRequest == NCM_SET_NTB_INPUT_SIZE )
+  {
+    // must be at least 2048 and not more than dwNtbInMaxSize (NCM 1.0 Section 6.2.7)
+    uint32_t const size = ncm->ntb_input_size.dwNtbInMaxSize;
+    TU_VERIFY(size >= 2048 && size <= CFG_TUD_NCM_IN_NTB_MAX_SIZE);
+
+    ncm_set_ntb_in_size(ncm, size);
+    return true;
+  }
+
   if ( stage != CONTROL_STAGE_SETUP ) return true;
 
   switch ( request->bmRequestType_bit.type )
@@ -349,9 +516,9 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
         case TUSB_REQ_GET_INTERFACE:
         {
           uint8_t const req_itfnum = (uint8_t) request->wIndex;
-          TU_VERIFY(ncm_interface.itf_num + 1 == req_itfnum);
+          TU_VERIFY(ncm->itf_num + 1 == req_itfnum);
 
-          tud_control_xfer(rhport, request, &ncm_interface.itf_data_alt, 1);
+          tud_control_xfer(rhport, request, &ncm->itf_data_alt, 1);
         }
           break;
 
@@ -361,21 +528,21 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
           uint8_t const req_alt    = (uint8_t) request->wValue;
 
           // Only valid for Data Interface with Alternate is either 0 or 1
-          TU_VERIFY(ncm_interface.itf_num + 1 == req_itfnum && req_alt < 2);
+          TU_VERIFY(ncm->itf_num + 1 == req_itfnum && req_alt < 2);
 
-          if (req_alt != ncm_interface.itf_data_alt) {
-            ncm_interface.itf_data_alt = req_alt;
+          if (req_alt != ncm->itf_data_alt) {
+            ncm->itf_data_alt = req_alt;
 
-            if (ncm_interface.itf_data_alt) {
-              if (!usbd_edpt_busy(rhport, ncm_interface.ep_out)) {
-                tud_network_recv_renew(); // prepare for incoming datagrams
+            if (ncm->itf_data_alt) {
+              if (!usbd_edpt_busy(rhport, ncm->ep_out)) {
+                tud_network_n_recv_renew(ncm_get_index(ncm)); // prepare for incoming datagrams
               }
-              if (!ncm_interface.report_pending) {
-                ncm_report();
+              if (!ncm->report_pending) {
+                ncm_report(ncm);
               }
             }
 
-            tud_network_link_state_cb(ncm_interface.itf_data_alt);
+            ncm_link_state_cb(ncm, ncm->itf_data_alt);
           }
 
           tud_control_status(rhport, request);
@@ -388,11 +555,46 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
       break;
 
     case TUSB_REQ_TYPE_CLASS:
-      TU_VERIFY (ncm_interface.itf_num == request->wIndex);
+      TU_VERIFY (ncm->itf_num == request->wIndex);
 
-      if (NCM_GET_NTB_PARAMETERS == request->bRequest)
+      switch ( request->bRequest )
       {
-        tud_control_xfer(rhport, request, (void*)(uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
+        case NCM_GET_NTB_PARAMETERS:
+          tud_control_xfer(rhport, request, (void*)(uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
+          break;
+
+        case NCM_GET_NTB_FORMAT:
+          tud_control_xfer(rhport, request, &ncm->ntb_format, 1);
+          break;
+
+        case NCM_SET_NTB_FORMAT:
+        {
+          uint8_t const format = (uint8_t) request->wValue;
+
+          // format can only be changed while data interface is inactive
+          TU_VERIFY(ncm->itf_data_alt == 0);
+          TU_VERIFY(format == NCM_NTB_FORMAT_16 || (CFG_TUD_NCM_NTB32 && format == NCM_NTB_FORMAT_32));
+
+          ncm->ntb_format = format;
+          ncm_set_ntb_in_size(ncm, CFG_TUD_NCM_IN_NTB_MAX_SIZE);
+          ncm_prepare_for_tx(ncm);
+
+          tud_control_status(rhport, request);
+        }
+          break;
+
+        case NCM_GET_NTB_INPUT_SIZE:
+          ncm->ntb_input_size.dwNtbInMaxSize = ncm->ntb_in_size;
+          tud_control_xfer(rhport, request, &ncm->ntb_input_size, 4);
+          break;
+
+        case NCM_SET_NTB_INPUT_SIZE:
+          // 4 bytes or 8 bytes with wNtbInMaxDatagrams which is ignored
+          TU_VERIFY(request->wLength == 4 || request->wLength == 8);
+          tud_control_xfer(rhport, request, &ncm->ntb_input_size, sizeof(ntb_input_size_t));
+          break;
+
+        default: break;
       }
 
       break;
@@ -404,81 +606,142 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
   return true;
 }
 
-static void handle_incoming_datagram(uint32_t len)
+static void handle_incoming_datagram(ncm_interface_t* ncm, uint32_t len)
 {
   uint32_t size = len;
+  int num_datagrams;
 
   if (len == 0) {
     return;
   }
 
-  TU_ASSERT(size >= sizeof(nth16_t), );
+  if (ncm->ntb_format == NCM_NTB_FORMAT_32) {
+    TU_ASSERT(size >= sizeof(nth32_t), );
+
+    const nth32_t *hdr = (const nth32_t *)ncm->receive_ntb;
+    TU_ASSERT(hdr->dwSignature == NTH32_SIGNATURE, );
+    TU_ASSERT(hdr->dwNdpIndex >= sizeof(nth32_t) && hdr->dwNdpIndex <= len - sizeof(ndp32_t), );
+
+    const ndp32_t *ndp = (const ndp32_t *)(ncm->receive_ntb + hdr->dwNdpIndex);
+    TU_ASSERT(ndp->dwSignature == NDP32_SIGNATURE_NCM0 || ndp->dwSignature == NDP32_SIGNATURE_NCM1, );
+    TU_ASSERT(ndp->wLength >= sizeof(ndp32_t) && hdr->dwNdpIndex + ndp->wLength <= len, );
 
-  const nth16_t *hdr = (const nth16_t *)receive_ntb;
-  TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE, );
-  TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len, );
+    num_datagrams = (ndp->wLength - sizeof(ndp32_t)) / sizeof(ndp32_datagram_t);
+    ncm->ndp = (const uint8_t *) ndp;
+  } else {
+    TU_ASSERT(size >= sizeof(nth16_t), );
 
-  const ndp16_t *ndp = (const ndp16_t *)(receive_ntb + hdr->wNdpIndex);
-  TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1, );
-  TU_ASSERT(hdr->wNdpIndex + ndp->wLength <= len, );
+    const nth16_t *hdr = (const nth16_t *)ncm->receive_ntb;
+    TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE, );
+    TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len, );
 
-  int num_datagrams = (ndp->wLength - 12) / 4;
-  ncm_interface.current_datagram_index = 0;
-  ncm_interface.num_datagrams = 0;
-  ncm_interface.ndp = ndp;
-  for (int i = 0; i < num_datagrams && ndp->datagram[i].wDatagramIndex && ndp->datagram[i].wDatagramLength; i++)
+    const ndp16_t *ndp = (const ndp16_t *)(ncm->receive_ntb + hdr->wNdpIndex);
+    TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1, );
+    TU_ASSERT(hdr->wNdpIndex + ndp->wLength <= len, );
+
+    num_datagrams = (ndp->wLength - 12) / 4;
+    ncm->ndp = (const uint8_t *) ndp;
+  }
+
+  ncm->current_datagram_index = 0;
+  ncm->num_datagrams = 0;
+  for (int i = 0; i < num_datagrams; i++)
   {
-    ncm_interface.num_datagrams++;
+    uint32_t index, length;
+    ncm_rx_datagram(ncm, (uint16_t) i, &index, &length);
+
+    // list is terminated by a null entry, stop at datagrams outside of the received NTB as well
+    if (!index || !length || length > 0xFFFF || index > len || length > len - index) break;
+
+    ncm->num_datagrams++;
   }
   
-  tud_network_recv_renew();
+  tud_network_n_recv_renew(ncm_get_index(ncm));
 }
 
 bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
-  (void) rhport;
   (void) result;
 
+  ncm_interface_t* ncm = NULL;
+  for (uint8_t i = 0; i < CFG_TUD_NCM; i++)
+  {
+    if (ep_addr == ncm_interface[i].ep_in || ep_addr == ncm_interface[i].ep_out || ep_addr == ncm_interface[i].ep_notif)
+    {
+      ncm = &ncm_interface[i];
+      break;
+    }
+  }
+  TU_ASSERT(ncm);
+
   /* new datagram receive_ntb */
-  if (ep_addr == ncm_interface.ep_out )
+  if (ep_addr == ncm->ep_out )
   {
-    handle_incoming_datagram(xferred_bytes);
+    ncm->rx_len += xferred_bytes;
+
+    // NTB larger than one transfer continues until short packet or buffer is full
+    if (xferred_bytes == ncm->rx_chunk && ncm->rx_len < sizeof(ncm->receive_ntb)) {
+      ncm_rx_arm(ncm);
+    } else {
+      uint32_t const len = ncm->rx_len;
+      ncm->rx_len = 0;
+      handle_incoming_datagram(ncm, len);
+    }
   }
 
   /* data transmission finished */
-  if (ep_addr == ncm_interface.ep_in )
+  if (ep_addr == ncm->ep_in )
   {
-    if (ncm_interface.transferring) {
-      ncm_interface.transferring = false;
+    ncm->tx_sent += xferred_bytes;
+
+    if (ncm->transferring && ncm->tx_sent < ncm->tx_total) {
+      // rest of NTB
+      ncm_tx_next_chunk(ncm);
+      return true;
+    }
+
+    // NTB shorter than host's NTB input size ending on packet boundary is terminated by ZLP
+    if (ncm->transferring && !ncm->tx_zlp && ncm->ep_in_mps &&
+        ncm->tx_total < ncm->ntb_in_size && 0 == (ncm->tx_total % ncm->ep_in_mps)) {
+      ncm->tx_zlp = true;
+      usbd_edpt_xfer(rhport, ncm->ep_in, NULL, 0);
+      return true;
+    }
+
+    if (ncm->transferring) {
+      ncm->transferring = false;
     }
 
     // If there are datagrams queued up that we tried to send while this NTB was being emitted, send them now
-    if (ncm_interface.datagram_count && ncm_interface.itf_data_alt == 1) {
-      ncm_start_tx();
+    if (ncm->datagram_count && ncm->itf_data_alt == 1) {
+      ncm_start_tx(ncm);
     }
   }
 
-  if (ep_addr == ncm_interface.ep_notif )
+  if (ep_addr == ncm->ep_notif )
   {
-    ncm_interface.report_pending = false;
-    ncm_report();
+    ncm->report_pending = false;
+    ncm_report(ncm);
   }
 
   return true;
 }
 
 // poll network driver for its ability to accept another packet to transmit
-bool tud_network_can_xmit(uint16_t size)
+bool tud_network_n_can_xmit(uint8_t idx, uint16_t size)
 {
-  TU_VERIFY(ncm_interface.itf_data_alt == 1);
+  TU_VERIFY(idx < CFG_TUD_NCM);
+  ncm_interface_t* ncm = &ncm_interface[idx];
+
+  TU_VERIFY(ncm->itf_data_alt == 1);
 
-  if (ncm_interface.datagram_count >= ncm_interface.max_datagrams_per_ntb) {
+  if (ncm->datagram_count >= ncm->max_datagrams_per_ntb) {
     TU_LOG2("NTB full [by count]\r\n");
     return false;
   }
 
-  size_t next_datagram_offset = ncm_interface.next_datagram_offset;
-  if (next_datagram_offset + size > ncm_interface.ntb_in_size) {
+  uint32_t next_datagram_offset = ncm->next_datagram_offset;
+  if (next_datagram_offset + size > ncm->ntb_in_size) {
     TU_LOG2("ntb full [by size]\r\n");
     return false;
   }
@@ -486,26 +749,44 @@ bool tud_network_can_xmit(uint16_t size)
   return true;
 }
 
-void tud_network_xmit(void *ref, uint16_t arg)
+bool tud_network_can_xmit(uint16_t size)
 {
-  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t next_datagram_offset = ncm_interface.next_datagram_offset;
+  return tud_network_n_can_xmit(0, size);
+}
 
-  uint16_t size = tud_network_xmit_cb(ntb->data + next_datagram_offset, ref, arg);
+void tud_network_n_xmit(uint8_t idx, void *ref, uint16_t arg)
+{
+  TU_VERIFY(idx < CFG_TUD_NCM, );
+  ncm_interface_t* ncm = &ncm_interface[idx];
 
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = ncm_interface.next_datagram_offset;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = size;
+  transmit_ntb_t *ntb = &ncm->transmit_ntb[ncm->current_ntb];
+  uint32_t next_datagram_offset = ncm->next_datagram_offset;
 
-  ncm_interface.datagram_count++;
+  uint16_t size = ncm_xmit_cb(ncm, ntb->data + next_datagram_offset, ref, arg);
+
+  if (ncm->ntb_format == NCM_NTB_FORMAT_32) {
+    ntb->ndp32.datagram[ncm->datagram_count].dwDatagramIndex = next_datagram_offset;
+    ntb->ndp32.datagram[ncm->datagram_count].dwDatagramLength = size;
+  } else {
+    ntb->ndp.datagram[ncm->datagram_count].wDatagramIndex = (uint16_t) next_datagram_offset;
+    ntb->ndp.datagram[ncm->datagram_count].wDatagramLength = size;
+  }
+
+  ncm->datagram_count++;
   next_datagram_offset += size;
 
   // round up so the next datagram is aligned correctly
   next_datagram_offset += (CFG_TUD_NCM_ALIGNMENT - 1);
   next_datagram_offset -= (next_datagram_offset % CFG_TUD_NCM_ALIGNMENT);
 
-  ncm_interface.next_datagram_offset = next_datagram_offset;
+  ncm->next_datagram_offset = next_datagram_offset;
 
-  ncm_start_tx();
+  ncm_start_tx(ncm);
+}
+
+void tud_network_xmit(void *ref, uint16_t arg)
+{
+  tud_network_n_xmit(0, ref, arg);
 }
 
 #endif
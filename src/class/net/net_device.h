@@ -44,6 +44,28 @@
 #define CFG_TUD_NET_MTU           1514
 #endif
 
+// ECM/RNDIS: number of receive buffers, more can be filled by host while application holds a packet
+#ifndef CFG_TUD_NET_RX_BUFCOUNT
+#define CFG_TUD_NET_RX_BUFCOUNT   1
+#endif
+
+// ECM/RNDIS: number of transmit buffers, packets are queued while one is being sent
+#ifndef CFG_TUD_NET_TX_BUFCOUNT
+#define CFG_TUD_NET_TX_BUFCOUNT   1
+#endif
+
+// RNDIS: maximum number of packets aggregated into one bulk transfer in each direction.
+// Advertised in REMOTE_NDIS_INITIALIZE_CMPLT, outgoing transfers are also limited by host MaxTransferSize.
+#ifndef CFG_TUD_RNDIS_PACKETS_PER_XFER
+#define CFG_TUD_RNDIS_PACKETS_PER_XFER 1
+#endif
+
+// NCM: support 32-bit NTB format (NTH32/NDP32) selectable by host with SET_NTB_FORMAT.
+// Required for NTB sizes above 64 KiB, NTB-16 remains the default format.
+#ifndef CFG_TUD_NCM_NTB32
+#define CFG_TUD_NCM_NTB32 0
+#endif
+
 #ifndef CFG_TUD_NCM_IN_NTB_MAX_SIZE
 #define CFG_TUD_NCM_IN_NTB_MAX_SIZE 3200
 #endif
@@ -101,6 +123,17 @@ extern const uint8_t tud_network_mac_address[6];
 // callback to client providing optional indication of internal state of network driver
 void tud_network_link_state_cb(bool state);
 
+// Multiple NCM functions (CFG_TUD_NCM > 1): idx is the instance in order of the configuration descriptor.
+// APIs above without index operate on instance 0.
+void tud_network_n_recv_renew(uint8_t idx);
+bool tud_network_n_can_xmit(uint8_t idx, uint16_t size);
+void tud_network_n_xmit(uint8_t idx, void *ref, uint16_t arg);
+
+// With CFG_TUD_NCM > 1 these are invoked instead of the callbacks without index, client must provide them
+bool tud_network_n_recv_cb(uint8_t idx, const uint8_t *src, uint16_t size);
+uint16_t tud_network_n_xmit_cb(uint8_t idx, uint8_t *dst, void *ref, uint16_t arg);
+void tud_network_n_link_state_cb(uint8_t idx, bool state);
+
 //--------------------------------------------------------------------+
 // INTERNAL USBD-CLASS DRIVER API
 //--------------------------------------------------------------------+
@@ -110,6 +143,7 @@ uint16_t netd_open            (uint8_t rhport, tusb_desc_interface_t const * itf
 bool     netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     netd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 void     netd_report          (uint8_t *buf, uint16_t len);
+void     netd_rndis_set_host_max_xfer(uint32_t max_xfer_size);
 
 #ifdef __cplusplus
  }
@@ -0,0 +1,923 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUH_ENABLED && CFG_TUH_NET)
+
+#include "host/usbh.h"
+#include "host/usbh_classdriver.h"
+
+#include "net_host.h"
+
+// Debug level, TUSB_CFG_DEBUG must be at least this level for debug message
+#define NETH_DEBUG   2
+
+#define TU_LOG_NETH(...)   TU_LOG(NETH_DEBUG, __VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+// Maximum number of chained NDPs parsed in one NTB, guard against malformed NTB
+#define NCM_NDP_CHAIN_MAX   4
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t bInterfaceNumber;   // Communication interface
+  uint8_t bInterfaceSubClass; // ECM or NCM
+  uint8_t itf_data;           // Data interface
+  uint8_t itf_data_alt;       // Alternate setting of data interface with bulk endpoints
+  uint8_t i_mac;              // iMACAddress string index
+  uint8_t ncm_capabilities;   // bmNetworkCapabilities of NCM functional descriptor
+
+  uint8_t ep_notif;
+  uint8_t ep_in;
+  uint8_t ep_out;
+  uint16_t ep_out_size;
+
+  bool data_opened;
+  bool mounted;
+  bool link_up;
+  bool rx_halted;             // bulk IN stalled, receiving resumes once halt is cleared
+
+  uint8_t mac_address[6];
+
+  // NCM NTB parameters, from GET_NTB_PARAMETERS
+  uint32_t ntb_in_max;
+  uint32_t ntb_out_max;
+  uint16_t ndp_out_divisor;
+  uint16_t ndp_out_remainder;
+  uint16_t ndp_out_alignment;
+  uint16_t ntb_out_max_datagrams;
+  uint16_t ntb_sequence;
+
+  // Receive ring: buffers [rd, wr) are queued or being processed
+  struct {
+    uint8_t wr;
+    uint8_t rd;
+    uint8_t count;
+  } rx;
+
+  // Transmit: one buffer is being filled while the other is in flight
+  struct {
+    uint8_t active;
+    bool busy;
+    uint16_t len;
+    uint8_t count;
+    ndp16_datagram_t datagram[CFG_TUH_NET_TX_DATAGRAMS_MAX];
+  } tx;
+
+  CFG_TUSB_MEM_ALIGN uint8_t notif_buf[16];
+  CFG_TUSB_MEM_ALIGN uint8_t rx_buf[CFG_TUH_NET_RX_BUFCOUNT][CFG_TUH_NET_RX_BUFSIZE];
+  CFG_TUSB_MEM_ALIGN uint8_t tx_buf[2][CFG_TUH_NET_TX_BUFSIZE];
+} neth_interface_t;
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+
+CFG_TUSB_MEM_SECTION
+static neth_interface_t neth_data[CFG_TUH_NET];
+
+static inline neth_interface_t* get_itf(uint8_t idx)
+{
+  TU_ASSERT(idx < CFG_TUH_NET, NULL);
+  neth_interface_t* p_net = &neth_data[idx];
+
+  return (p_net->daddr != 0) ? p_net : NULL;
+}
+
+static inline uint8_t get_idx_by_ep_addr(uint8_t daddr, uint8_t ep_addr)
+{
+  for(uint8_t i=0; i<CFG_TUH_NET; i++)
+  {
+    neth_interface_t* p_net = &neth_data[i];
+    if ( (p_net->daddr == daddr) &&
+         (ep_addr == p_net->ep_notif || ep_addr == p_net->ep_in || ep_addr == p_net->ep_out) )
+    {
+      return i;
+    }
+  }
+
+  return TUSB_INDEX_INVALID;
+}
+
+static neth_interface_t* find_new_itf(void)
+{
+  for(uint8_t i=0; i<CFG_TUH_NET; i++)
+  {
+    if (neth_data[i].daddr == 0) return &neth_data[i];
+  }
+
+  return NULL;
+}
+
+static inline bool is_ncm(neth_interface_t const* p_net)
+{
+  return p_net->bInterfaceSubClass == CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL;
+}
+
+// clear interface state, buffers are left untouched
+static void itf_clear(neth_interface_t* p_net)
+{
+  tu_memclr(p_net, offsetof(neth_interface_t, notif_buf));
+}
+
+//--------------------------------------------------------------------+
+// Receive
+//--------------------------------------------------------------------+
+
+// Queue as many free receive buffers as the host stack accepts
+static void rx_queue(neth_interface_t* p_net)
+{
+  if ( p_net->rx_halted ) return;
+
+  while ( p_net->rx.count < CFG_TUH_NET_RX_BUFCOUNT )
+  {
+    // claim fails when endpoint cannot take another transfer
+    if ( !usbh_edpt_claim_queued(p_net->daddr, p_net->ep_in) ) break;
+
+    // usbh releases the endpoint itself if transfer cannot be queued
+    if ( !usbh_edpt_xfer(p_net->daddr, p_net->ep_in, p_net->rx_buf[p_net->rx.wr], CFG_TUH_NET_RX_BUFSIZE) ) break;
+
+    p_net->rx.wr = (uint8_t) ((p_net->rx.wr + 1) % CFG_TUH_NET_RX_BUFCOUNT);
+    p_net->rx.count++;
+  }
+}
+
+// Parse NTB in place and pass datagrams to application in batches
+static void ncm_rx_process(uint8_t idx, uint8_t const* ntb, uint32_t len)
+{
+  TU_VERIFY(len >= sizeof(nth16_t), );
+
+  nth16_t const* nth = (nth16_t const*) ntb;
+  TU_VERIFY(tu_le32toh(nth->dwSignature) == NTH16_SIGNATURE, );
+
+  uint16_t const block_len = tu_le16toh(nth->wBlockLength);
+  if ( block_len && block_len < len ) len = block_len;
+
+  tuh_net_datagram_t batch[CFG_TUH_NET_RX_BATCH_MAX];
+  uint8_t count = 0;
+
+  uint16_t ndp_index = tu_le16toh(nth->wNdpIndex);
+  for ( uint8_t hop = 0; ndp_index && hop < NCM_NDP_CHAIN_MAX; hop++ )
+  {
+    if ( ndp_index < sizeof(nth16_t) || ndp_index + sizeof(ndp16_t) > len ) break;
+
+    ndp16_t const* ndp = (ndp16_t const*) (ntb + ndp_index);
+    if ( tu_le32toh(ndp->dwSignature) != NDP16_SIGNATURE_NCM0 ) break;
+
+    uint16_t const ndp_len = tu_le16toh(ndp->wLength);
+    if ( ndp_len < sizeof(ndp16_t) || ndp_index + ndp_len > len ) break;
+
+    uint16_t const num_datagrams = (uint16_t) ((ndp_len - sizeof(ndp16_t)) / sizeof(ndp16_datagram_t));
+    for ( uint16_t i = 0; i < num_datagrams; i++ )
+    {
+      uint16_t const dg_index = tu_le16toh(ndp->datagram[i].wDatagramIndex);
+      uint16_t const dg_len   = tu_le16toh(ndp->datagram[i].wDatagramLength);
+
+      // zero entry terminates the datagram list
+      if ( dg_index == 0 || dg_len == 0 ) break;
+      if ( (uint32_t) dg_index + dg_len > len ) continue;
+
+      batch[count].buffer = ntb + dg_index;
+      batch[count].len    = dg_len;
+      count++;
+
+      if ( count == CFG_TUH_NET_RX_BATCH_MAX )
+      {
+        tuh_net_rx_cb(idx, batch, count);
+        count = 0;
+      }
+    }
+
+    ndp_index = tu_le16toh(ndp->wNextNdpIndex);
+  }
+
+  if ( count ) tuh_net_rx_cb(idx, batch, count);
+}
+
+static void rx_clear_halt_complete(tuh_xfer_t* xfer)
+{
+  uint8_t const idx = (uint8_t) xfer->user_data;
+  neth_interface_t* p_net = get_itf(idx);
+  TU_VERIFY(p_net && p_net->daddr == xfer->daddr, );
+
+  // on failure the next driver activity tries again
+  if ( xfer->result != XFER_RESULT_SUCCESS ) return;
+
+  p_net->rx_halted = false;
+  rx_queue(p_net);
+}
+
+// Clear halt of bulk IN endpoint. If control pipe is busy it is tried again
+// on the next transfer event or transmission of this interface.
+static void rx_clear_halt(uint8_t idx, neth_interface_t* p_net)
+{
+  TU_VERIFY(p_net->rx_halted && p_net->mounted, );
+  tuh_edpt_clear_halt(p_net->daddr, p_net->ep_in, rx_clear_halt_complete, idx);
+}
+
+static void rx_complete(uint8_t idx, neth_interface_t* p_net, xfer_result_t result, uint32_t xferred_bytes)
+{
+  TU_ASSERT(p_net->rx.count, );
+  uint8_t const* buf = p_net->rx_buf[p_net->rx.rd];
+
+  // completed buffer is still counted: keep the other buffers queued while it is processed
+  rx_queue(p_net);
+
+  if ( result == XFER_RESULT_SUCCESS && xferred_bytes && tuh_net_rx_cb )
+  {
+    if ( is_ncm(p_net) )
+    {
+      ncm_rx_process(idx, buf, xferred_bytes);
+    }else
+    {
+      tuh_net_datagram_t const datagram = { .buffer = buf, .len = (uint16_t) xferred_bytes };
+      tuh_net_rx_cb(idx, &datagram, 1);
+    }
+  }
+
+  p_net->rx.rd = (uint8_t) ((p_net->rx.rd + 1) % CFG_TUH_NET_RX_BUFCOUNT);
+  p_net->rx.count--;
+
+  if ( result == XFER_RESULT_STALLED )
+  {
+    p_net->rx_halted = true;
+    rx_clear_halt(idx, p_net);
+  }else
+  {
+    // transaction error: buffer is simply queued again
+    rx_queue(p_net);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Transmit
+//--------------------------------------------------------------------+
+
+// first offset >= offset satisfying offset % divisor == remainder
+static inline uint16_t ntb_datagram_align(uint16_t offset, uint16_t divisor, uint16_t remainder)
+{
+  return (uint16_t) (offset + (remainder + divisor - (offset % divisor)) % divisor);
+}
+
+static inline uint16_t ntb_ndp_align(uint16_t offset, uint16_t alignment)
+{
+  return (uint16_t) ((offset + alignment - 1) / alignment * alignment);
+}
+
+static inline uint16_t tx_size_max(neth_interface_t const* p_net)
+{
+  return (uint16_t) tu_min32(p_net->ntb_out_max, CFG_TUH_NET_TX_BUFSIZE);
+}
+
+// Offset where a datagram of given size would be placed in the active buffer, 0 if it does not fit
+static uint16_t tx_fit(neth_interface_t const* p_net, uint16_t size)
+{
+  if ( !is_ncm(p_net) )
+  {
+    return (p_net->tx.count == 0 && size <= CFG_TUH_NET_TX_BUFSIZE) ? 1 : 0;
+  }
+
+  uint8_t const count = p_net->tx.count;
+  TU_VERIFY(size <= CFG_TUH_NET_TX_BUFSIZE, 0);
+  TU_VERIFY(count < CFG_TUH_NET_TX_DATAGRAMS_MAX && count < p_net->ntb_out_max_datagrams, 0);
+
+  uint16_t const start  = count ? p_net->tx.len : sizeof(nth16_t);
+  uint16_t const offset = ntb_datagram_align(start, p_net->ndp_out_divisor, p_net->ndp_out_remainder);
+
+  // NDP with new datagram and zero terminator is placed after all datagrams
+  uint32_t const total = ntb_ndp_align((uint16_t) (offset + size), p_net->ndp_out_alignment) +
+                         sizeof(ndp16_t) + (count + 2u) * sizeof(ndp16_datagram_t);
+
+  return (total <= tx_size_max(p_net)) ? offset : 0;
+}
+
+// Complete NTB header and NDP of active buffer, return NTB length
+static uint16_t ncm_tx_finalize(neth_interface_t* p_net)
+{
+  uint8_t* ntb = p_net->tx_buf[p_net->tx.active];
+  uint8_t const count = p_net->tx.count;
+
+  uint16_t const ndp_index = ntb_ndp_align(p_net->tx.len, p_net->ndp_out_alignment);
+  uint16_t const ndp_len   = (uint16_t) (sizeof(ndp16_t) + (count + 1u) * sizeof(ndp16_datagram_t));
+
+  ndp16_t* ndp = (ndp16_t*) (ntb + ndp_index);
+  ndp->dwSignature   = tu_htole32(NDP16_SIGNATURE_NCM0);
+  ndp->wLength       = tu_htole16(ndp_len);
+  ndp->wNextNdpIndex = 0;
+
+  for ( uint8_t i = 0; i < count; i++ )
+  {
+    ndp->datagram[i].wDatagramIndex  = tu_htole16(p_net->tx.datagram[i].wDatagramIndex);
+    ndp->datagram[i].wDatagramLength = tu_htole16(p_net->tx.datagram[i].wDatagramLength);
+  }
+  ndp->datagram[count].wDatagramIndex  = 0;
+  ndp->datagram[count].wDatagramLength = 0;
+
+  uint16_t const block_len = (uint16_t) (ndp_index + ndp_len);
+
+  nth16_t* nth = (nth16_t*) ntb;
+  nth->dwSignature   = tu_htole32(NTH16_SIGNATURE);
+  nth->wHeaderLength = tu_htole16(sizeof(nth16_t));
+  nth->wSequence     = tu_htole16(p_net->ntb_sequence++);
+  nth->wBlockLength  = tu_htole16(block_len);
+  nth->wNdpIndex     = tu_htole16(ndp_index);
+
+  return block_len;
+}
+
+// Send active buffer and switch to the other one for filling
+static bool tx_submit(neth_interface_t* p_net)
+{
+  TU_VERIFY(!p_net->tx.busy && p_net->tx.count);
+
+  uint8_t* buf = p_net->tx_buf[p_net->tx.active];
+  uint16_t const len = is_ncm(p_net) ? ncm_tx_finalize(p_net) : p_net->tx.len;
+
+  TU_VERIFY(usbh_edpt_claim(p_net->daddr, p_net->ep_out));
+
+  p_net->tx.busy   = true;
+  p_net->tx.active ^= 1;
+  p_net->tx.len    = 0;
+  p_net->tx.count  = 0;
+
+  if ( !usbh_edpt_xfer(p_net->daddr, p_net->ep_out, buf, len) )
+  {
+    // frames in failed buffer are dropped
+    p_net->tx.busy = false;
+    return false;
+  }
+
+  return true;
+}
+
+static void tx_complete(uint8_t idx, neth_interface_t* p_net, uint32_t xferred_bytes)
+{
+  // Short packet is required to terminate transfer that is multiple of packet size,
+  // except for NTB of exactly dwNtbOutMaxSize
+  if ( xferred_bytes && (xferred_bytes % p_net->ep_out_size == 0) &&
+       !(is_ncm(p_net) && xferred_bytes == p_net->ntb_out_max) )
+  {
+    if ( usbh_edpt_claim(p_net->daddr, p_net->ep_out) &&
+         usbh_edpt_xfer(p_net->daddr, p_net->ep_out, NULL, 0) )
+    {
+      return;
+    }
+  }
+
+  p_net->tx.busy = false;
+
+  // send datagrams aggregated while previous buffer was in flight
+  if ( p_net->tx.count ) tx_submit(p_net);
+
+  if (tuh_net_tx_complete_cb) tuh_net_tx_complete_cb(idx);
+}
+
+//--------------------------------------------------------------------+
+// APPLICATION API
+//--------------------------------------------------------------------+
+
+uint8_t tuh_net_itf_get_index(uint8_t daddr, uint8_t itf_num)
+{
+  for(uint8_t i=0; i<CFG_TUH_NET; i++)
+  {
+    neth_interface_t const* p_net = &neth_data[i];
+    if (p_net->daddr == daddr && p_net->bInterfaceNumber == itf_num) return i;
+  }
+
+  return TUSB_INDEX_INVALID;
+}
+
+bool tuh_net_itf_get_info(uint8_t idx, tuh_net_itf_info_t* info)
+{
+  neth_interface_t const* p_net = get_itf(idx);
+  TU_VERIFY(p_net && info);
+
+  info->daddr              = p_net->daddr;
+  info->bInterfaceNumber   = p_net->bInterfaceNumber;
+  info->bInterfaceSubClass = p_net->bInterfaceSubClass;
+  memcpy(info->mac_address, p_net->mac_address, 6);
+
+  return true;
+}
+
+bool tuh_net_mounted(uint8_t idx)
+{
+  neth_interface_t const* p_net = get_itf(idx);
+  return p_net && p_net->mounted;
+}
+
+bool tuh_net_link_up(uint8_t idx)
+{
+  neth_interface_t const* p_net = get_itf(idx);
+  return p_net && p_net->mounted && p_net->link_up;
+}
+
+bool tuh_net_can_xmit(uint8_t idx, uint16_t size)
+{
+  neth_interface_t const* p_net = get_itf(idx);
+  TU_VERIFY(p_net && p_net->mounted && size);
+
+  return tx_fit(p_net, size) != 0;
+}
+
+bool tuh_net_xmit(uint8_t idx, void const* frame, uint16_t size)
+{
+  neth_interface_t* p_net = get_itf(idx);
+  TU_VERIFY(p_net && p_net->mounted && frame && size);
+
+  if ( p_net->rx_halted ) rx_clear_halt(idx, p_net);
+
+  uint16_t const offset = tx_fit(p_net, size);
+  TU_VERIFY(offset);
+
+  uint8_t* buf = p_net->tx_buf[p_net->tx.active];
+
+  if ( is_ncm(p_net) )
+  {
+    memcpy(buf + offset, frame, size);
+    p_net->tx.datagram[p_net->tx.count].wDatagramIndex  = offset;
+    p_net->tx.datagram[p_net->tx.count].wDatagramLength = size;
+    p_net->tx.len = (uint16_t) (offset + size);
+  }else
+  {
+    memcpy(buf, frame, size);
+    p_net->tx.len = size;
+  }
+  p_net->tx.count++;
+
+  // send now if endpoint is idle, otherwise frame is sent (aggregated with others for NCM)
+  // when the in-flight buffer completes
+  if ( !p_net->tx.busy ) tx_submit(p_net);
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// CLASS-USBH API
+//--------------------------------------------------------------------+
+
+void neth_init(void)
+{
+  tu_memclr(neth_data, sizeof(neth_data));
+}
+
+void neth_close(uint8_t daddr)
+{
+  for(uint8_t idx=0; idx<CFG_TUH_NET; idx++)
+  {
+    neth_interface_t* p_net = &neth_data[idx];
+    if (p_net->daddr == daddr)
+    {
+      // Invoke application callback
+      if (p_net->mounted && tuh_net_umount_cb) tuh_net_umount_cb(idx);
+
+      itf_clear(p_net);
+    }
+  }
+}
+
+bool neth_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+  uint8_t const idx = get_idx_by_ep_addr(daddr, ep_addr);
+  neth_interface_t* p_net = get_itf(idx);
+  TU_ASSERT(p_net);
+
+  // previous attempt to clear bulk IN halt could not be submitted
+  if ( p_net->rx_halted && ep_addr != p_net->ep_in ) rx_clear_halt(idx, p_net);
+
+  if ( ep_addr == p_net->ep_in )
+  {
+    rx_complete(idx, p_net, result, xferred_bytes);
+  }
+  else if ( ep_addr == p_net->ep_out )
+  {
+    tx_complete(idx, p_net, (result == XFER_RESULT_SUCCESS) ? xferred_bytes : 0);
+  }
+  else if ( ep_addr == p_net->ep_notif )
+  {
+    tusb_control_request_t const* notif = (tusb_control_request_t const*) p_net->notif_buf;
+
+    if ( result == XFER_RESULT_SUCCESS && xferred_bytes >= sizeof(tusb_control_request_t) &&
+         notif->bRequest == CDC_NOTIF_NETWORK_CONNECTION )
+    {
+      bool const up = (tu_le16toh(notif->wValue) != 0);
+      TU_LOG_NETH("NET link %s\r\n", up ? "up" : "down");
+
+      if ( up != p_net->link_up )
+      {
+        p_net->link_up = up;
+        if (tuh_net_link_state_cb) tuh_net_link_state_cb(idx, up);
+      }
+    }
+
+    // prepare for next notification
+    if ( result == XFER_RESULT_SUCCESS && usbh_edpt_claim(daddr, ep_addr) )
+    {
+      usbh_edpt_xfer(daddr, ep_addr, p_net->notif_buf, sizeof(p_net->notif_buf));
+    }
+  }
+  else
+  {
+    TU_ASSERT(false);
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+// Open bulk endpoints of data interface alternate setting, search from p_desc
+static bool open_data_itf(neth_interface_t* p_net, uint8_t const* p_desc, uint8_t const* p_desc_end)
+{
+  while ( p_desc < p_desc_end )
+  {
+    tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
+
+    if ( TUSB_DESC_INTERFACE == tu_desc_type(p_desc) &&
+         TUSB_CLASS_CDC_DATA == desc_itf->bInterfaceClass &&
+         p_net->itf_data     == desc_itf->bInterfaceNumber &&
+         2                   == desc_itf->bNumEndpoints )
+    {
+      p_net->itf_data_alt = desc_itf->bAlternateSetting;
+      p_desc = tu_desc_next(p_desc);
+
+      // data endpoints expected to be in pairs
+      uint8_t ep_count = 0;
+      while ( ep_count < 2 )
+      {
+        TU_ASSERT(p_desc < p_desc_end);
+
+        if ( TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) )
+        {
+          tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+          TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer);
+          TU_ASSERT(tuh_edpt_open(p_net->daddr, desc_ep));
+
+          if ( tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN )
+          {
+            p_net->ep_in = desc_ep->bEndpointAddress;
+          }else
+          {
+            p_net->ep_out      = desc_ep->bEndpointAddress;
+            p_net->ep_out_size = tu_edpt_packet_size(desc_ep);
+          }
+
+          ep_count++;
+        }
+
+        p_desc = tu_desc_next(p_desc);
+      }
+
+      p_net->data_opened = true;
+      return true;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return false;
+}
+
+bool neth_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *itf_desc, uint16_t max_len)
+{
+  (void) rhport;
+
+  uint8_t const * p_desc_end = ((uint8_t const*) itf_desc) + max_len;
+
+  // Data interface comes as its own function when device does not use IAD,
+  // bind it to the communication interface opened previously
+  if ( TUSB_CLASS_CDC_DATA == itf_desc->bInterfaceClass )
+  {
+    for(uint8_t i=0; i<CFG_TUH_NET; i++)
+    {
+      neth_interface_t* p_net = &neth_data[i];
+      if ( p_net->daddr == daddr && !p_net->data_opened && p_net->itf_data == itf_desc->bInterfaceNumber )
+      {
+        return open_data_itf(p_net, (uint8_t const*) itf_desc, p_desc_end);
+      }
+    }
+
+    return false;
+  }
+
+  TU_VERIFY( TUSB_CLASS_CDC == itf_desc->bInterfaceClass &&
+             (CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL == itf_desc->bInterfaceSubClass ||
+              CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL  == itf_desc->bInterfaceSubClass) );
+
+  neth_interface_t * p_net = find_new_itf();
+  TU_VERIFY(p_net);
+
+  itf_clear(p_net);
+  p_net->daddr              = daddr;
+  p_net->bInterfaceNumber   = itf_desc->bInterfaceNumber;
+  p_net->bInterfaceSubClass = itf_desc->bInterfaceSubClass;
+  p_net->itf_data           = (uint8_t) (itf_desc->bInterfaceNumber + 1);
+
+  // NTB defaults until GET_NTB_PARAMETERS completes, device input size is unknown
+  p_net->ntb_in_max            = UINT32_MAX;
+  p_net->ntb_out_max           = 2048;
+  p_net->ndp_out_divisor       = 4;
+  p_net->ndp_out_remainder     = 0;
+  p_net->ndp_out_alignment     = 4;
+  p_net->ntb_out_max_datagrams = CFG_TUH_NET_TX_DATAGRAMS_MAX;
+
+  //------------- Communication Interface -------------//
+  uint8_t const * p_desc = tu_desc_next(itf_desc);
+
+  // Communication Functional Descriptors
+  while( (p_desc < p_desc_end) && (TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc)) )
+  {
+    switch ( cdc_functional_desc_typeof(p_desc) )
+    {
+      case CDC_FUNC_DESC_UNION:
+        p_net->itf_data = ((cdc_desc_func_union_t const *) p_desc)->bSubordinateInterface;
+      break;
+
+      case CDC_FUNC_DESC_ETHERNET_NETWORKING:
+        // bLength, bDescriptorType, bDescriptorSubtype, iMACAddress
+        p_net->i_mac = p_desc[3];
+      break;
+
+      case CDC_FUNC_DESC_NCM:
+        // bLength, bDescriptorType, bDescriptorSubtype, bcdNcmVersion (2), bmNetworkCapabilities
+        p_net->ncm_capabilities = p_desc[5];
+      break;
+
+      default: break;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  // Open notification endpoint of control interface if any
+  if ( itf_desc->bNumEndpoints == 1 )
+  {
+    TU_ASSERT(TUSB_DESC_ENDPOINT == tu_desc_type(p_desc));
+    tusb_desc_endpoint_t const * desc_ep = (tusb_desc_endpoint_t const *) p_desc;
+
+    TU_ASSERT( tuh_edpt_open(daddr, desc_ep) );
+    p_net->ep_notif = desc_ep->bEndpointAddress;
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  //------------- Data Interface (if included by IAD) -------------//
+  (void) open_data_itf(p_net, p_desc, p_desc_end);
+
+  return true;
+}
+
+enum
+{
+  CONFIG_NCM_GET_NTB_PARAMETERS,
+  CONFIG_NCM_SET_NTB_INPUT_SIZE,
+  CONFIG_GET_MAC_ADDRESS,
+  CONFIG_SET_DATA_INTERFACE,
+  CONFIG_SET_PACKET_FILTER,
+  CONFIG_COMPLETE
+};
+
+static inline uint8_t hex_to_nibble(uint8_t c)
+{
+  if ( c >= '0' && c <= '9' ) return (uint8_t) (c - '0');
+  if ( c >= 'a' && c <= 'f' ) return (uint8_t) (c - 'a' + 10);
+  if ( c >= 'A' && c <= 'F' ) return (uint8_t) (c - 'A' + 10);
+  return 0;
+}
+
+// iMACAddress is an UTF-16 string of 12 hex digits
+static void parse_mac_string(neth_interface_t* p_net, uint8_t const* desc_str)
+{
+  TU_VERIFY(desc_str[0] >= 2 + 12*2, );
+
+  for ( uint8_t i = 0; i < 12; i++ )
+  {
+    uint8_t const nibble = hex_to_nibble(desc_str[2 + 2*i]);
+    p_net->mac_address[i/2] = (uint8_t) ((p_net->mac_address[i/2] << 4) | nibble);
+  }
+}
+
+// Find interface being configured: only one interface is configured at a time
+static uint8_t get_idx_configuring(uint8_t daddr)
+{
+  for(uint8_t i=0; i<CFG_TUH_NET; i++)
+  {
+    neth_interface_t const* p_net = &neth_data[i];
+    if (p_net->daddr == daddr && p_net->data_opened && !p_net->mounted) return i;
+  }
+
+  return TUSB_INDEX_INVALID;
+}
+
+static void process_net_config(tuh_xfer_t* xfer)
+{
+  uintptr_t const state = xfer->user_data;
+  uint8_t const daddr = xfer->daddr;
+  uint8_t const idx = get_idx_configuring(daddr);
+  neth_interface_t* p_net = get_itf(idx);
+  TU_ASSERT(p_net, );
+
+  uint8_t* enum_buf = usbh_get_enum_buf();
+  tusb_control_request_t const* prev = xfer->setup;
+
+  // Parse response of previous request, failed optional requests are ignored
+  if ( xfer->result == XFER_RESULT_SUCCESS && prev->bmRequestType_bit.direction == TUSB_DIR_IN )
+  {
+    if ( prev->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS && prev->bRequest == NCM_GET_NTB_PARAMETERS &&
+         xfer->actual_len >= sizeof(ntb_parameters_t) )
+    {
+      ntb_parameters_t params;
+      memcpy(&params, enum_buf, sizeof(ntb_parameters_t));
+
+      uint16_t const divisor = tu_le16toh(params.wNdbOutDivisor);
+      uint16_t const align   = tu_le16toh(params.wNdbOutAlignment);
+      uint16_t const max_dg  = tu_le16toh(params.wNtbOutMaxDatagrams);
+
+      p_net->ntb_in_max            = tu_le32toh(params.dwNtbInMaxSize);
+      p_net->ntb_out_max           = tu_le32toh(params.dwNtbOutMaxSize);
+      p_net->ndp_out_divisor       = divisor ? divisor : 1;
+      p_net->ndp_out_remainder     = (uint16_t) (tu_le16toh(params.wNdbOutPayloadRemainder) % p_net->ndp_out_divisor);
+      p_net->ndp_out_alignment     = (align >= 4) ? align : 4;
+      p_net->ntb_out_max_datagrams = max_dg ? max_dg : CFG_TUH_NET_TX_DATAGRAMS_MAX;
+
+      TU_LOG_NETH("NCM NTB IN max = %lu, OUT max = %lu, divisor = %u\r\n", (unsigned long) p_net->ntb_in_max,
+                  (unsigned long) p_net->ntb_out_max, p_net->ndp_out_divisor);
+    }
+    else if ( prev->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD && prev->bRequest == TUSB_REQ_GET_DESCRIPTOR )
+    {
+      parse_mac_string(p_net, enum_buf);
+    }
+  }
+
+  tusb_control_request_t request =
+  {
+    .bmRequestType_bit =
+    {
+      .recipient = TUSB_REQ_RCPT_INTERFACE,
+      .type      = TUSB_REQ_TYPE_CLASS,
+      .direction = TUSB_DIR_OUT
+    },
+    .bRequest = 0,
+    .wValue   = 0,
+    .wIndex   = tu_htole16((uint16_t) p_net->bInterfaceNumber),
+    .wLength  = 0
+  };
+
+  tuh_xfer_t next =
+  {
+    .daddr       = daddr,
+    .ep_addr     = 0,
+    .setup       = &request,
+    .buffer      = NULL,
+    .complete_cb = process_net_config,
+    .user_data   = 0
+  };
+
+  switch(state)
+  {
+    case CONFIG_NCM_GET_NTB_PARAMETERS:
+      request.bmRequestType_bit.direction = TUSB_DIR_IN;
+      request.bRequest  = NCM_GET_NTB_PARAMETERS;
+      request.wLength   = tu_htole16(sizeof(ntb_parameters_t));
+      next.buffer       = enum_buf;
+      next.user_data    = CONFIG_NCM_SET_NTB_INPUT_SIZE;
+      TU_ASSERT( tuh_control_xfer(&next), );
+    break;
+
+    case CONFIG_NCM_SET_NTB_INPUT_SIZE:
+    {
+      // Limit NTB size device can send to our receive buffer, but never above device's dwNtbInMaxSize.
+      // Input size must be at least 2048 (NCM 6.2.7): skip if either limit is smaller
+      uint32_t const in_max = tu_min32(CFG_TUH_NET_RX_BUFSIZE, p_net->ntb_in_max);
+      if ( in_max < 2048 )
+      {
+        TU_LOG_NETH("NCM skip SET_NTB_INPUT_SIZE\r\n");
+        tuh_xfer_t skip = { .daddr = daddr, .result = XFER_RESULT_SUCCESS, .setup = &request,
+                            .user_data = CONFIG_GET_MAC_ADDRESS };
+        process_net_config(&skip);
+        break;
+      }
+
+      // 8-byte form (dwNtbInMaxSize, wNtbInMaxDatagrams, reserved) is required if bmNetworkCapabilities D5 is set
+      uint32_t const in_max_le = tu_htole32(in_max);
+      uint16_t const len = (p_net->ncm_capabilities & TU_BIT(5)) ? 8 : 4;
+
+      tu_memclr(enum_buf, 8);
+      memcpy(enum_buf, &in_max_le, 4);
+
+      request.bRequest  = NCM_SET_NTB_INPUT_SIZE;
+      request.wLength   = tu_htole16(len);
+      next.buffer       = enum_buf;
+      next.user_data    = CONFIG_GET_MAC_ADDRESS;
+      TU_ASSERT( tuh_control_xfer(&next), );
+    }
+    break;
+
+    case CONFIG_GET_MAC_ADDRESS:
+      if ( p_net->i_mac )
+      {
+        // language id 0x0409 English (US)
+        TU_ASSERT( tuh_descriptor_get_string(daddr, p_net->i_mac, 0x0409, enum_buf, 2 + 12*2,
+                                             process_net_config, CONFIG_SET_DATA_INTERFACE), );
+        break;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_SET_DATA_INTERFACE:
+      // Select alternate setting with bulk endpoints to activate data interface
+      request.bmRequestType_bit.type = TUSB_REQ_TYPE_STANDARD;
+      request.bRequest  = TUSB_REQ_SET_INTERFACE;
+      request.wValue    = tu_htole16((uint16_t) p_net->itf_data_alt);
+      request.wIndex    = tu_htole16((uint16_t) p_net->itf_data);
+      next.user_data    = CONFIG_SET_PACKET_FILTER;
+      TU_ASSERT( tuh_control_xfer(&next), );
+    break;
+
+    case CONFIG_SET_PACKET_FILTER:
+      request.bRequest  = CDC_REQUEST_SET_ETHERNET_PACKET_FILTER;
+      request.wValue    = tu_htole16(CFG_TUH_NET_PACKET_FILTER);
+      next.user_data    = CONFIG_COMPLETE;
+      TU_ASSERT( tuh_control_xfer(&next), );
+    break;
+
+    case CONFIG_COMPLETE:
+      TU_LOG_NETH("NET mounted, MAC %02X:%02X:%02X:%02X:%02X:%02X\r\n",
+                  p_net->mac_address[0], p_net->mac_address[1], p_net->mac_address[2],
+                  p_net->mac_address[3], p_net->mac_address[4], p_net->mac_address[5]);
+
+      p_net->mounted = true;
+      if (tuh_net_mount_cb) tuh_net_mount_cb(idx);
+
+      // Prepare for incoming data and notification
+      rx_queue(p_net);
+
+      if ( p_net->ep_notif && usbh_edpt_claim(daddr, p_net->ep_notif) )
+      {
+        usbh_edpt_xfer(daddr, p_net->ep_notif, p_net->notif_buf, sizeof(p_net->notif_buf));
+      }
+
+      // notify usbh that driver enumeration is complete, skip data interface as well
+      usbh_driver_set_config_complete(daddr, tu_max8(p_net->bInterfaceNumber, p_net->itf_data));
+    break;
+
+    default: break;
+  }
+}
+
+bool neth_set_config(uint8_t daddr, uint8_t itf_num)
+{
+  uint8_t const idx = tuh_net_itf_get_index(daddr, itf_num);
+  neth_interface_t* p_net = (idx < CFG_TUH_NET) ? &neth_data[idx] : NULL;
+
+  // data interface bound separately (no IAD) or missing: nothing to configure
+  if ( !p_net || !p_net->data_opened )
+  {
+    usbh_driver_set_config_complete(daddr, itf_num);
+    return true;
+  }
+
+  // fake transfer to kick-off process
+  tusb_control_request_t request;
+  tu_memclr(&request, sizeof(request));
+
+  tuh_xfer_t xfer;
+  xfer.daddr     = daddr;
+  xfer.result    = XFER_RESULT_SUCCESS;
+  xfer.setup     = &request;
+  xfer.user_data = is_ncm(p_net) ? CONFIG_NCM_GET_NTB_PARAMETERS : CONFIG_GET_MAC_ADDRESS;
+
+  process_net_config(&xfer);
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_NET_HOST_H_
+#define _TUSB_NET_HOST_H_
+
+#include "class/cdc/cdc.h"
+#include "ncm.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Number of bulk IN buffers, each one can be queued to the device while
+// the others are being processed by the application
+#ifndef CFG_TUH_NET_RX_BUFCOUNT
+#define CFG_TUH_NET_RX_BUFCOUNT   2
+#endif
+
+// Size of each bulk IN buffer: maximum NTB input size for NCM, or one
+// ethernet frame for ECM. Should be multiple of bulk endpoint size.
+#ifndef CFG_TUH_NET_RX_BUFSIZE
+#define CFG_TUH_NET_RX_BUFSIZE    2048
+#endif
+
+// Size of each of the two bulk OUT buffers
+#ifndef CFG_TUH_NET_TX_BUFSIZE
+#define CFG_TUH_NET_TX_BUFSIZE    2048
+#endif
+
+// Maximum number of datagrams passed to tuh_net_rx_cb() per invocation
+#ifndef CFG_TUH_NET_RX_BATCH_MAX
+#define CFG_TUH_NET_RX_BATCH_MAX  16
+#endif
+
+// Maximum number of datagrams aggregated into one outgoing NTB
+#ifndef CFG_TUH_NET_TX_DATAGRAMS_MAX
+#define CFG_TUH_NET_TX_DATAGRAMS_MAX 8
+#endif
+
+// Ethernet packet filter set on enumeration, see CDC ECM 1.2 Table 8
+#ifndef CFG_TUH_NET_PACKET_FILTER
+#define CFG_TUH_NET_PACKET_FILTER 0x000E // directed, broadcast, all multicast
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+typedef struct
+{
+  uint8_t daddr;
+  uint8_t bInterfaceNumber;
+  uint8_t bInterfaceSubClass; // CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL or CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL
+  uint8_t mac_address[6];
+} tuh_net_itf_info_t;
+
+// Received datagram, pointing directly into the driver receive buffer
+typedef struct
+{
+  uint8_t const* buffer;
+  uint16_t len;
+} tuh_net_datagram_t;
+
+// Get Interface index from device address + interface number
+// return TUSB_INDEX_INVALID (0xFF) if not found
+uint8_t tuh_net_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Get Interface information
+bool tuh_net_itf_get_info(uint8_t idx, tuh_net_itf_info_t* info);
+
+// Check if an interface is mounted
+bool tuh_net_mounted(uint8_t idx);
+
+// Get network connection state reported by the device
+bool tuh_net_link_up(uint8_t idx);
+
+// Check if a datagram of given size can be queued for transmission
+bool tuh_net_can_xmit(uint8_t idx, uint16_t size);
+
+// Queue an ethernet frame for transmission. Frame is copied into the driver buffer,
+// with NCM consecutive frames are aggregated into the same NTB while the endpoint is busy.
+bool tuh_net_xmit(uint8_t idx, void const* frame, uint16_t size);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (WEAK is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with network interface is mounted
+TU_ATTR_WEAK extern void tuh_net_mount_cb(uint8_t idx);
+
+// Invoked when a device with network interface is unmounted
+TU_ATTR_WEAK extern void tuh_net_umount_cb(uint8_t idx);
+
+// Invoked when device reports network connection change
+TU_ATTR_WEAK extern void tuh_net_link_state_cb(uint8_t idx, bool up);
+
+// Invoked with a batch of received datagrams. Datagrams point into the receive
+// buffer which is re-queued after this callback returns: copy what is needed.
+TU_ATTR_WEAK extern void tuh_net_rx_cb(uint8_t idx, tuh_net_datagram_t const* datagrams, uint8_t count);
+
+// Invoked when a transmission is complete and buffer space becomes available
+TU_ATTR_WEAK extern void tuh_net_tx_complete_cb(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void neth_init       (void);
+bool neth_open       (uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *itf_desc, uint16_t max_len);
+bool neth_set_config (uint8_t dev_addr, uint8_t itf_num);
+bool neth_xfer_cb    (uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void neth_close      (uint8_t dev_addr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_NET_HOST_H_ */
@@ -0,0 +1,518 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUD_ENABLED && CFG_TUD_ZERO)
+
+#include "device/usbd.h"
+#include "device/usbd_pvt.h"
+
+#include "zero_device.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+#define LOOPBACK_BUFCOUNT   CFG_TUD_ZERO_LOOPBACK_BUFCOUNT
+
+// Bulk transfers must end on a packet boundary: a short packet would terminate them early. Any legal
+// bulk packet size divides 64 (full speed) or 512 (high speed), the actual one is checked when opened
+TU_VERIFY_STATIC(CFG_TUD_ZERO_BUFSIZE % (TUD_OPT_HIGH_SPEED ? 512 : 64) == 0, "CFG_TUD_ZERO_BUFSIZE must be multiple of bulk packet size");
+
+typedef struct
+{
+  /*------------- Source/Sink -------------*/
+  uint8_t ss_itf_num;
+  uint8_t ss_alt;
+  uint8_t ep_source;
+  uint8_t ep_sink;
+  uint16_t source_mps;
+  uint16_t sink_mps;
+
+  // Alternate 1 with additional ISO endpoints, NULL if not in descriptor
+  uint8_t const * ss_alt1_desc;
+  uint8_t const * ss_alt1_end;
+
+  uint8_t ep_iso_in;
+  uint8_t ep_iso_out;
+  uint16_t iso_in_size;
+  uint16_t iso_out_size;
+
+  /*------------- Loopback -------------*/
+  uint8_t lb_itf_num;
+  uint8_t lb_alt;
+  uint8_t ep_lb_in;
+  uint8_t ep_lb_out;
+
+  // Ring of received buffers: oldest is sent back, next free one after them is receiving
+  uint8_t lb_head;
+  uint8_t lb_count;
+  uint16_t lb_len[LOOPBACK_BUFCOUNT];
+
+  /*------------- From this point, data is not cleared by bus reset -------------*/
+  uint8_t pattern;
+
+  tud_zero_stats_t stats;
+
+  uint16_t ctrl_len;
+
+  CFG_TUSB_MEM_ALIGN uint8_t source_buf[CFG_TUD_ZERO_BUFSIZE];
+  CFG_TUSB_MEM_ALIGN uint8_t sink_buf[CFG_TUD_ZERO_BUFSIZE];
+  CFG_TUSB_MEM_ALIGN uint8_t lb_buf[LOOPBACK_BUFCOUNT][CFG_TUD_ZERO_BUFSIZE];
+
+#if CFG_TUD_ZERO_ISO_BUFSIZE
+  CFG_TUSB_MEM_ALIGN uint8_t iso_in_buf[CFG_TUD_ZERO_ISO_BUFSIZE];
+  CFG_TUSB_MEM_ALIGN uint8_t iso_out_buf[CFG_TUD_ZERO_ISO_BUFSIZE];
+#endif
+
+  CFG_TUSB_MEM_ALIGN uint8_t ctrl_buf[CFG_TUD_ZERO_CTRL_BUFSIZE];
+} zerod_interface_t;
+
+#define ITF_MEM_RESET_SIZE   offsetof(zerod_interface_t, pattern)
+
+CFG_TUSB_MEM_SECTION static zerod_interface_t _zerod_itf;
+
+//--------------------------------------------------------------------+
+// Pattern
+//--------------------------------------------------------------------+
+static inline uint8_t pattern_byte(uint8_t pattern, uint32_t offset, uint16_t mps)
+{
+  return (pattern == TUD_ZERO_PATTERN_MOD63) ? (uint8_t) ((offset % mps) % 63) : 0;
+}
+
+static void pattern_fill(uint8_t pattern, uint8_t* buf, uint32_t len, uint16_t mps)
+{
+  if ( pattern == TUD_ZERO_PATTERN_NONE ) return;
+
+  for ( uint32_t i = 0; i < len; i++ ) buf[i] = pattern_byte(pattern, i, mps);
+}
+
+// return true if data matches pattern
+static bool pattern_verify(uint8_t pattern, uint8_t const* buf, uint32_t len, uint16_t mps)
+{
+  if ( pattern == TUD_ZERO_PATTERN_NONE ) return true;
+
+  for ( uint32_t i = 0; i < len; i++ )
+  {
+    uint8_t const expected = pattern_byte(pattern, i, mps);
+
+    if ( buf[i] != expected )
+    {
+      if ( tud_zero_sink_error_cb ) tud_zero_sink_error_cb(i, expected, buf[i]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Source/Sink
+//--------------------------------------------------------------------+
+static void source_xfer(uint8_t rhport)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+
+  // source buffer is constant, queue as many transfers of it as endpoint accepts
+  while ( p_zero->ep_source && !usbd_edpt_stalled(rhport, p_zero->ep_source) &&
+          usbd_edpt_xfer_available(rhport, p_zero->ep_source) )
+  {
+    TU_VERIFY(usbd_edpt_xfer(rhport, p_zero->ep_source, p_zero->source_buf, CFG_TUD_ZERO_BUFSIZE), );
+  }
+}
+
+static void sink_xfer(uint8_t rhport)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+
+  // single transfer since buffer is verified on completion
+  if ( p_zero->ep_sink && usbd_edpt_ready(rhport, p_zero->ep_sink) )
+  {
+    usbd_edpt_xfer(rhport, p_zero->ep_sink, p_zero->sink_buf, CFG_TUD_ZERO_BUFSIZE);
+  }
+}
+
+#if CFG_TUD_ZERO_ISO_BUFSIZE
+static void iso_xfer(uint8_t rhport)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+
+  if ( p_zero->ep_iso_in && !usbd_edpt_busy(rhport, p_zero->ep_iso_in) )
+  {
+    usbd_edpt_xfer(rhport, p_zero->ep_iso_in, p_zero->iso_in_buf, p_zero->iso_in_size);
+  }
+
+  if ( p_zero->ep_iso_out && !usbd_edpt_busy(rhport, p_zero->ep_iso_out) )
+  {
+    usbd_edpt_xfer(rhport, p_zero->ep_iso_out, p_zero->iso_out_buf, p_zero->iso_out_size);
+  }
+}
+
+// Open ISO endpoints of alternate 1, bulk endpoints are the same as alternate 0
+static bool iso_open(uint8_t rhport)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+  uint8_t const * p_desc = tu_desc_next(p_zero->ss_alt1_desc);
+
+  while ( p_desc < p_zero->ss_alt1_end )
+  {
+    if ( TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) )
+    {
+      tusb_desc_endpoint_t const * desc_ep = (tusb_desc_endpoint_t const *) p_desc;
+
+      if ( TUSB_XFER_ISOCHRONOUS == desc_ep->bmAttributes.xfer )
+      {
+        uint16_t const ep_size = tu_edpt_packet_size(desc_ep);
+        TU_ASSERT(ep_size <= CFG_TUD_ZERO_ISO_BUFSIZE);
+        TU_ASSERT(usbd_edpt_open(rhport, desc_ep));
+
+        if ( tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN )
+        {
+          p_zero->ep_iso_in   = desc_ep->bEndpointAddress;
+          p_zero->iso_in_size = ep_size;
+          pattern_fill(p_zero->pattern, p_zero->iso_in_buf, ep_size, ep_size);
+        }else
+        {
+          p_zero->ep_iso_out   = desc_ep->bEndpointAddress;
+          p_zero->iso_out_size = ep_size;
+        }
+      }
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return true;
+}
+
+static void iso_close(uint8_t rhport)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+
+  if ( p_zero->ep_iso_in  ) usbd_edpt_close(rhport, p_zero->ep_iso_in);
+  if ( p_zero->ep_iso_out ) usbd_edpt_close(rhport, p_zero->ep_iso_out);
+
+  p_zero->ep_iso_in  = 0;
+  p_zero->ep_iso_out = 0;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Loopback
+//--------------------------------------------------------------------+
+static void loopback_xfer(uint8_t rhport)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+
+  if ( !p_zero->ep_lb_in ) return;
+
+  // send back oldest received buffer
+  if ( p_zero->lb_count && usbd_edpt_ready(rhport, p_zero->ep_lb_in) )
+  {
+    uint8_t const idx = p_zero->lb_head;
+    usbd_edpt_xfer(rhport, p_zero->ep_lb_in, p_zero->lb_buf[idx], p_zero->lb_len[idx]);
+  }
+
+  // receive into next free buffer
+  if ( (p_zero->lb_count < LOOPBACK_BUFCOUNT) && usbd_edpt_ready(rhport, p_zero->ep_lb_out) )
+  {
+    uint8_t const idx = (uint8_t) ((p_zero->lb_head + p_zero->lb_count) % LOOPBACK_BUFCOUNT);
+    usbd_edpt_xfer(rhport, p_zero->ep_lb_out, p_zero->lb_buf[idx], CFG_TUD_ZERO_BUFSIZE);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+void tud_zero_set_pattern(tud_zero_pattern_t pattern)
+{
+  _zerod_itf.pattern = (uint8_t) pattern;
+}
+
+void tud_zero_get_stats(tud_zero_stats_t* stats, bool clear)
+{
+  *stats = _zerod_itf.stats;
+  if ( clear ) tu_memclr(&_zerod_itf.stats, sizeof(tud_zero_stats_t));
+}
+
+bool tud_zero_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+
+  TU_VERIFY(TUSB_REQ_TYPE_VENDOR == request->bmRequestType_bit.type);
+
+  switch ( request->bRequest )
+  {
+    case TUD_ZERO_REQ_CTRL_WRITE:
+      TU_VERIFY(request->bmRequestType_bit.direction == TUSB_DIR_OUT && request->wLength <= CFG_TUD_ZERO_CTRL_BUFSIZE);
+
+      if ( stage == CONTROL_STAGE_SETUP )
+      {
+        return tud_control_xfer(rhport, request, p_zero->ctrl_buf, request->wLength);
+      }
+      else if ( stage == CONTROL_STAGE_DATA )
+      {
+        p_zero->ctrl_len = request->wLength;
+      }
+    break;
+
+    case TUD_ZERO_REQ_CTRL_READ:
+      TU_VERIFY(request->bmRequestType_bit.direction == TUSB_DIR_IN);
+
+      if ( stage == CONTROL_STAGE_SETUP )
+      {
+        // return what was written, host may ask for less
+        return tud_control_xfer(rhport, request, p_zero->ctrl_buf, tu_min16(request->wLength, CFG_TUD_ZERO_CTRL_BUFSIZE));
+      }
+    break;
+
+    default: return false;
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// USBD Driver API
+//--------------------------------------------------------------------+
+void zerod_init(void)
+{
+  tu_memclr(&_zerod_itf, sizeof(_zerod_itf));
+}
+
+void zerod_reset(uint8_t rhport)
+{
+  (void) rhport;
+  tu_memclr(&_zerod_itf, ITF_MEM_RESET_SIZE);
+}
+
+uint16_t zerod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+
+  TU_VERIFY(TUSB_CLASS_VENDOR_SPECIFIC == itf_desc->bInterfaceClass &&
+            TUD_ZERO_SUBCLASS          == itf_desc->bInterfaceSubClass &&
+            itf_desc->bNumEndpoints    == 2, 0);
+
+  uint8_t const protocol = itf_desc->bInterfaceProtocol;
+  TU_VERIFY(protocol == TUD_ZERO_PROTOCOL_SOURCESINK || protocol == TUD_ZERO_PROTOCOL_LOOPBACK, 0);
+
+  // only one function of each kind
+  TU_VERIFY(protocol == TUD_ZERO_PROTOCOL_SOURCESINK ? !p_zero->ep_source : !p_zero->ep_lb_in, 0);
+
+  uint8_t const * p_desc   = tu_desc_next(itf_desc);
+  uint8_t const * desc_end = ((uint8_t const *) itf_desc) + max_len;
+
+  // skip non-endpoint descriptors
+  while ( (p_desc < desc_end) && (TUSB_DESC_ENDPOINT != tu_desc_type(p_desc)) ) p_desc = tu_desc_next(p_desc);
+  TU_VERIFY(p_desc < desc_end, 0);
+
+  uint8_t ep_out = 0, ep_in = 0;
+  TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &ep_out, &ep_in), 0);
+
+  // actual packet size of each endpoint, transfers of CFG_TUD_ZERO_BUFSIZE must be a whole number of packets
+  uint16_t out_mps = 0, in_mps = 0;
+  for ( uint8_t i = 0; i < 2; i++ )
+  {
+    tusb_desc_endpoint_t const * desc_ep = (tusb_desc_endpoint_t const *) p_desc;
+    uint16_t const mps = tu_edpt_packet_size(desc_ep);
+    TU_ASSERT(mps && (CFG_TUD_ZERO_BUFSIZE % mps == 0), 0);
+
+    if ( tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN ) in_mps = mps;
+    else out_mps = mps;
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  if ( protocol == TUD_ZERO_PROTOCOL_SOURCESINK )
+  {
+    p_zero->ss_itf_num = itf_desc->bInterfaceNumber;
+    p_zero->ep_source  = ep_in;
+    p_zero->ep_sink    = ep_out;
+    p_zero->source_mps = in_mps;
+    p_zero->sink_mps   = out_mps;
+
+    // claim alternate 1 with ISO endpoints if present
+    if ( (p_desc < desc_end) && (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) &&
+         (((tusb_desc_interface_t const *) p_desc)->bInterfaceNumber == itf_desc->bInterfaceNumber) )
+    {
+      p_zero->ss_alt1_desc = p_desc;
+
+      do
+      {
+        p_desc = tu_desc_next(p_desc);
+      } while ( (p_desc < desc_end) && (TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) &&
+                (TUSB_DESC_INTERFACE_ASSOCIATION != tu_desc_type(p_desc)) );
+
+      p_zero->ss_alt1_end = p_desc;
+    }
+
+    pattern_fill(p_zero->pattern, p_zero->source_buf, CFG_TUD_ZERO_BUFSIZE, p_zero->source_mps);
+
+    source_xfer(rhport);
+    sink_xfer(rhport);
+  }else
+  {
+    p_zero->lb_itf_num = itf_desc->bInterfaceNumber;
+    p_zero->ep_lb_in   = ep_in;
+    p_zero->ep_lb_out  = ep_out;
+
+    loopback_xfer(rhport);
+  }
+
+  return (uint16_t) (p_desc - (uint8_t const *) itf_desc);
+}
+
+bool zerod_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+
+  // test requests can also be sent to interface
+  if ( TUSB_REQ_TYPE_VENDOR == request->bmRequestType_bit.type ) return tud_zero_control_xfer_cb(rhport, stage, request);
+
+  TU_VERIFY(TUSB_REQ_TYPE_STANDARD == request->bmRequestType_bit.type);
+
+  // only handle the SETUP stage of standard requests
+  if ( stage != CONTROL_STAGE_SETUP ) return true;
+
+  if ( TUSB_REQ_RCPT_ENDPOINT == request->bmRequestType_bit.recipient )
+  {
+    // restart transfers once host clears halt e.g usbtest halt test
+    if ( TUSB_REQ_CLEAR_FEATURE == request->bRequest )
+    {
+      source_xfer(rhport);
+      sink_xfer(rhport);
+      loopback_xfer(rhport);
+    }
+    return true;
+  }
+
+  TU_VERIFY(TUSB_REQ_RCPT_INTERFACE == request->bmRequestType_bit.recipient);
+
+  uint8_t const itf_num = tu_u16_low(request->wIndex);
+  bool const is_ss = p_zero->ep_source && (itf_num == p_zero->ss_itf_num);
+
+  switch ( request->bRequest )
+  {
+    case TUSB_REQ_GET_INTERFACE:
+      // loopback only has alternate 0
+      tud_control_xfer(rhport, request, is_ss ? &p_zero->ss_alt : &p_zero->lb_alt, 1);
+    break;
+
+    case TUSB_REQ_SET_INTERFACE:
+    {
+      uint8_t const req_alt = tu_u16_low(request->wValue);
+
+      if ( req_alt != (is_ss ? p_zero->ss_alt : 0) )
+      {
+        // alternate 1 of source/sink adds ISO endpoints
+        TU_VERIFY(is_ss && req_alt < 2 && p_zero->ss_alt1_desc);
+
+#if CFG_TUD_ZERO_ISO_BUFSIZE
+        if ( req_alt )
+        {
+          TU_VERIFY(iso_open(rhport));
+          iso_xfer(rhport);
+        }else
+        {
+          iso_close(rhport);
+        }
+
+        p_zero->ss_alt = req_alt;
+#else
+        return false;
+#endif
+      }
+
+      tud_control_status(rhport, request);
+    }
+    break;
+
+    default: return false;
+  }
+
+  return true;
+}
+
+bool zerod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+  zerod_interface_t* p_zero = &_zerod_itf;
+  bool const success = (result == XFER_RESULT_SUCCESS);
+
+  if ( ep_addr == p_zero->ep_source )
+  {
+    if ( success ) p_zero->stats.source_bytes += xferred_bytes;
+    source_xfer(rhport);
+  }
+  else if ( ep_addr == p_zero->ep_sink )
+  {
+    if ( success && pattern_verify(p_zero->pattern, p_zero->sink_buf, xferred_bytes, p_zero->sink_mps) )
+    {
+      p_zero->stats.sink_bytes += xferred_bytes;
+      sink_xfer(rhport);
+    }else
+    {
+      // halt as gadget zero does, restarted when host clears it
+      p_zero->stats.sink_errors++;
+      usbd_edpt_stall(rhport, ep_addr);
+    }
+  }
+  else if ( ep_addr == p_zero->ep_lb_out )
+  {
+    if ( success )
+    {
+      uint8_t const idx = (uint8_t) ((p_zero->lb_head + p_zero->lb_count) % LOOPBACK_BUFCOUNT);
+      p_zero->lb_len[idx] = (uint16_t) xferred_bytes;
+      p_zero->lb_count++;
+    }
+    loopback_xfer(rhport);
+  }
+  else if ( ep_addr == p_zero->ep_lb_in )
+  {
+    if ( success ) p_zero->stats.loopback_bytes += xferred_bytes;
+
+    p_zero->lb_head = (uint8_t) ((p_zero->lb_head + 1) % LOOPBACK_BUFCOUNT);
+    p_zero->lb_count--;
+    loopback_xfer(rhport);
+  }
+#if CFG_TUD_ZERO_ISO_BUFSIZE
+  else if ( ep_addr == p_zero->ep_iso_in || ep_addr == p_zero->ep_iso_out )
+  {
+    if ( ep_addr == p_zero->ep_iso_in ) p_zero->stats.iso_in_bytes  += xferred_bytes;
+    else                                p_zero->stats.iso_out_bytes += xferred_bytes;
+
+    iso_xfer(rhport);
+  }
+#endif
+  else
+  {
+    return false;
+  }
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_ZERO_DEVICE_H_
+#define _TUSB_ZERO_DEVICE_H_
+
+#include "common/tusb_common.h"
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Size of bulk transfers of source, sink and each loopback buffer. Multiple of bulk packet size.
+#ifndef CFG_TUD_ZERO_BUFSIZE
+#define CFG_TUD_ZERO_BUFSIZE            (TUD_OPT_HIGH_SPEED ? 4096 : 1024)
+#endif
+
+// Number of loopback buffers: received data is sent back from one while receiving into the others
+#ifndef CFG_TUD_ZERO_LOOPBACK_BUFCOUNT
+#define CFG_TUD_ZERO_LOOPBACK_BUFCOUNT  2
+#endif
+
+// Size of isochronous source/sink buffer, must be at least ISO endpoint size. Zero to disable ISO alternate.
+#ifndef CFG_TUD_ZERO_ISO_BUFSIZE
+#define CFG_TUD_ZERO_ISO_BUFSIZE        0
+#endif
+
+// Size of buffer for vendor control write/read tests
+#ifndef CFG_TUD_ZERO_CTRL_BUFSIZE
+#define CFG_TUD_ZERO_CTRL_BUFSIZE       256
+#endif
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Interface subclass to tell test functions from other vendor interfaces, protocol selects the function
+#define TUD_ZERO_SUBCLASS               0x5A
+
+enum
+{
+  TUD_ZERO_PROTOCOL_SOURCESINK = 0x01,
+  TUD_ZERO_PROTOCOL_LOOPBACK   = 0x02,
+};
+
+// Vendor control requests of Linux usbtest control write/read tests (test 10 & 14)
+enum
+{
+  TUD_ZERO_REQ_CTRL_WRITE = 0x5b,
+  TUD_ZERO_REQ_CTRL_READ  = 0x5c,
+};
+
+// Data pattern of source, also verified by sink. Same as Linux gadget zero "pattern" parameter.
+typedef enum
+{
+  TUD_ZERO_PATTERN_ZERO  = 0, // all zeros
+  TUD_ZERO_PATTERN_MOD63 = 1, // (byte offset within packet) % 63
+  TUD_ZERO_PATTERN_NONE  = 2, // source sends uninitialized buffer, sink does not verify
+} tud_zero_pattern_t;
+
+typedef struct
+{
+  uint64_t source_bytes;  // bytes sent by bulk source
+  uint64_t sink_bytes;    // bytes received by bulk sink
+  uint64_t loopback_bytes;// bytes echoed by loopback
+  uint64_t iso_in_bytes;
+  uint64_t iso_out_bytes;
+  uint32_t sink_errors;   // transfers failed verification or with error status
+} tud_zero_stats_t;
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Set pattern of source and sink verification, takes effect on next configuration (default TUD_ZERO_PATTERN_ZERO)
+void tud_zero_set_pattern(tud_zero_pattern_t pattern);
+
+// Get transfer statistics, optionally clear them
+void tud_zero_get_stats(tud_zero_stats_t* stats, bool clear);
+
+// Handle usbtest vendor control write/read tests addressed to device.
+// Call from tud_vendor_control_xfer_cb(), return false if request is not a test request.
+bool tud_zero_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (WEAK is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when sink receives data not matching the pattern, endpoint is stalled as gadget zero does
+TU_ATTR_WEAK void tud_zero_sink_error_cb(uint32_t offset, uint8_t expected, uint8_t received);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void     zerod_init            (void);
+void     zerod_reset           (uint8_t rhport);
+uint16_t zerod_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
+bool     zerod_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
+bool     zerod_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_ZERO_DEVICE_H_ */
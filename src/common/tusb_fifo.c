@@ -64,9 +64,9 @@ typedef enum
   TU_FIFO_COPY_CST_FULL_WORDS, ///< Copy from/to a constant source/destination address - required for e.g. STM32 to write into USB hardware FIFO
 } tu_fifo_copy_mode_t;
 
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable)
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable)
 {
-  if (depth > 0x8000) return false;               // Maximum depth is 2^15 items
+  if (depth > TU_FIFO_DEPTH_MAX) return false;    // Maximum depth is 2^15 items (2^31 with 32-bit index)
 
   _ff_lock(f->mutex_wr);
   _ff_lock(f->mutex_rd);
@@ -77,10 +77,10 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
   f->overwritable = overwritable;
 
   // Limit index space to 2*depth - this allows for a fast "modulo" calculation
-  // but limits the maximum depth to 2^16/2 = 2^15 and buffer overflows are detectable
+  // but limits the maximum depth to 2^16/2 = 2^15 (2^31 with 32-bit index) and buffer overflows are detectable
   // only if overflow happens once (important for unsupervised DMA applications)
-  f->max_pointer_idx = (uint16_t) (2*depth - 1);
-  f->non_used_index_space = UINT16_MAX - f->max_pointer_idx;
+  f->max_pointer_idx = (tu_fifo_idx_t) (2*depth - 1);
+  f->non_used_index_space = TU_FIFO_IDX_MAX - f->max_pointer_idx;
 
   f->rd_idx = f->wr_idx = 0;
 
@@ -91,7 +91,12 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
 }
 
 // Static functions are intended to work on local variables
-static inline uint16_t _ff_mod(uint16_t idx, uint16_t depth)
+static inline tu_fifo_idx_t _ff_min(tu_fifo_idx_t x, tu_fifo_idx_t y)
+{
+  return (x < y) ? x : y;
+}
+
+static inline tu_fifo_idx_t _ff_mod(tu_fifo_idx_t idx, tu_fifo_idx_t depth)
 {
   while ( idx >= depth) idx -= depth;
   return idx;
@@ -100,12 +105,12 @@ static inline uint16_t _ff_mod(uint16_t idx, uint16_t depth)
 // Intended to be used to read from hardware USB FIFO in e.g. STM32 where all data is read from a constant address
 // Code adapted from dcd_synopsys.c
 // TODO generalize with configurable 1 byte or 4 byte each read
-static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t len)
+static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint32_t len)
 {
   volatile const uint32_t * rx_fifo = (volatile const uint32_t *) app_buf;
 
   // Reading full available 32 bit words from const app address
-  uint16_t full_words = len >> 2;
+  uint32_t full_words = len >> 2;
   while(full_words--)
   {
     tu_unaligned_write32(ff_buf, *rx_fifo);
@@ -123,12 +128,12 @@ static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t
 
 // Intended to be used to write to hardware USB FIFO in e.g. STM32
 // where all data is written to a constant address in full word copies
-static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t len)
+static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint32_t len)
 {
   volatile uint32_t * tx_fifo = (volatile uint32_t *) app_buf;
 
   // Pushing full available 32 bit words to const app address
-  uint16_t full_words = len >> 2;
+  uint32_t full_words = len >> 2;
   while(full_words--)
   {
     *tx_fifo = tu_unaligned_read32(ff_buf);
@@ -147,19 +152,19 @@ static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t
 }
 
 // send one item to FIFO WITHOUT updating write pointer
-static inline void _ff_push(tu_fifo_t* f, void const * app_buf, uint16_t rel)
+static inline void _ff_push(tu_fifo_t* f, void const * app_buf, tu_fifo_idx_t rel)
 {
   memcpy(f->buffer + (rel * f->item_size), app_buf, f->item_size);
 }
 
 // send n items to FIFO WITHOUT updating write pointer
-static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t rel, tu_fifo_copy_mode_t copy_mode)
+static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, tu_fifo_idx_t rel, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const nLin = f->depth - rel;
-  uint16_t const nWrap = n - nLin;
+  tu_fifo_idx_t const nLin = f->depth - rel;
+  tu_fifo_idx_t const nWrap = n - nLin;
 
-  uint16_t nLin_bytes = nLin * f->item_size;
-  uint16_t nWrap_bytes = nWrap * f->item_size;
+  uint32_t nLin_bytes = nLin * f->item_size;
+  uint32_t nWrap_bytes = nWrap * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (rel * f->item_size);
@@ -196,7 +201,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         // Wrap around case
 
         // Write full words to linear part of buffer
-        uint16_t nLin_4n_bytes = nLin_bytes & 0xFFFC;
+        uint32_t nLin_4n_bytes = nLin_bytes & 0xFFFFFFFCu;
         _ff_push_const_addr(ff_buf, app_buf, nLin_4n_bytes);
         ff_buf += nLin_4n_bytes;
 
@@ -205,7 +210,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         uint8_t rem = nLin_bytes & 0x03;
         if (rem > 0)
         {
-          uint8_t remrem = (uint8_t) tu_min16(nWrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) tu_min32(nWrap_bytes, 4u-rem);
           nWrap_bytes -= remrem;
 
           uint32_t tmp32 = *rx_fifo;
@@ -231,19 +236,19 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
 }
 
 // get one item from FIFO WITHOUT updating read pointer
-static inline void _ff_pull(tu_fifo_t* f, void * app_buf, uint16_t rel)
+static inline void _ff_pull(tu_fifo_t* f, void * app_buf, tu_fifo_idx_t rel)
 {
   memcpy(app_buf, f->buffer + (rel * f->item_size), f->item_size);
 }
 
 // get n items from FIFO WITHOUT updating read pointer
-static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rel, tu_fifo_copy_mode_t copy_mode)
+static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, tu_fifo_idx_t rel, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const nLin = f->depth - rel;
-  uint16_t const nWrap = n - nLin; // only used if wrapped
+  tu_fifo_idx_t const nLin = f->depth - rel;
+  tu_fifo_idx_t const nWrap = n - nLin; // only used if wrapped
 
-  uint16_t nLin_bytes = nLin * f->item_size;
-  uint16_t nWrap_bytes = nWrap * f->item_size;
+  uint32_t nLin_bytes = nLin * f->item_size;
+  uint32_t nWrap_bytes = nWrap * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (rel * f->item_size);
@@ -279,7 +284,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rel, tu
         // Wrap around case
 
         // Read full words from linear part of buffer
-        uint16_t nLin_4n_bytes = nLin_bytes & 0xFFFC;
+        uint32_t nLin_4n_bytes = nLin_bytes & 0xFFFFFFFCu;
         _ff_pull_const_addr(app_buf, ff_buf, nLin_4n_bytes);
         ff_buf += nLin_4n_bytes;
 
@@ -288,7 +293,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rel, tu
         uint8_t rem = nLin_bytes & 0x03;
         if (rem > 0)
         {
-          uint8_t remrem = (uint8_t) tu_min16(nWrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) tu_min32(nWrap_bytes, 4u-rem);
           nWrap_bytes -= remrem;
 
           uint32_t tmp32=0;
@@ -318,14 +323,14 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rel, tu
 }
 
 // Advance an absolute pointer
-static uint16_t advance_pointer(tu_fifo_t* f, uint16_t p, uint16_t offset)
+static tu_fifo_idx_t advance_pointer(tu_fifo_t* f, tu_fifo_idx_t p, tu_fifo_idx_t offset)
 {
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  if ((p > (uint16_t)(p + offset)) || ((uint16_t)(p + offset) > f->max_pointer_idx))
+  if ((p > (tu_fifo_idx_t)(p + offset)) || ((tu_fifo_idx_t)(p + offset) > f->max_pointer_idx))
   {
-    p = (uint16_t) ((p + offset) + f->non_used_index_space);
+    p = (tu_fifo_idx_t) ((p + offset) + f->non_used_index_space);
   }
   else
   {
@@ -335,14 +340,14 @@ static uint16_t advance_pointer(tu_fifo_t* f, uint16_t p, uint16_t offset)
 }
 
 // Backward an absolute pointer
-static uint16_t backward_pointer(tu_fifo_t* f, uint16_t p, uint16_t offset)
+static tu_fifo_idx_t backward_pointer(tu_fifo_t* f, tu_fifo_idx_t p, tu_fifo_idx_t offset)
 {
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  if ((p < (uint16_t)(p - offset)) || ((uint16_t)(p - offset) > f->max_pointer_idx))
+  if ((p < (tu_fifo_idx_t)(p - offset)) || ((tu_fifo_idx_t)(p - offset) > f->max_pointer_idx))
   {
-    p = (uint16_t) ((p - offset) - f->non_used_index_space);
+    p = (tu_fifo_idx_t) ((p - offset) - f->non_used_index_space);
   }
   else
   {
@@ -352,15 +357,15 @@ static uint16_t backward_pointer(tu_fifo_t* f, uint16_t p, uint16_t offset)
 }
 
 // get relative from absolute pointer
-static uint16_t get_relative_pointer(tu_fifo_t* f, uint16_t p)
+static tu_fifo_idx_t get_relative_pointer(tu_fifo_t* f, tu_fifo_idx_t p)
 {
   return _ff_mod(p, f->depth);
 }
 
 // Works on local copies of w and r - return only the difference and as such can be used to determine an overflow
-static inline uint16_t _tu_fifo_count(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
+static inline tu_fifo_idx_t _tu_fifo_count(tu_fifo_t* f, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
-  uint16_t cnt = wAbs-rAbs;
+  tu_fifo_idx_t cnt = wAbs-rAbs;
 
   // In case we have non-power of two depth we need a further modification
   if (rAbs > wAbs) cnt -= f->non_used_index_space;
@@ -369,13 +374,13 @@ static inline uint16_t _tu_fifo_count(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs
 }
 
 // Works on local copies of w and r
-static inline bool _tu_fifo_empty(uint16_t wAbs, uint16_t rAbs)
+static inline bool _tu_fifo_empty(tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
   return wAbs == rAbs;
 }
 
 // Works on local copies of w and r
-static inline bool _tu_fifo_full(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
+static inline bool _tu_fifo_full(tu_fifo_t* f, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
   return (_tu_fifo_count(f, wAbs, rAbs) == f->depth);
 }
@@ -386,23 +391,23 @@ static inline bool _tu_fifo_full(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
 // write more than 2*depth-1 items in one rush without updating write pointer. Otherwise
 // write pointer wraps and you pointer states are messed up. This can only happen if you
 // use DMAs, write functions do not allow such an error.
-static inline bool _tu_fifo_overflowed(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
+static inline bool _tu_fifo_overflowed(tu_fifo_t* f, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
   return (_tu_fifo_count(f, wAbs, rAbs) > f->depth);
 }
 
 // Works on local copies of w
 // For more details see _tu_fifo_overflow()!
-static inline void _tu_fifo_correct_read_pointer(tu_fifo_t* f, uint16_t wAbs)
+static inline void _tu_fifo_correct_read_pointer(tu_fifo_t* f, tu_fifo_idx_t wAbs)
 {
   f->rd_idx = backward_pointer(f, wAbs, f->depth);
 }
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wAbs, uint16_t rAbs)
+static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
-  uint16_t cnt = _tu_fifo_count(f, wAbs, rAbs);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, wAbs, rAbs);
 
   // Check overflow and correct if required
   if (cnt > f->depth)
@@ -414,7 +419,7 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wAbs, uint16_t
   // Skip beginning of buffer
   if (cnt == 0) return false;
 
-  uint16_t rRel = get_relative_pointer(f, rAbs);
+  tu_fifo_idx_t rRel = get_relative_pointer(f, rAbs);
 
   // Peek data
   _ff_pull(f, p_buffer, rRel);
@@ -424,9 +429,9 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wAbs, uint16_t
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint16_t wAbs, uint16_t rAbs, tu_fifo_copy_mode_t copy_mode)
+static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t cnt = _tu_fifo_count(f, wAbs, rAbs);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, wAbs, rAbs);
 
   // Check overflow and correct if required
   if (cnt > f->depth)
@@ -440,9 +445,9 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
   if (cnt == 0) return 0;
 
   // Check if we can read something at and after offset - if too less is available we read what remains
-  if (cnt < n) n = cnt;
+  if (cnt < n) n = (uint16_t) cnt;
 
-  uint16_t rRel = get_relative_pointer(f, rAbs);
+  tu_fifo_idx_t rRel = get_relative_pointer(f, rAbs);
 
   // Peek data
   _ff_pull_n(f, p_buffer, n, rRel, copy_mode);
@@ -451,7 +456,7 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
 }
 
 // Works on local copies of w and r
-static inline uint16_t _tu_fifo_remaining(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
+static inline tu_fifo_idx_t _tu_fifo_remaining(tu_fifo_t* f, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
   return f->depth - _tu_fifo_count(f, wAbs, rAbs);
 }
@@ -462,19 +467,19 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
 
   _ff_lock(f->mutex_wr);
 
-  uint16_t w = f->wr_idx, r = f->rd_idx;
+  tu_fifo_idx_t w = f->wr_idx, r = f->rd_idx;
   uint8_t const* buf8 = (uint8_t const*) data;
 
   if (!f->overwritable)
   {
     // Not overwritable limit up to full
-    n = tu_min16(n, _tu_fifo_remaining(f, w, r));
+    n = (uint16_t) _ff_min(n, _tu_fifo_remaining(f, w, r));
   }
   else if (n >= f->depth)
   {
     // Only copy last part
     buf8 = buf8 + (n - f->depth) * f->item_size;
-    n = f->depth;
+    n = (uint16_t) f->depth;
 
     // We start writing at the read pointer's position since we fill the complete
     // buffer and we do not want to modify the read pointer within a write function!
@@ -482,7 +487,7 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     w = r;
   }
 
-  uint16_t wRel = get_relative_pointer(f, w);
+  tu_fifo_idx_t wRel = get_relative_pointer(f, w);
 
   // Write data
   _ff_push_n(f, buf8, n, wRel, copy_mode);
@@ -525,9 +530,9 @@ static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_count(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_count(tu_fifo_t* f)
 {
-  return tu_min16(_tu_fifo_count(f, f->wr_idx, f->rd_idx), f->depth);
+  return _ff_min(_tu_fifo_count(f, f->wr_idx, f->rd_idx), f->depth);
 }
 
 /******************************************************************************/
@@ -579,7 +584,7 @@ bool tu_fifo_full(tu_fifo_t* f)
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_remaining(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_remaining(tu_fifo_t* f)
 {
   return _tu_fifo_remaining(f, f->wr_idx, f->rd_idx);
 }
@@ -675,6 +680,40 @@ uint16_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, uint1
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
 
+/******************************************************************************/
+/*!
+    @brief Remove up to n items from the FIFO without copying them.
+    This function checks for an overflow and corrects read pointer if required.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  n
+                Maximum number of items to remove
+
+    @returns Number of items removed
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_discard_n(tu_fifo_t* f, tu_fifo_idx_t n)
+{
+  _ff_lock(f->mutex_rd);
+
+  tu_fifo_idx_t const w = f->wr_idx;
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, w, f->rd_idx);
+
+  // Check overflow and correct if required
+  if (cnt > f->depth)
+  {
+    _tu_fifo_correct_read_pointer(f, w);
+    cnt = f->depth;
+  }
+
+  n = _ff_min(n, cnt);
+  f->rd_idx = advance_pointer(f, f->rd_idx, n);
+
+  _ff_unlock(f->mutex_rd);
+  return n;
+}
+
 /******************************************************************************/
 /*!
     @brief Read one item without removing it from the FIFO.
@@ -740,14 +779,14 @@ bool tu_fifo_write(tu_fifo_t* f, const void * data)
   _ff_lock(f->mutex_wr);
 
   bool ret;
-  uint16_t const w = f->wr_idx;
+  tu_fifo_idx_t const w = f->wr_idx;
 
   if ( _tu_fifo_full(f, w, f->rd_idx) && !f->overwritable )
   {
     ret = false;
   }else
   {
-    uint16_t wRel = get_relative_pointer(f, w);
+    tu_fifo_idx_t wRel = get_relative_pointer(f, w);
 
     // Write data
     _ff_push(f, data, wRel);
@@ -816,8 +855,8 @@ bool tu_fifo_clear(tu_fifo_t *f)
   _ff_lock(f->mutex_rd);
 
   f->rd_idx = f->wr_idx = 0;
-  f->max_pointer_idx = (uint16_t) (2*f->depth-1);
-  f->non_used_index_space = UINT16_MAX - f->max_pointer_idx;
+  f->max_pointer_idx = (tu_fifo_idx_t) (2*f->depth-1);
+  f->non_used_index_space = TU_FIFO_IDX_MAX - f->max_pointer_idx;
 
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
@@ -863,7 +902,7 @@ bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable)
                 Number of items the write pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
+void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_idx_t n)
 {
   f->wr_idx = advance_pointer(f, f->wr_idx, n);
 }
@@ -884,11 +923,27 @@ void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
                 Number of items the read pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
+void tu_fifo_advance_read_pointer(tu_fifo_t *f, tu_fifo_idx_t n)
 {
   f->rd_idx = advance_pointer(f, f->rd_idx, n);
 }
 
+// Buffer info lengths are 16-bit: with 32-bit index, report at most UINT16_MAX linear items and no wrapped part
+static void _ff_set_info_len(tu_fifo_buffer_info_t *info, tu_fifo_idx_t len_lin, tu_fifo_idx_t len_wrap)
+{
+#if CFG_TUSB_FIFO_INDEX_32BIT
+  if (len_lin > UINT16_MAX)
+  {
+    len_lin  = UINT16_MAX;
+    len_wrap = 0;
+  }
+  len_wrap = _ff_min(len_wrap, UINT16_MAX);
+#endif
+
+  info->len_lin  = (uint16_t) len_lin;
+  info->len_wrap = (uint16_t) len_wrap;
+}
+
 /******************************************************************************/
 /*!
    @brief Get read info
@@ -907,9 +962,9 @@ void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
 void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 {
   // Operate on temporary values in case they change in between
-  uint16_t w = f->wr_idx, r = f->rd_idx;
+  tu_fifo_idx_t w = f->wr_idx, r = f->rd_idx;
 
-  uint16_t cnt = _tu_fifo_count(f, w, r);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, w, r);
 
   // Check overflow and correct if required - may happen in case a DMA wrote too fast
   if (cnt > f->depth)
@@ -941,14 +996,13 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
   // Check if there is a wrap around necessary
   if (w > r) {
     // Non wrapping case
-    info->len_lin  = cnt;
-    info->len_wrap = 0;
+    _ff_set_info_len(info, cnt, 0);
     info->ptr_wrap = NULL;
   }
   else
   {
-    info->len_lin  = f->depth - r;         // Also the case if FIFO was full
-    info->len_wrap = cnt - info->len_lin;
+    tu_fifo_idx_t const len_lin = f->depth - r; // Also the case if FIFO was full
+    _ff_set_info_len(info, len_lin, cnt - len_lin);
     info->ptr_wrap = f->buffer;
   }
 }
@@ -970,8 +1024,8 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 /******************************************************************************/
 void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 {
-  uint16_t w = f->wr_idx, r = f->rd_idx;
-  uint16_t free = _tu_fifo_remaining(f, w, r);
+  tu_fifo_idx_t w = f->wr_idx, r = f->rd_idx;
+  tu_fifo_idx_t free = _tu_fifo_remaining(f, w, r);
 
   if (free == 0)
   {
@@ -992,14 +1046,130 @@ void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
   if (w < r)
   {
     // Non wrapping case
-    info->len_lin = r-w;
-    info->len_wrap = 0;
+    _ff_set_info_len(info, r-w, 0);
     info->ptr_wrap = NULL;
   }
   else
   {
-    info->len_lin = f->depth - w;
-    info->len_wrap = free - info->len_lin; // Remaining length - n already was limited to free or FIFO depth
-    info->ptr_wrap = f->buffer;            // Always start of buffer
+    tu_fifo_idx_t const len_lin = f->depth - w;
+    _ff_set_info_len(info, len_lin, free - len_lin); // Remaining length - n already was limited to free or FIFO depth
+    info->ptr_wrap = f->buffer;                      // Always start of buffer
   }
 }
+
+/******************************************************************************/
+/*!
+   @brief Reserve space for a zero-copy write
+
+   Returns pointer and number of items that can be written directly into the
+   FIFO buffer in a linear manner (up to n, less if buffer wraps or FIFO is
+   almost full). Written items become visible to reader only after
+   tu_fifo_write_commit() is called. Space is never overwritten, even if FIFO
+   is overwritable.
+   Write mutex is held until tu_fifo_write_commit(), which must always be
+   called (with zero if nothing is written).
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      pp_buf
+                    Pointer to start of reserved space, invalid if returned
+                    length is zero
+   @param[in]       n
+                    Maximum number of items to reserve
+
+   @returns Number of items reserved
+ */
+/******************************************************************************/
+uint16_t tu_fifo_write_reserve(tu_fifo_t *f, void** pp_buf, uint16_t n)
+{
+  _ff_lock(f->mutex_wr);
+
+  tu_fifo_idx_t const w    = f->wr_idx;
+  tu_fifo_idx_t const wRel = get_relative_pointer(f, w);
+
+  // Limit to free space and to end of buffer
+  n = (uint16_t) _ff_min(n, _tu_fifo_remaining(f, w, f->rd_idx));
+  n = (uint16_t) _ff_min(n, f->depth - wRel);
+
+  *pp_buf = f->buffer + (wRel * f->item_size);
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Commit items written into space from tu_fifo_write_reserve()
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items written, must not be greater than reserved
+ */
+/******************************************************************************/
+void tu_fifo_write_commit(tu_fifo_t *f, uint16_t n)
+{
+  f->wr_idx = advance_pointer(f, f->wr_idx, n);
+
+  _ff_unlock(f->mutex_wr);
+}
+
+/******************************************************************************/
+/*!
+   @brief Peek items for a zero-copy read
+
+   Returns pointer and number of items that can be read directly from the
+   FIFO buffer in a linear manner (up to n, less if buffer wraps). Items are
+   not removed until tu_fifo_read_release() is called. In case of an overflow
+   the read pointer is corrected first.
+   Read mutex is held until tu_fifo_read_release(), which must always be
+   called (with zero if nothing is consumed).
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      pp_buf
+                    Pointer to first item, invalid if returned length is zero
+   @param[in]       n
+                    Maximum number of items to peek
+
+   @returns Number of items available at pp_buf
+ */
+/******************************************************************************/
+uint16_t tu_fifo_read_peek_linear(tu_fifo_t *f, void const** pp_buf, uint16_t n)
+{
+  _ff_lock(f->mutex_rd);
+
+  tu_fifo_idx_t const w = f->wr_idx;
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, w, f->rd_idx);
+
+  // Check overflow and correct if required
+  if (cnt > f->depth)
+  {
+    _tu_fifo_correct_read_pointer(f, w);
+    cnt = f->depth;
+  }
+
+  tu_fifo_idx_t const rRel = get_relative_pointer(f, f->rd_idx);
+
+  // Limit to available items and to end of buffer
+  n = (uint16_t) _ff_min(n, cnt);
+  n = (uint16_t) _ff_min(n, f->depth - rRel);
+
+  *pp_buf = f->buffer + (rRel * f->item_size);
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Remove items obtained by tu_fifo_read_peek_linear()
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items consumed, must not be greater than peeked
+ */
+/******************************************************************************/
+void tu_fifo_read_release(tu_fifo_t *f, uint16_t n)
+{
+  f->rd_idx = advance_pointer(f, f->rd_idx, n);
+
+  _ff_unlock(f->mutex_rd);
+}
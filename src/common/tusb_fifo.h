@@ -50,18 +50,30 @@ extern "C" {
 // for OS None, we don't get preempted
 #define CFG_FIFO_MUTEX      OSAL_MUTEX_REQUIRED
 
+// Read/write index type: 16-bit limits depth to 2^15 items, 32-bit index (CFG_TUSB_FIFO_INDEX_32BIT)
+// allows depth up to 2^31 items e.g for buffering in external SDRAM, overflow detection is the same.
+#if CFG_TUSB_FIFO_INDEX_32BIT
+typedef uint32_t tu_fifo_idx_t;
+#define TU_FIFO_IDX_MAX     UINT32_MAX
+#else
+typedef uint16_t tu_fifo_idx_t;
+#define TU_FIFO_IDX_MAX     UINT16_MAX
+#endif
+
+#define TU_FIFO_DEPTH_MAX   ((TU_FIFO_IDX_MAX >> 1) + 1)
+
 typedef struct
 {
-  uint8_t* buffer               ; ///< buffer pointer
-  uint16_t depth                ; ///< max items
-  uint16_t item_size            ; ///< size of each item
-  bool overwritable             ;
+  uint8_t* buffer                    ; ///< buffer pointer
+  tu_fifo_idx_t depth                ; ///< max items
+  uint16_t item_size                 ; ///< size of each item
+  bool overwritable                  ;
 
-  uint16_t non_used_index_space ; ///< required for non-power-of-two buffer length
-  uint16_t max_pointer_idx      ; ///< maximum absolute pointer index
+  tu_fifo_idx_t non_used_index_space ; ///< required for non-power-of-two buffer length
+  tu_fifo_idx_t max_pointer_idx      ; ///< maximum absolute pointer index
 
-  volatile uint16_t wr_idx      ; ///< write pointer
-  volatile uint16_t rd_idx      ; ///< read pointer
+  volatile tu_fifo_idx_t wr_idx      ; ///< write pointer
+  volatile tu_fifo_idx_t rd_idx      ; ///< read pointer
 
 #if OSAL_MUTEX_REQUIRED
   tu_fifo_mutex_t mutex_wr;
@@ -72,7 +84,7 @@ typedef struct
 
 typedef struct
 {
-  uint16_t len_lin  ; ///< linear length in item size
+  uint16_t len_lin  ; ///< linear length in item size (at most UINT16_MAX with 32-bit index)
   uint16_t len_wrap ; ///< wrapped length in item size
   void * ptr_lin    ; ///< linear part start pointer
   void * ptr_wrap   ; ///< wrapped part start pointer
@@ -84,7 +96,7 @@ typedef struct
   .depth                = _depth,                           \
   .item_size            = sizeof(_type),                    \
   .overwritable         = _overwritable,                    \
-  .non_used_index_space = UINT16_MAX - (2*(_depth)-1),      \
+  .non_used_index_space = TU_FIFO_IDX_MAX - (2*(_depth)-1), \
   .max_pointer_idx      = 2*(_depth)-1,                     \
 }
 
@@ -95,7 +107,7 @@ typedef struct
 
 bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable);
 bool tu_fifo_clear(tu_fifo_t *f);
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable);
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable);
 
 #if OSAL_MUTEX_REQUIRED
 TU_ATTR_ALWAYS_INLINE static inline
@@ -118,27 +130,28 @@ uint16_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * da
 bool     tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
 uint16_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
 uint16_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, uint16_t n);
+tu_fifo_idx_t tu_fifo_discard_n         (tu_fifo_t* f, tu_fifo_idx_t n);
 
 bool     tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
 uint16_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
 
-uint16_t tu_fifo_count                  (tu_fifo_t* f);
-uint16_t tu_fifo_remaining              (tu_fifo_t* f);
+tu_fifo_idx_t tu_fifo_count             (tu_fifo_t* f);
+tu_fifo_idx_t tu_fifo_remaining         (tu_fifo_t* f);
 bool     tu_fifo_empty                  (tu_fifo_t* f);
 bool     tu_fifo_full                   (tu_fifo_t* f);
 bool     tu_fifo_overflowed             (tu_fifo_t* f);
 void     tu_fifo_correct_read_pointer   (tu_fifo_t* f);
 
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t tu_fifo_depth(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_depth(tu_fifo_t* f)
 {
   return f->depth;
 }
 
 // Pointer modifications intended to be used in combinations with DMAs.
 // USE WITH CARE - NO SAFETY CHECKS CONDUCTED HERE! NOT MUTEX PROTECTED!
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n);
-void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
+void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_idx_t n);
+void tu_fifo_advance_read_pointer (tu_fifo_t *f, tu_fifo_idx_t n);
 
 // If you want to read/write from/to the FIFO by use of a DMA, you may need to conduct two copies
 // to handle a possible wrapping part. These functions deliver a pointer to start
@@ -146,6 +159,14 @@ void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
 void tu_fifo_get_read_info (tu_fifo_t *f, tu_fifo_buffer_info_t *info);
 void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info);
 
+// Zero-copy access: producer writes directly into reserved FIFO memory then commits, consumer
+// reads directly from FIFO memory then releases. Space is linear (no wrap), call again for the rest.
+// Reserve/peek take the FIFO mutex which is given back by commit/release: calls must be paired.
+uint16_t tu_fifo_write_reserve   (tu_fifo_t *f, void** pp_buf, uint16_t n);
+void     tu_fifo_write_commit    (tu_fifo_t *f, uint16_t n);
+uint16_t tu_fifo_read_peek_linear(tu_fifo_t *f, void const** pp_buf, uint16_t n);
+void     tu_fifo_read_release    (tu_fifo_t *f, uint16_t n);
+
 
 #ifdef __cplusplus
 }
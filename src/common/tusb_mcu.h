@@ -64,6 +64,10 @@
   #define TUP_DCD_ENDPOINT_MAX    6
   #define TUP_RHPORT_HIGHSPEED    1 // Port0 HS, Port1 FS
 
+  #define TUP_DCD_EDPT0_ZERO_COPY 1
+  #define TUP_DCD_EDPT0_XFER_MAX  16384 // 4 qTD pages regardless of buffer offset
+  #define TUP_DCD_EDPT_XFER_QUEUE 1     // chain dTDs to queue transfers
+
 #elif TU_CHECK_MCU(OPT_MCU_LPC51UXX)
    #define TUP_DCD_ENDPOINT_MAX   5
 
@@ -82,6 +86,10 @@
   #define TUP_DCD_ENDPOINT_MAX    8
   #define TUP_RHPORT_HIGHSPEED    1 // Port0 HS, Port1 HS
 
+  #define TUP_DCD_EDPT0_ZERO_COPY 1
+  #define TUP_DCD_EDPT0_XFER_MAX  16384 // 4 qTD pages regardless of buffer offset
+  #define TUP_DCD_EDPT_XFER_QUEUE 1     // chain dTDs to queue transfers
+
 #elif TU_CHECK_MCU(OPT_MCU_MKL25ZXX, OPT_MCU_K32L2BXX)
   #define TUP_DCD_ENDPOINT_MAX    16
 
@@ -295,6 +303,36 @@
   #define TUP_RHPORT_HIGHSPEED    0
 #endif
 
+// DCD can transfer control data directly from/to any application buffer (including flash)
+#ifndef TUP_DCD_EDPT0_ZERO_COPY
+  #define TUP_DCD_EDPT0_ZERO_COPY 0
+#endif
+
+// Maximum bytes DCD can transfer with one dcd_edpt_xfer() on control endpoint,
+// 0 means one packet of CFG_TUD_ENDPOINT0_SIZE. Must be multiple of endpoint0 size.
+#ifndef TUP_DCD_EDPT0_XFER_MAX
+  #define TUP_DCD_EDPT0_XFER_MAX  0
+#endif
+
+// DCD dcd_edpt_xfer_fifo() is verified for multi-packet bulk transfers, not only isochronous ones
+#ifndef TUP_DCD_EDPT_XFER_FIFO_BULK
+  #define TUP_DCD_EDPT_XFER_FIFO_BULK 0
+#endif
+
+// DCD can accept more dcd_edpt_xfer() on an endpoint while a transfer is still in progress
+#ifndef TUP_DCD_EDPT_XFER_QUEUE
+  #define TUP_DCD_EDPT_XFER_QUEUE 0
+#endif
+
+// HCD can accept more hcd_edpt_xfer() on an endpoint while a transfer is still in progress
+#ifndef TUP_HCD_EDPT_XFER_QUEUE
+  #if defined(TUP_USBIP_EHCI) || defined(TUP_USBIP_OHCI)
+    #define TUP_HCD_EDPT_XFER_QUEUE 1 // transfers are appended to endpoint's TD list
+  #else
+    #define TUP_HCD_EDPT_XFER_QUEUE 0
+  #endif
+#endif
+
 // fast function, normally mean placing function in SRAM
 #ifndef TU_ATTR_FAST_FUNC
   #define TU_ATTR_FAST_FUNC
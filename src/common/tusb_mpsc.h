@@ -0,0 +1,179 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_MPSC_H_
+#define _TUSB_MPSC_H_
+
+// Lock-free bounded multi-producer single-consumer queue (C11 atomics), used as usbd/usbh event queue
+// when CFG_TUSB_LOCKFREE is enabled. Events can be sent from ISR running on any core and from other
+// tasks without disabling interrupt or taking a lock, so producers never serialize with the consumer.
+//
+// Each slot has a sequence number: a producer claims position by compare-and-swap on wr_pos, copies the item
+// then publishes it with sequence = pos + 1. Consumer reads slot when its sequence is rd_pos + 1 and releases
+// it for the next round with sequence = rd_pos + depth.
+//
+// Note: on cores without native compare-and-swap (e.g Cortex-M0+) C11 atomics are implemented by toolchain
+// runtime (e.g pico_atomic with hardware spin lock): queue is still correct but no longer lock-free.
+// This header is for C translation unit only.
+
+#include <stdatomic.h>
+#include "common/tusb_common.h"
+#include "osal/osal.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Consumer blocks on a semaphore posted by producers with RTOS, OS None and Pico never wait for event
+#define TU_MPSC_BLOCKING   ((CFG_TUSB_OS != OPT_OS_NONE) && (CFG_TUSB_OS != OPT_OS_PICO))
+
+typedef struct
+{
+  uint8_t* buffer;          // depth * item_size
+  atomic_uint* seq;         // sequence number of each slot
+  uint16_t depth;           // power of two
+  uint16_t item_size;
+
+  atomic_uint wr_pos;       // next position to be claimed by producers
+  unsigned int rd_pos;      // next position to be read, only accessed by consumer
+
+#if TU_MPSC_BLOCKING
+  osal_semaphore_def_t sem_def;
+  osal_semaphore_t sem;
+#endif
+} tu_mpsc_t;
+
+#define TU_MPSC_DEF(_name, _depth, _type)                                       \
+  TU_VERIFY_STATIC(((_depth) & ((_depth) - 1)) == 0, "depth must be power of 2"); \
+  static uint8_t _name##_buf[(_depth)*sizeof(_type)];                           \
+  static atomic_uint _name##_seq[_depth];                                       \
+  static tu_mpsc_t _name = {                                                    \
+    .buffer    = _name##_buf,                                                   \
+    .seq       = _name##_seq,                                                   \
+    .depth     = (_depth),                                                      \
+    .item_size = sizeof(_type)                                                  \
+  }
+
+// Reset queue to empty, must not be called concurrently with send/receive
+static inline tu_mpsc_t* tu_mpsc_create(tu_mpsc_t* q)
+{
+  for(unsigned int i = 0; i < q->depth; i++)
+  {
+    atomic_store_explicit(&q->seq[i], i, memory_order_relaxed);
+  }
+
+  atomic_store_explicit(&q->wr_pos, 0, memory_order_relaxed);
+  q->rd_pos = 0;
+
+#if TU_MPSC_BLOCKING
+  q->sem = osal_semaphore_create(&q->sem_def);
+#endif
+
+  return q;
+}
+
+// Send an item, safe to call from multiple ISRs/tasks/cores concurrently
+static inline bool tu_mpsc_send(tu_mpsc_t* q, void const* data, bool in_isr)
+{
+  (void) in_isr;
+
+  unsigned int const mask = q->depth - 1u;
+  unsigned int pos = atomic_load_explicit(&q->wr_pos, memory_order_relaxed);
+  atomic_uint* seq;
+
+  while (1)
+  {
+    seq = &q->seq[pos & mask];
+    int const diff = (int) (atomic_load_explicit(seq, memory_order_acquire) - pos);
+
+    if ( diff == 0 )
+    {
+      // slot is free: claim it, on failure pos is reloaded with current write position
+      if ( atomic_compare_exchange_weak_explicit(&q->wr_pos, &pos, pos + 1u,
+                                                 memory_order_relaxed, memory_order_relaxed) ) break;
+    }
+    else if ( diff < 0 )
+    {
+      // slot is not yet released by consumer: queue is full
+      TU_ASSERT(false);
+    }
+    else
+    {
+      // slot is claimed by another producer, retry with current write position
+      pos = atomic_load_explicit(&q->wr_pos, memory_order_relaxed);
+    }
+  }
+
+  memcpy(q->buffer + (pos & mask) * q->item_size, data, q->item_size);
+
+  // publish item to consumer
+  atomic_store_explicit(seq, pos + 1u, memory_order_release);
+
+#if TU_MPSC_BLOCKING
+  osal_semaphore_post(q->sem, in_isr);
+#endif
+
+  return true;
+}
+
+// Receive an item, must only be called by the single consumer
+static inline bool tu_mpsc_receive(tu_mpsc_t* q, void* data, uint32_t msec)
+{
+  unsigned int const pos = q->rd_pos;
+  atomic_uint* seq = &q->seq[pos & (q->depth - 1u)];
+
+  if ( atomic_load_explicit(seq, memory_order_acquire) != pos + 1u )
+  {
+#if TU_MPSC_BLOCKING
+    // semaphore may have been posted for an item already received, check again after wake up
+    if ( !osal_semaphore_wait(q->sem, msec) ) return false;
+    if ( atomic_load_explicit(seq, memory_order_acquire) != pos + 1u ) return false;
+#else
+    (void) msec; // not used, always behave as msec = 0
+    return false;
+#endif
+  }
+
+  memcpy(data, q->buffer + (pos & (q->depth - 1u)) * q->item_size, q->item_size);
+  q->rd_pos = pos + 1u;
+
+  // release slot to producers for next round
+  atomic_store_explicit(seq, pos + q->depth, memory_order_release);
+
+  return true;
+}
+
+static inline bool tu_mpsc_empty(tu_mpsc_t* q)
+{
+  unsigned int const pos = q->rd_pos;
+  return atomic_load_explicit(&q->seq[pos & (q->depth - 1u)], memory_order_acquire) != pos + 1u;
+}
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_MPSC_H_ */
@@ -30,17 +30,56 @@
 
 // Internal Helper used by Host and Device Stack
 
+#if CFG_TUSB_LOCKFREE
+#include <stdatomic.h>
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
 
-typedef struct TU_ATTR_PACKED
+typedef union TU_ATTR_PACKED
 {
-  volatile uint8_t busy    : 1;
-  volatile uint8_t stalled : 1;
-  volatile uint8_t claimed : 1;
+  struct TU_ATTR_PACKED
+  {
+    volatile uint8_t busy    : 1;
+    volatile uint8_t stalled : 1;
+    volatile uint8_t claimed : 1;
+  };
+
+  volatile uint8_t value; // all states, for atomic update
 }tu_edpt_state_t;
 
+// Bits of tu_edpt_state_t.value (bit-fields are allocated from LSB)
+#define TU_EDPT_STATE_BUSY     TU_BIT(0)
+#define TU_EDPT_STATE_STALLED  TU_BIT(1)
+#define TU_EDPT_STATE_CLAIMED  TU_BIT(2)
+
+// Set/clear endpoint state bits and return previous state. All writes to busy, stalled and claimed must
+// go through these: with CFG_TUSB_LOCKFREE they are atomic so that they don't overwrite a concurrent
+// compare-and-swap claim of another core on the same byte.
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_edpt_state_set(tu_edpt_state_t* ep_state, uint8_t mask)
+{
+#if CFG_TUSB_LOCKFREE
+  return atomic_fetch_or_explicit((volatile _Atomic uint8_t*) &ep_state->value, mask, memory_order_acq_rel);
+#else
+  uint8_t const prev = ep_state->value;
+  ep_state->value = (uint8_t) (prev | mask);
+  return prev;
+#endif
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_edpt_state_clear(tu_edpt_state_t* ep_state, uint8_t mask)
+{
+#if CFG_TUSB_LOCKFREE
+  return atomic_fetch_and_explicit((volatile _Atomic uint8_t*) &ep_state->value, (uint8_t) ~mask, memory_order_acq_rel);
+#else
+  uint8_t const prev = ep_state->value;
+  ep_state->value = (uint8_t) (prev & ~mask);
+  return prev;
+#endif
+}
+
 typedef struct {
   bool is_host; // host or device most
   union {
@@ -77,10 +116,10 @@ void tu_edpt_bind_driver(uint8_t ep2drv[][2], tusb_desc_interface_t const* p_des
 // Calculate total length of n interfaces (depending on IAD)
 uint16_t tu_desc_get_interface_total_len(tusb_desc_interface_t const* desc_itf, uint8_t itf_count, uint16_t max_len);
 
-// Claim an endpoint with provided mutex
+// Claim an endpoint with provided mutex, or compare-and-swap if CFG_TUSB_LOCKFREE (mutex is not used)
 bool tu_edpt_claim(tu_edpt_state_t* ep_state, osal_mutex_t mutex);
 
-// Release an endpoint with provided mutex
+// Release an endpoint with provided mutex, or compare-and-swap if CFG_TUSB_LOCKFREE (mutex is not used)
 bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex);
 
 //--------------------------------------------------------------------+
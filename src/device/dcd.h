@@ -62,6 +62,9 @@ typedef enum
   // Not an DCD event, just a convenient way to defer ISR function
   USBD_EVENT_FUNC_CALL,
 
+  // Not an DCD event, transfer complete already processed by driver xfer_isr(): only invoke its xfer_cb()
+  USBD_EVENT_XFER_CB,
+
   DCD_EVENT_COUNT
 } dcd_eventid_t;
 
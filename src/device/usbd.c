@@ -35,6 +35,10 @@
 #include "device/usbd.h"
 #include "device/usbd_pvt.h"
 
+#if CFG_TUSB_LOCKFREE
+#include "common/tusb_mpsc.h"
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Configuration
 //--------------------------------------------------------------------+
@@ -43,6 +47,37 @@
   #define CFG_TUD_TASK_QUEUE_SZ   16
 #endif
 
+// Split event queue into priority lanes: tud_task() always dispatches from the highest priority
+// non-empty lane, so that SETUP and isochronous completion are not delayed behind a burst of
+// bulk/interrupt completions or deferred function calls.
+#ifndef CFG_TUD_TASK_QUEUE_PRIORITY
+  #define CFG_TUD_TASK_QUEUE_PRIORITY   0
+#endif
+
+#if CFG_TUD_TASK_QUEUE_PRIORITY
+  // Depth of each lane (must be power of 2 with CFG_TUSB_LOCKFREE), CFG_TUD_TASK_QUEUE_SZ is not used
+
+  // Bus events (reset, suspend, resume, unplugged), SETUP and control endpoint completion
+  #ifndef CFG_TUD_TASK_QUEUE_SZ_CONTROL
+    #define CFG_TUD_TASK_QUEUE_SZ_CONTROL   8
+  #endif
+
+  // Isochronous endpoint completion
+  #ifndef CFG_TUD_TASK_QUEUE_SZ_ISO
+    #define CFG_TUD_TASK_QUEUE_SZ_ISO       8
+  #endif
+
+  // Bulk and interrupt endpoint completion
+  #ifndef CFG_TUD_TASK_QUEUE_SZ_XFER
+    #define CFG_TUD_TASK_QUEUE_SZ_XFER      16
+  #endif
+
+  // Deferred function calls
+  #ifndef CFG_TUD_TASK_QUEUE_SZ_FUNC
+    #define CFG_TUD_TASK_QUEUE_SZ_FUNC      8
+  #endif
+#endif
+
 // Debug level of USBD
 #define USBD_DBG   2
 
@@ -74,10 +109,165 @@ typedef struct
 
   tu_edpt_state_t ep_status[CFG_TUD_ENDPPOINT_MAX][2];
 
+  uint8_t sof_consumer; // bitmap of sof_consumer_t with SOF interrupt enabled
+  uint8_t tx_coalesce_sof; // number of interfaces counting frames for TX coalescing
+
+#if CFG_TUD_TASK_QUEUE_PRIORITY
+  uint32_t ep_iso_mask; // opened isochronous endpoints, bit (epnum + 16*dir), to select event lane
+#endif
+
 }usbd_device_t;
 
 static usbd_device_t _usbd_dev;
 
+//--------------------------------------------------------------------+
+// Endpoint Transfer Queue
+//--------------------------------------------------------------------+
+#if CFG_TUD_EDPT_XFER_QUEUE
+
+// Maximum transfers submitted but not yet completed on a non-control endpoint
+#define EDPT_XFER_MAX   (CFG_TUD_EDPT_XFER_QUEUE + 1)
+
+typedef struct
+{
+#if !TUP_DCD_EDPT_XFER_QUEUE
+  // DCD can only hold one transfer: the others wait here until the active one completes
+  struct
+  {
+    uint8_t* buffer;
+    uint16_t total_bytes;
+  } req[CFG_TUD_EDPT_XFER_QUEUE];
+
+  volatile uint8_t rd_idx;
+  volatile uint8_t count;
+  volatile uint8_t active; // transfer currently held by DCD
+#endif
+
+  uint8_t pending; // submitted transfers whose completion is not yet processed by usbd task
+} usbd_xfer_queue_t;
+
+static usbd_xfer_queue_t _usbd_xfer_queue[CFG_TUD_ENDPPOINT_MAX][2];
+
+// set while a driver's xfer_isr() runs in ISR: usbd_edpt_xfer/stall/close must not re-enable USB interrupt
+static volatile bool _usbd_xfer_in_isr;
+
+static bool xfer_queue_submit(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, bool in_isr)
+{
+  usbd_xfer_queue_t* q = &_usbd_xfer_queue[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  TU_VERIFY(q->pending < EDPT_XFER_MAX);
+
+#if TUP_DCD_EDPT_XFER_QUEUE
+  // DCD chains transfers natively. pending is also updated in ISR for driver with xfer_isr()
+  if ( !in_isr ) dcd_int_disable(rhport);
+  q->pending++;
+  if ( !in_isr ) dcd_int_enable(rhport);
+
+  if ( !dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes) )
+  {
+    if ( !in_isr ) dcd_int_disable(rhport);
+    q->pending--;
+    if ( !in_isr ) dcd_int_enable(rhport);
+    return false;
+  }
+#else
+  bool start_now = false;
+
+  if ( !in_isr ) dcd_int_disable(rhport);
+  if ( !q->active )
+  {
+    // there is nothing queued while DCD is idle
+    q->active = 1;
+    start_now = true;
+  }else
+  {
+    uint8_t const wr_idx = (q->rd_idx + q->count) % CFG_TUD_EDPT_XFER_QUEUE;
+    q->req[wr_idx].buffer      = buffer;
+    q->req[wr_idx].total_bytes = total_bytes;
+    q->count++;
+  }
+  q->pending++;
+  if ( !in_isr ) dcd_int_enable(rhport);
+
+  if ( start_now && !dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes) )
+  {
+    // nothing can be queued behind a transfer that failed to start
+    q->active = 0;
+    q->pending--;
+    return false;
+  }
+#endif
+
+  return true;
+}
+
+#if !TUP_DCD_EDPT_XFER_QUEUE
+// Called on transfer complete before the event is queued to usbd task: start the next queued
+// transfer right away. Return number of queued transfers dropped because DCD failed to start them.
+TU_ATTR_FAST_FUNC static uint8_t xfer_queue_advance(uint8_t rhport, uint8_t ep_addr, bool in_isr)
+{
+  usbd_xfer_queue_t* q = &_usbd_xfer_queue[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  uint8_t dropped = 0;
+
+  if ( !in_isr ) dcd_int_disable(rhport);
+
+  if ( q->count )
+  {
+    uint8_t* const buffer      = q->req[q->rd_idx].buffer;
+    uint16_t const total_bytes = q->req[q->rd_idx].total_bytes;
+
+    q->rd_idx = (q->rd_idx + 1) % CFG_TUD_EDPT_XFER_QUEUE;
+    q->count--;
+
+    // active stays set: the next transfer takes the place of the completed one
+    if ( !dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes) )
+    {
+      // keep submission order: drop what is queued behind it as well
+      dropped = 1 + q->count;
+      q->count  = 0;
+      q->active = 0;
+    }
+  }else
+  {
+    q->active = 0;
+  }
+
+  if ( !in_isr ) dcd_int_enable(rhport);
+
+  return dropped;
+}
+#endif
+
+// Called on transfer complete by usbd task (or in ISR for driver with xfer_isr), return true if endpoint
+// still has pending transfers
+TU_ATTR_FAST_FUNC static bool xfer_queue_complete(uint8_t epnum, uint8_t dir)
+{
+  usbd_xfer_queue_t* q = &_usbd_xfer_queue[epnum][dir];
+
+  // stale event of a transfer aborted by stall or close
+  if ( q->pending == 0 ) return false;
+
+  return (--q->pending) > 0;
+}
+
+// Drop all queued transfers, DCD aborts the active one
+static void xfer_queue_flush(uint8_t rhport, uint8_t epnum, uint8_t dir, bool in_isr)
+{
+  (void) rhport;
+  (void) in_isr;
+  usbd_xfer_queue_t* q = &_usbd_xfer_queue[epnum][dir];
+
+#if !TUP_DCD_EDPT_XFER_QUEUE
+  if ( !in_isr ) dcd_int_disable(rhport);
+  tu_varclr(q);
+  if ( !in_isr ) dcd_int_enable(rhport);
+#else
+  tu_varclr(q);
+#endif
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // Class Driver
 //--------------------------------------------------------------------+
@@ -98,7 +288,7 @@ static usbd_class_driver_t const _usbd_driver[] =
     .open             = cdcd_open,
     .control_xfer_cb  = cdcd_control_xfer_cb,
     .xfer_cb          = cdcd_xfer_cb,
-    .sof              = NULL
+    .sof              = cdcd_sof
   },
   #endif
 
@@ -162,15 +352,28 @@ static usbd_class_driver_t const _usbd_driver[] =
   },
   #endif
 
+  // before VENDOR since it only claims vendor interfaces with its own subclass
+  #if CFG_TUD_ZERO
+  {
+    DRIVER_NAME("ZERO")
+    .init             = zerod_init,
+    .reset            = zerod_reset,
+    .open             = zerod_open,
+    .control_xfer_cb  = zerod_control_xfer_cb,
+    .xfer_cb          = zerod_xfer_cb,
+    .sof              = NULL
+  },
+  #endif
+
   #if CFG_TUD_VENDOR
   {
     DRIVER_NAME("VENDOR")
     .init             = vendord_init,
     .reset            = vendord_reset,
     .open             = vendord_open,
-    .control_xfer_cb  = tud_vendor_control_xfer_cb,
+    .control_xfer_cb  = vendord_control_xfer_cb,
     .xfer_cb          = vendord_xfer_cb,
-    .sof              = NULL
+    .sof              = vendord_sof
   },
   #endif
 
@@ -267,10 +470,140 @@ static inline usbd_class_driver_t const * get_driver(uint8_t drvid)
 enum { RHPORT_INVALID = 0xFFu };
 static uint8_t _usbd_rhport = RHPORT_INVALID;
 
-// Event queue
-// usbd_int_set() is used as mutex in OS NONE config
-OSAL_QUEUE_DEF(usbd_int_set, _usbd_qdef, CFG_TUD_TASK_QUEUE_SZ, dcd_event_t);
-static osal_queue_t _usbd_q;
+// Event queue lanes, lower index has higher priority
+enum
+{
+#if CFG_TUD_TASK_QUEUE_PRIORITY
+  USBD_LANE_CONTROL = 0, // bus events, SETUP and control endpoint
+  USBD_LANE_ISO,         // isochronous endpoints
+  USBD_LANE_XFER,        // bulk and interrupt endpoints
+  USBD_LANE_FUNC,        // deferred function calls
+  USBD_LANE_COUNT
+#else
+  USBD_LANE_CONTROL = 0, // single lane for all events
+  USBD_LANE_COUNT
+#endif
+};
+
+// usbd task can block waiting for event with RTOS
+#define USBD_QUEUE_BLOCKING   ((CFG_TUSB_OS != OPT_OS_NONE) && (CFG_TUSB_OS != OPT_OS_PICO))
+
+#if CFG_TUSB_LOCKFREE
+  // lock-free ring: ISR on any core and other tasks send events without disabling usb interrupt
+  #define USBD_QUEUE_DEF(_name, _depth)   TU_MPSC_DEF(_name, _depth, dcd_event_t)
+
+  typedef tu_mpsc_t  usbd_queue_def_t;
+  typedef tu_mpsc_t* usbd_queue_t;
+
+  #define usbd_queue_create   tu_mpsc_create
+  #define usbd_queue_send     tu_mpsc_send
+  #define usbd_queue_receive  tu_mpsc_receive
+  #define usbd_queue_empty    tu_mpsc_empty
+#else
+  // usbd_int_set() is used as mutex in OS NONE config
+  #define USBD_QUEUE_DEF(_name, _depth)   OSAL_QUEUE_DEF(usbd_int_set, _name, _depth, dcd_event_t)
+
+  typedef osal_queue_def_t usbd_queue_def_t;
+  typedef osal_queue_t     usbd_queue_t;
+
+  #define usbd_queue_create   osal_queue_create
+  #define usbd_queue_send     osal_queue_send
+  #define usbd_queue_receive  osal_queue_receive
+  #define usbd_queue_empty    osal_queue_empty
+#endif
+
+#if CFG_TUD_TASK_QUEUE_PRIORITY
+  USBD_QUEUE_DEF(_usbd_qdef_control, CFG_TUD_TASK_QUEUE_SZ_CONTROL);
+  USBD_QUEUE_DEF(_usbd_qdef_iso    , CFG_TUD_TASK_QUEUE_SZ_ISO);
+  USBD_QUEUE_DEF(_usbd_qdef_xfer   , CFG_TUD_TASK_QUEUE_SZ_XFER);
+  USBD_QUEUE_DEF(_usbd_qdef_func   , CFG_TUD_TASK_QUEUE_SZ_FUNC);
+
+  static usbd_queue_def_t* const _usbd_qdef[USBD_LANE_COUNT] =
+  {
+    &_usbd_qdef_control, &_usbd_qdef_iso, &_usbd_qdef_xfer, &_usbd_qdef_func
+  };
+
+  #if USBD_QUEUE_BLOCKING
+    // posted for every event sent to any lane, usbd task waits on it when all lanes are empty
+    static osal_semaphore_def_t _usbd_sem_def;
+    static osal_semaphore_t _usbd_sem;
+  #endif
+#else
+  USBD_QUEUE_DEF(_usbd_qdef_control, CFG_TUD_TASK_QUEUE_SZ);
+
+  static usbd_queue_def_t* const _usbd_qdef[USBD_LANE_COUNT] = { &_usbd_qdef_control };
+#endif
+
+static usbd_queue_t _usbd_q[USBD_LANE_COUNT];
+
+// Select lane for an event
+TU_ATTR_ALWAYS_INLINE static inline uint8_t usbd_event_lane(dcd_event_t const * event)
+{
+#if CFG_TUD_TASK_QUEUE_PRIORITY
+  switch (event->event_id)
+  {
+    case DCD_EVENT_XFER_COMPLETE:
+    case USBD_EVENT_XFER_CB:
+    {
+      uint8_t const ep_addr = event->xfer_complete.ep_addr;
+      uint8_t const epnum   = tu_edpt_number(ep_addr);
+
+      if ( epnum == 0 ) return USBD_LANE_CONTROL;
+      return tu_bit_test(_usbd_dev.ep_iso_mask, epnum + 16*tu_edpt_dir(ep_addr)) ? USBD_LANE_ISO : USBD_LANE_XFER;
+    }
+
+    case USBD_EVENT_FUNC_CALL: return USBD_LANE_FUNC;
+
+    default: return USBD_LANE_CONTROL;
+  }
+#else
+  (void) event;
+  return USBD_LANE_CONTROL;
+#endif
+}
+
+static void usbd_event_send(dcd_event_t const * event, bool in_isr)
+{
+  usbd_queue_send(_usbd_q[usbd_event_lane(event)], event, in_isr);
+
+#if CFG_TUD_TASK_QUEUE_PRIORITY && USBD_QUEUE_BLOCKING
+  osal_semaphore_post(_usbd_sem, in_isr);
+#endif
+}
+
+// Receive event from the highest priority non-empty lane
+static bool usbd_event_receive(dcd_event_t* event, uint32_t timeout_ms)
+{
+#if CFG_TUD_TASK_QUEUE_PRIORITY
+  while (1)
+  {
+    for ( uint8_t lane = 0; lane < USBD_LANE_COUNT; lane++ )
+    {
+      if ( usbd_queue_receive(_usbd_q[lane], event, 0) ) return true;
+    }
+
+  #if USBD_QUEUE_BLOCKING
+    // semaphore may have been posted for events already received, check all lanes again after wake up
+    if ( !osal_semaphore_wait(_usbd_sem, timeout_ms) ) return false;
+  #else
+    (void) timeout_ms; // never wait without RTOS
+    return false;
+  #endif
+  }
+#else
+  return usbd_queue_receive(_usbd_q[USBD_LANE_CONTROL], event, timeout_ms);
+#endif
+}
+
+static bool usbd_event_empty(void)
+{
+  for ( uint8_t lane = 0; lane < USBD_LANE_COUNT; lane++ )
+  {
+    if ( !usbd_queue_empty(_usbd_q[lane]) ) return false;
+  }
+
+  return true;
+}
 
 // Mutex for claiming endpoint
 #if OSAL_MUTEX_REQUIRED
@@ -309,7 +642,8 @@ static char const* const _usbd_event_str[DCD_EVENT_COUNT] =
   "Resume"         ,
   "Setup Received" ,
   "Xfer Complete"  ,
-  "Func Call"
+  "Func Call"      ,
+  "Xfer Callback"
 };
 
 // for usbd_control to print the name of control complete driver
@@ -398,8 +732,16 @@ bool tud_init (uint8_t rhport)
 #endif
 
   // Init device queue & task
-  _usbd_q = osal_queue_create(&_usbd_qdef);
-  TU_ASSERT(_usbd_q);
+  for ( uint8_t lane = 0; lane < USBD_LANE_COUNT; lane++ )
+  {
+    _usbd_q[lane] = usbd_queue_create(_usbd_qdef[lane]);
+    TU_ASSERT(_usbd_q[lane]);
+  }
+
+#if CFG_TUD_TASK_QUEUE_PRIORITY && USBD_QUEUE_BLOCKING
+  _usbd_sem = osal_semaphore_create(&_usbd_sem_def);
+  TU_ASSERT(_usbd_sem);
+#endif
 
   // Get application driver if available
   if ( usbd_app_driver_get_cb )
@@ -434,7 +776,23 @@ static void configuration_reset(uint8_t rhport)
     driver->reset(rhport);
   }
 
+  // drivers enable SOF again when opened
+  if ( _usbd_dev.sof_consumer ) dcd_sof_enable(rhport, false);
+
   tu_varclr(&_usbd_dev);
+#if CFG_TUD_EDPT_XFER_QUEUE
+  tu_varclr(&_usbd_xfer_queue);
+#endif
+
+#if CFG_TUD_TASK_QUEUE_PRIORITY
+  // Completions of previous configuration may still wait in lower priority lanes behind this (already dispatched)
+  // bus reset or set configuration. Drop them: no transfer of the new configuration is started yet.
+  for ( uint8_t lane = USBD_LANE_ISO; lane <= USBD_LANE_XFER; lane++ )
+  {
+    dcd_event_t event;
+    while ( usbd_queue_receive(_usbd_q[lane], &event, 0) ) {}
+  }
+#endif
   memset(_usbd_dev.itf2drv, DRVID_INVALID, sizeof(_usbd_dev.itf2drv)); // invalid mapping
   memset(_usbd_dev.ep2drv , DRVID_INVALID, sizeof(_usbd_dev.ep2drv )); // invalid mapping
 }
@@ -450,7 +808,7 @@ bool tud_task_event_ready(void)
   // Skip if stack is not initialized
   if ( !tusb_inited() ) return false;
 
-  return !osal_queue_empty(_usbd_q);
+  return !usbd_event_empty();
 }
 
 /* USB Device Driver task
@@ -482,7 +840,7 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr)
   while (1)
   {
     dcd_event_t event;
-    if ( !osal_queue_receive(_usbd_q, &event, timeout_ms) ) return;
+    if ( !usbd_event_receive(&event, timeout_ms) ) return;
 
 #if CFG_TUSB_DEBUG >= 2
     if (event.event_id == DCD_EVENT_SETUP_RECEIVED) TU_LOG(USBD_DBG, "\r\n"); // extra line for setup
@@ -514,10 +872,8 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr)
         _usbd_dev.connected = 1;
 
         // mark both in & out control as free
-        _usbd_dev.ep_status[0][TUSB_DIR_OUT].busy = false;
-        _usbd_dev.ep_status[0][TUSB_DIR_OUT].claimed = 0;
-        _usbd_dev.ep_status[0][TUSB_DIR_IN ].busy = false;
-        _usbd_dev.ep_status[0][TUSB_DIR_IN ].claimed = 0;
+        tu_edpt_state_clear(&_usbd_dev.ep_status[0][TUSB_DIR_OUT], TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+        tu_edpt_state_clear(&_usbd_dev.ep_status[0][TUSB_DIR_IN ], TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
 
         // Process control request
         if ( !process_control_request(event.rhport, &event.setup_received) )
@@ -538,8 +894,19 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr)
 
         TU_LOG(USBD_DBG, "on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event.xfer_complete.len);
 
-        _usbd_dev.ep_status[epnum][ep_dir].busy = false;
-        _usbd_dev.ep_status[epnum][ep_dir].claimed = 0;
+#if CFG_TUD_EDPT_XFER_QUEUE
+        // endpoint remains busy while queued transfers are pending, claim was already consumed by submission
+        if ( epnum != 0 )
+        {
+          if ( !xfer_queue_complete(epnum, ep_dir) )
+          {
+            tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][ep_dir], TU_EDPT_STATE_BUSY);
+          }
+        }else
+#endif
+        {
+          tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][ep_dir], TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+        }
 
         if ( 0 == epnum )
         {
@@ -581,6 +948,23 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr)
         }
       break;
 
+      case USBD_EVENT_XFER_CB:
+      {
+        // endpoint is already released in ISR by xfer_complete_dispatch()
+        uint8_t const ep_addr = event.xfer_complete.ep_addr;
+        usbd_class_driver_t const * driver = get_driver( _usbd_dev.ep2drv[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)] );
+
+        TU_LOG(USBD_DBG, "on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event.xfer_complete.len);
+
+        // driver is gone if configuration changed in the meantime
+        if ( driver )
+        {
+          TU_LOG(USBD_DBG, "  %s xfer callback\r\n", driver->name);
+          driver->xfer_cb(event.rhport, ep_addr, (xfer_result_t)event.xfer_complete.result, event.xfer_complete.len);
+        }
+      }
+      break;
+
       case USBD_EVENT_FUNC_CALL:
         TU_LOG(USBD_DBG, "\r\n");
         if ( event.func_call.func ) event.func_call.func(event.func_call.param);
@@ -594,7 +978,7 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr)
 
 #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
     // return if there is no more events, for application to run other background
-    if (osal_queue_empty(_usbd_q)) return;
+    if (usbd_event_empty()) return;
 #endif
   }
 }
@@ -1069,6 +1453,49 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
 //--------------------------------------------------------------------+
 // DCD Event Handler
 //--------------------------------------------------------------------+
+
+// Invoke xfer_isr() of the driver owning endpoint if any, otherwise queue transfer complete event to usbd task
+TU_ATTR_FAST_FUNC static void xfer_complete_dispatch(dcd_event_t const * event, bool in_isr)
+{
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum   = tu_edpt_number(ep_addr);
+  uint8_t const ep_dir  = tu_edpt_dir(ep_addr);
+
+  usbd_class_driver_t const * driver = epnum ? get_driver(_usbd_dev.ep2drv[epnum][ep_dir]) : NULL;
+
+  if ( !(driver && driver->xfer_isr) )
+  {
+    usbd_event_send(event, in_isr);
+    return;
+  }
+
+  // release endpoint as usbd task would do, driver can then queue next transfer within this interrupt
+#if CFG_TUD_EDPT_XFER_QUEUE
+  if ( !xfer_queue_complete(epnum, ep_dir) )
+  {
+    tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][ep_dir], TU_EDPT_STATE_BUSY);
+  }
+#else
+  tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][ep_dir], TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE
+  _usbd_xfer_in_isr = in_isr;
+#endif
+  bool const handled = driver->xfer_isr(event->rhport, ep_addr, (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+#if CFG_TUD_EDPT_XFER_QUEUE
+  _usbd_xfer_in_isr = false;
+#endif
+
+  if ( !handled )
+  {
+    // not completely handled: invoke xfer_cb() from usbd task
+    dcd_event_t event_cb = *event;
+    event_cb.event_id = USBD_EVENT_XFER_CB;
+    usbd_event_send(&event_cb, in_isr);
+  }
+}
+
 TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const * event, bool in_isr)
 {
   switch (event->event_id)
@@ -1078,7 +1505,7 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const * event, bool in_isr)
       _usbd_dev.addressed  = 0;
       _usbd_dev.cfg_num    = 0;
       _usbd_dev.suspended  = 0;
-      osal_queue_send(_usbd_q, event, in_isr);
+      usbd_event_send(event, in_isr);
     break;
 
     case DCD_EVENT_SUSPEND:
@@ -1089,7 +1516,7 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const * event, bool in_isr)
       if ( _usbd_dev.connected )
       {
         _usbd_dev.suspended = 1;
-        osal_queue_send(_usbd_q, event, in_isr);
+        usbd_event_send(event, in_isr);
       }
     break;
 
@@ -1098,7 +1525,7 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const * event, bool in_isr)
       if ( _usbd_dev.connected )
       {
         _usbd_dev.suspended = 0;
-        osal_queue_send(_usbd_q, event, in_isr);
+        usbd_event_send(event, in_isr);
       }
     break;
 
@@ -1120,14 +1547,40 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const * event, bool in_isr)
         _usbd_dev.suspended = 0;
 
         dcd_event_t const event_resume = { .rhport = event->rhport, .event_id = DCD_EVENT_RESUME };
-        osal_queue_send(_usbd_q, &event_resume, in_isr);
+        usbd_event_send(&event_resume, in_isr);
       }
 
       // skip osal queue for SOF in usbd task
     break;
 
+    case DCD_EVENT_XFER_COMPLETE:
+    {
+#if CFG_TUD_EDPT_XFER_QUEUE && !TUP_DCD_EDPT_XFER_QUEUE
+      uint8_t const ep_addr = event->xfer_complete.ep_addr;
+      uint8_t dropped = 0;
+
+      // feed next queued transfer to DCD without waiting for usbd task
+      if ( tu_edpt_number(ep_addr) ) dropped = xfer_queue_advance(event->rhport, ep_addr, in_isr);
+
+      xfer_complete_dispatch(event, in_isr);
+
+      // report transfers which could not be started so that each submission gets its callback
+      dcd_event_t const event_failed =
+      {
+        .rhport        = event->rhport,
+        .event_id      = DCD_EVENT_XFER_COMPLETE,
+        .xfer_complete = { .ep_addr = ep_addr, .len = 0, .result = XFER_RESULT_FAILED }
+      };
+
+      while ( dropped-- ) xfer_complete_dispatch(&event_failed, in_isr);
+#else
+      xfer_complete_dispatch(event, in_isr);
+#endif
+    }
+    break;
+
     default:
-      osal_queue_send(_usbd_q, event, in_isr);
+      usbd_event_send(event, in_isr);
     break;
   }
 }
@@ -1197,6 +1650,19 @@ bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep)
   TU_ASSERT(tu_edpt_number(desc_ep->bEndpointAddress) < CFG_TUD_ENDPPOINT_MAX);
   TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) _usbd_dev.speed));
 
+#if CFG_TUD_TASK_QUEUE_PRIORITY
+  uint8_t const ep_addr = desc_ep->bEndpointAddress;
+  uint8_t const ep_bit  = (uint8_t) (tu_edpt_number(ep_addr) + 16*tu_edpt_dir(ep_addr));
+
+  if ( desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS )
+  {
+    _usbd_dev.ep_iso_mask = tu_bit_set(_usbd_dev.ep_iso_mask, ep_bit);
+  }else
+  {
+    _usbd_dev.ep_iso_mask = tu_bit_clear(_usbd_dev.ep_iso_mask, ep_bit);
+  }
+#endif
+
   return dcd_edpt_open(rhport, desc_ep);
 }
 
@@ -1214,6 +1680,29 @@ bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr)
   return tu_edpt_claim(ep_state, _usbd_mutex);
 }
 
+bool usbd_edpt_claim_queued(uint8_t rhport, uint8_t ep_addr)
+{
+#if CFG_TUD_EDPT_XFER_QUEUE
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  if ( epnum != 0 )
+  {
+    // endpoint can be claimed while busy as long as there is room for another transfer
+    tu_edpt_state_t* ep_state = &_usbd_dev.ep_status[epnum][dir];
+
+    (void) osal_mutex_lock(_usbd_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    bool const available = !ep_state->stalled && (_usbd_xfer_queue[epnum][dir].pending < EDPT_XFER_MAX) &&
+                           !(tu_edpt_state_set(ep_state, TU_EDPT_STATE_CLAIMED) & TU_EDPT_STATE_CLAIMED);
+    (void) osal_mutex_unlock(_usbd_mutex);
+
+    return available;
+  }
+#endif
+
+  return usbd_edpt_claim(rhport, ep_addr);
+}
+
 bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr)
 {
   (void) rhport;
@@ -1237,12 +1726,35 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
 
   TU_LOG(USBD_DBG, "  Queue EP %02X with %u bytes ...\r\n", ep_addr, total_bytes);
 
+#if CFG_TUD_EDPT_XFER_QUEUE
+  if ( epnum != 0 )
+  {
+    TU_ASSERT(!_usbd_dev.ep_status[epnum][dir].stalled);
+
+    // Set busy first since the transfer can be complete before xfer_queue_submit() could return
+    bool const was_busy = tu_edpt_state_set(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_BUSY) & TU_EDPT_STATE_BUSY;
+
+    bool const ret = xfer_queue_submit(rhport, ep_addr, buffer, total_bytes, _usbd_xfer_in_isr);
+
+    // claim is consumed by submission, allowing next transfer to be claimed. Queue full or DCD error
+    // leaves endpoint busy only if other transfers are still pending
+    tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][dir],
+                        (ret || was_busy) ? TU_EDPT_STATE_CLAIMED : (TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED));
+
+    if ( !ret )
+    {
+      TU_LOG(USBD_DBG, "FAILED\r\n");
+    }
+    return ret;
+  }
+#endif
+
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
 
   // Set busy first since the actual transfer can be complete before dcd_edpt_xfer()
   // could return and USBD task can preempt and clear the busy
-  _usbd_dev.ep_status[epnum][dir].busy = true;
+  tu_edpt_state_set(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_BUSY);
 
   if ( dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes) )
   {
@@ -1250,14 +1762,19 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   }else
   {
     // DCD error, mark endpoint as ready to allow next transfer
-    _usbd_dev.ep_status[epnum][dir].busy = false;
-    _usbd_dev.ep_status[epnum][dir].claimed = 0;
+    tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
     TU_LOG(USBD_DBG, "FAILED\r\n");
     TU_BREAKPOINT();
     return false;
   }
 }
 
+bool usbd_edpt_xfer_fifo_supported(uint8_t rhport)
+{
+  (void) rhport;
+  return dcd_edpt_xfer_fifo != NULL;
+}
+
 // The number of bytes has to be given explicitly to allow more flexible control of how many
 // bytes should be written and second to keep the return value free to give back a boolean
 // success message. If total_bytes is too big, the FIFO will copy only what is available
@@ -1276,17 +1793,31 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
 
   // Set busy first since the actual transfer can be complete before dcd_edpt_xfer() could return
   // and usbd task can preempt and clear the busy
-  _usbd_dev.ep_status[epnum][dir].busy = true;
+  tu_edpt_state_set(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_BUSY);
+
+#if CFG_TUD_EDPT_XFER_QUEUE
+  // fifo transfer is never queued, but must hold off transfers submitted behind it
+  usbd_xfer_queue_t* q = &_usbd_xfer_queue[epnum][dir];
+  q->pending = 1;
+  #if !TUP_DCD_EDPT_XFER_QUEUE
+  q->active  = 1;
+  #endif
+#endif
 
   if (dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes))
   {
+#if CFG_TUD_EDPT_XFER_QUEUE
+    tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_CLAIMED);
+#endif
     TU_LOG(USBD_DBG, "OK\r\n");
     return true;
   }else
   {
     // DCD error, mark endpoint as ready to allow next transfer
-    _usbd_dev.ep_status[epnum][dir].busy = false;
-    _usbd_dev.ep_status[epnum][dir].claimed = 0;
+#if CFG_TUD_EDPT_XFER_QUEUE
+    tu_varclr(q);
+#endif
+    tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
     TU_LOG(USBD_DBG, "failed\r\n");
     TU_BREAKPOINT();
     return false;
@@ -1303,6 +1834,22 @@ bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
   return _usbd_dev.ep_status[epnum][dir].busy;
 }
 
+uint8_t usbd_edpt_xfer_available(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  if ( _usbd_dev.ep_status[epnum][dir].stalled ) return 0;
+
+#if CFG_TUD_EDPT_XFER_QUEUE
+  if ( epnum != 0 ) return (uint8_t) (EDPT_XFER_MAX - _usbd_xfer_queue[epnum][dir].pending);
+#endif
+
+  return _usbd_dev.ep_status[epnum][dir].busy ? 0 : 1;
+}
+
 void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
 {
   rhport = _usbd_rhport;
@@ -1315,8 +1862,10 @@ void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
   {
     TU_LOG(USBD_DBG, "    Stall EP %02X\r\n", ep_addr);
     dcd_edpt_stall(rhport, ep_addr);
-    _usbd_dev.ep_status[epnum][dir].stalled = true;
-    _usbd_dev.ep_status[epnum][dir].busy = true;
+#if CFG_TUD_EDPT_XFER_QUEUE
+    if ( epnum != 0 ) xfer_queue_flush(rhport, epnum, dir, _usbd_xfer_in_isr);
+#endif
+    tu_edpt_state_set(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_STALLED | TU_EDPT_STATE_BUSY);
   }
 }
 
@@ -1332,8 +1881,7 @@ void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
   {
     TU_LOG(USBD_DBG, "    Clear Stall EP %02X\r\n", ep_addr);
     dcd_edpt_clear_stall(rhport, ep_addr);
-    _usbd_dev.ep_status[epnum][dir].stalled = false;
-    _usbd_dev.ep_status[epnum][dir].busy = false;
+    tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_STALLED | TU_EDPT_STATE_BUSY);
   }
 }
 
@@ -1364,20 +1912,71 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   dcd_edpt_close(rhport, ep_addr);
-  _usbd_dev.ep_status[epnum][dir].stalled = false;
-  _usbd_dev.ep_status[epnum][dir].busy = false;
-  _usbd_dev.ep_status[epnum][dir].claimed = false;
+#if CFG_TUD_EDPT_XFER_QUEUE
+  xfer_queue_flush(rhport, epnum, dir, _usbd_xfer_in_isr);
+#endif
+  tu_edpt_state_clear(&_usbd_dev.ep_status[epnum][dir], TU_EDPT_STATE_STALLED | TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
 
   return;
 }
 
+bool usbd_tx_coalesce_set(uint8_t rhport, usbd_tx_coalesce_t* tc, tud_tx_coalesce_t policy, uint16_t frames, bool opened)
+{
+  TU_VERIFY(policy != TUD_TX_COALESCE_FRAMES || frames);
+
+  tc->policy = (uint8_t) policy;
+  tc->frames = frames;
+  usbd_tx_coalesce_update(rhport, tc, opened);
+
+  return true;
+}
+
+void usbd_tx_coalesce_update(uint8_t rhport, usbd_tx_coalesce_t* tc, bool opened)
+{
+  tc->countdown = 0;
+
+  bool const sof = opened && (tc->policy == TUD_TX_COALESCE_FRAMES);
+  if ( sof == tc->sof ) return;
+
+  tc->sof = sof;
+  if ( sof )
+  {
+    _usbd_dev.tx_coalesce_sof++;
+  }else if ( _usbd_dev.tx_coalesce_sof )
+  {
+    _usbd_dev.tx_coalesce_sof--;
+  }
+
+  usbd_sof_consumer_enable(rhport, SOF_CONSUMER_TX_COALESCE, _usbd_dev.tx_coalesce_sof > 0);
+}
+
 void usbd_sof_enable(uint8_t rhport, bool en)
+{
+  usbd_sof_consumer_enable(rhport, SOF_CONSUMER_APP, en);
+}
+
+void usbd_sof_consumer_enable(uint8_t rhport, sof_consumer_t consumer, bool en)
 {
   rhport = _usbd_rhport;
 
-  // TODO: Check needed if all drivers including the user sof_cb does not need an active SOF ISR any more.
-  // Only if all drivers switched off SOF calls the SOF interrupt may be disabled
-  dcd_sof_enable(rhport, en);
+  // Drivers apply their setting again when opened
+  if ( !tud_inited() ) return;
+
+  uint8_t const prev = _usbd_dev.sof_consumer;
+
+  if ( en )
+  {
+    _usbd_dev.sof_consumer = (uint8_t) (prev | TU_BIT(consumer));
+  }else
+  {
+    _usbd_dev.sof_consumer = (uint8_t) (prev & ~TU_BIT(consumer));
+  }
+
+  // Only switch SOF interrupt when the first consumer enables or the last one disables it
+  if ( (prev == 0) != (_usbd_dev.sof_consumer == 0) )
+  {
+    dcd_sof_enable(rhport, _usbd_dev.sof_consumer != 0);
+  }
 }
 
 #endif
@@ -33,6 +33,14 @@
 extern "C" {
 #endif
 
+// Transmit coalescing policy of byte-stream class drivers (CDC, Vendor)
+typedef enum
+{
+  TUD_TX_COALESCE_PACKET = 0, // send once a full packet is queued, remainder on explicit flush (default)
+  TUD_TX_COALESCE_IMMEDIATE , // send on every write
+  TUD_TX_COALESCE_FRAMES    , // as PACKET, remainder is also flushed N (micro)frames after it is queued
+} tud_tx_coalesce_t;
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -99,6 +107,8 @@ bool tud_connect(void);
 // Carry out Data and Status stage of control transfer
 // - If len = 0, it is equivalent to sending status only
 // - If len > wLength : it will be truncated
+// - With CFG_TUD_EDPT0_ZERO_COPY, buffer larger than CFG_TUD_ENDPOINT0_SIZE is used in place
+//   and must stay valid until the transfer completes
 bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const * request, void* buffer, uint16_t len);
 
 // Send STATUS (zero length) packet
@@ -623,6 +633,42 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   /* Endpoint In */\
   7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
 
+//--------------------------------------------------------------------+
+// Zero (source/sink, loopback test function) Descriptor Templates
+//--------------------------------------------------------------------+
+
+// Length of template descriptor: 23 bytes, 55 bytes with ISO alternate
+#define TUD_ZERO_DESC_LEN          (9+7+7)
+#define TUD_ZERO_ISO_DESC_LEN      (TUD_ZERO_DESC_LEN + 9+7+7+7+7)
+
+#define _TUD_ZERO_DESC_ALT(_itfnum, _alt, _numeps, _protocol, _stridx, _epout, _epin, _epsize) \
+  /* Interface */\
+  9, TUSB_DESC_INTERFACE, _itfnum, _alt, _numeps, TUSB_CLASS_VENDOR_SPECIFIC, TUD_ZERO_SUBCLASS, _protocol, _stridx,\
+  /* Endpoint Out */\
+  7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  /* Endpoint In */\
+  7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
+
+// Bulk source (IN) and sink (OUT)
+// Interface number, string index, EP Out & IN address, EP size
+#define TUD_ZERO_SOURCESINK_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize) \
+  _TUD_ZERO_DESC_ALT(_itfnum, 0, 2, TUD_ZERO_PROTOCOL_SOURCESINK, _stridx, _epout, _epin, _epsize)
+
+// Bulk source/sink with alternate 1 adding ISO source and sink, as gadget zero
+// Interface number, string index, EP Out & IN address, EP size, ISO EP Out & In address, ISO EP size, ISO interval
+#define TUD_ZERO_SOURCESINK_ISO_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize, _isoout, _isoin, _isosize, _isointerval) \
+  _TUD_ZERO_DESC_ALT(_itfnum, 0, 2, TUD_ZERO_PROTOCOL_SOURCESINK, _stridx, _epout, _epin, _epsize),\
+  _TUD_ZERO_DESC_ALT(_itfnum, 1, 4, TUD_ZERO_PROTOCOL_SOURCESINK, _stridx, _epout, _epin, _epsize),\
+  /* ISO Endpoint Out */\
+  7, TUSB_DESC_ENDPOINT, _isoout, TUSB_XFER_ISOCHRONOUS, U16_TO_U8S_LE(_isosize), _isointerval,\
+  /* ISO Endpoint In */\
+  7, TUSB_DESC_ENDPOINT, _isoin, TUSB_XFER_ISOCHRONOUS, U16_TO_U8S_LE(_isosize), _isointerval
+
+// Bulk loopback: data received on OUT is sent back on IN
+// Interface number, string index, EP Out & IN address, EP size
+#define TUD_ZERO_LOOPBACK_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize) \
+  _TUD_ZERO_DESC_ALT(_itfnum, 0, 2, TUD_ZERO_PROTOCOL_LOOPBACK, _stridx, _epout, _epin, _epsize)
+
 //--------------------------------------------------------------------+
 // DFU Runtime Descriptor Templates
 //--------------------------------------------------------------------+
@@ -49,6 +49,7 @@ typedef struct
   uint8_t* buffer;
   uint16_t data_len;
   uint16_t total_xferred;
+  uint16_t xact_len;
 
   usbd_control_xfer_cb_t complete_cb;
 } usbd_control_xfer_t;
@@ -58,6 +59,24 @@ static usbd_control_xfer_t _ctrl_xfer;
 CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN
 static uint8_t _usbd_ctrl_buf[CFG_TUD_ENDPOINT0_SIZE];
 
+// Maximum bytes per transaction in data stage
+#if CFG_TUD_EDPT0_ZERO_COPY && TUP_DCD_EDPT0_XFER_MAX
+  #define CTRL_XACT_MAX   TUP_DCD_EDPT0_XFER_MAX
+#else
+  #define CTRL_XACT_MAX   CFG_TUD_ENDPOINT0_SIZE
+#endif
+
+// Data stage that fits into endpoint0 buffer is always copied, since short replies are
+// commonly in stack variables that are gone once tud_control_xfer() returns
+TU_ATTR_ALWAYS_INLINE static inline bool _data_stage_zero_copy(void)
+{
+#if CFG_TUD_EDPT0_ZERO_COPY
+  return _ctrl_xfer.data_len > CFG_TUD_ENDPOINT0_SIZE;
+#else
+  return false;
+#endif
+}
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -82,21 +101,24 @@ bool tud_control_status(uint8_t rhport, tusb_control_request_t const * request)
 }
 
 // Queue a transaction in Data Stage
-// Each transaction has up to Endpoint0's max packet size.
+// Each transaction has up to Endpoint0's max packet size, or up to TUP_DCD_EDPT0_XFER_MAX
+// when DCD can transfer multiple packets directly from/to application buffer.
 // This function can also transfer an zero-length packet
 static bool _data_stage_xact(uint8_t rhport)
 {
-  uint16_t const xact_len = tu_min16(_ctrl_xfer.data_len - _ctrl_xfer.total_xferred, CFG_TUD_ENDPOINT0_SIZE);
+  uint16_t const xact_len = tu_min16(_ctrl_xfer.data_len - _ctrl_xfer.total_xferred, CTRL_XACT_MAX);
+  _ctrl_xfer.xact_len = xact_len;
 
-  uint8_t ep_addr = EDPT_CTRL_OUT;
+  uint8_t const ep_addr = (_ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_IN) ? EDPT_CTRL_IN : EDPT_CTRL_OUT;
 
-  if ( _ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_IN )
+  uint8_t* xact_buf = _ctrl_xfer.buffer;
+  if ( !_data_stage_zero_copy() )
   {
-    ep_addr = EDPT_CTRL_IN;
-    if ( xact_len ) memcpy(_usbd_ctrl_buf, _ctrl_xfer.buffer, xact_len);
+    xact_buf = _usbd_ctrl_buf;
+    if ( ep_addr == EDPT_CTRL_IN && xact_len ) memcpy(_usbd_ctrl_buf, _ctrl_xfer.buffer, xact_len);
   }
 
-  return usbd_edpt_xfer(rhport, ep_addr, xact_len ? _usbd_ctrl_buf : NULL, xact_len);
+  return usbd_edpt_xfer(rhport, ep_addr, xact_len ? xact_buf : NULL, xact_len);
 }
 
 // Transmit data to/from the control endpoint.
@@ -185,16 +207,21 @@ bool usbd_control_xfer_cb (uint8_t rhport, uint8_t ep_addr, xfer_result_t result
   if ( _ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_OUT )
   {
     TU_VERIFY(_ctrl_xfer.buffer);
-    memcpy(_ctrl_xfer.buffer, _usbd_ctrl_buf, xferred_bytes);
-    TU_LOG_MEM(2, _usbd_ctrl_buf, xferred_bytes, 2);
+    if ( !_data_stage_zero_copy() ) memcpy(_ctrl_xfer.buffer, _usbd_ctrl_buf, xferred_bytes);
+    TU_LOG_MEM(2, _ctrl_xfer.buffer, xferred_bytes, 2);
   }
 
   _ctrl_xfer.total_xferred += (uint16_t) xferred_bytes;
   _ctrl_xfer.buffer += xferred_bytes;
 
+  // a transaction can span multiple packets: it ends with short packet if fewer bytes
+  // than queued or not multiple of packet size are transferred
+  bool const is_short = (xferred_bytes == 0) || (xferred_bytes < _ctrl_xfer.xact_len) ||
+                        (xferred_bytes % CFG_TUD_ENDPOINT0_SIZE);
+
   // Data Stage is complete when all request's length are transferred or
   // a short packet is sent including zero-length packet.
-  if ( (_ctrl_xfer.request.wLength == _ctrl_xfer.total_xferred) || (xferred_bytes < CFG_TUD_ENDPOINT0_SIZE) )
+  if ( (_ctrl_xfer.request.wLength == _ctrl_xfer.total_xferred) || is_short )
   {
     // DATA stage is complete
     bool is_ok = true;
@@ -49,6 +49,13 @@ typedef struct
   bool     (* control_xfer_cb  ) (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
   bool     (* xfer_cb          ) (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
   void     (* sof              ) (uint8_t rhport, uint32_t frame_count); // optional
+
+  // Optional transfer complete handler invoked in interrupt context (by DCD event handler) instead of usbd task.
+  // Endpoint is already released, so driver can queue the next transfer with usbd_edpt_xfer() right away.
+  // Return true if transfer is completely handled, or false to also have xfer_cb() invoked later by usbd task.
+  // Constraints: keep it short, no blocking and no osal mutex/semaphore wait, do not call tud_control_xfer() or
+  // application callbacks that are expected to run in task context. Only called for non-control endpoints.
+  bool     (* xfer_isr         ) (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 } usbd_class_driver_t;
 
 // Invoked when initializing device stack to get additional class drivers.
@@ -71,16 +78,27 @@ bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep);
 // Close an endpoint
 void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr);
 
-// Submit a usb transfer
+// Submit a usb transfer. With CFG_TUD_EDPT_XFER_QUEUE, transfers on a non-control endpoint can be
+// submitted while it is busy, they are started in submission order as soon as the previous one completes
 bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes);
 
+// Number of transfers that can still be submitted to endpoint with usbd_edpt_xfer()
+uint8_t usbd_edpt_xfer_available(uint8_t rhport, uint8_t ep_addr);
+
 // Submit a usb ISO transfer by use of a FIFO (ring buffer) - all bytes in FIFO get transmitted
 bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes);
 
+// Check if DCD can transfer directly from/to a FIFO with usbd_edpt_xfer_fifo()
+bool usbd_edpt_xfer_fifo_supported(uint8_t rhport);
+
 // Claim an endpoint before submitting a transfer.
 // If caller does not make any transfer, it must release endpoint for others.
 bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr);
 
+// Same as usbd_edpt_claim(), but with CFG_TUD_EDPT_XFER_QUEUE a busy endpoint can be claimed
+// as long as another transfer can be queued. Claim is consumed by usbd_edpt_xfer().
+bool usbd_edpt_claim_queued(uint8_t rhport, uint8_t ep_addr);
+
 // Release claimed endpoint without submitting a transfer
 bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr);
 
@@ -103,9 +121,65 @@ bool usbd_edpt_ready(uint8_t rhport, uint8_t ep_addr)
   return !usbd_edpt_busy(rhport, ep_addr) && !usbd_edpt_stalled(rhport, ep_addr);
 }
 
-// Enable SOF interrupt
+// Drivers that need the SOF interrupt, each one enables/disables it independently
+typedef enum
+{
+  SOF_CONSUMER_APP = 0, // application class drivers using usbd_sof_enable()
+  SOF_CONSUMER_AUDIO,
+  SOF_CONSUMER_TX_COALESCE, // frame countdown of usbd_tx_coalesce_t
+} sof_consumer_t;
+
+// Enable SOF interrupt for a consumer, it is only disabled once no consumer needs it any more
+void usbd_sof_consumer_enable(uint8_t rhport, sof_consumer_t consumer, bool en);
+
+// Enable SOF interrupt, for application class drivers
 void usbd_sof_enable(uint8_t rhport, bool en);
 
+//--------------------------------------------------------------------+
+// TX coalescing of byte-stream drivers (CDC, Vendor), see tud_tx_coalesce_t
+//--------------------------------------------------------------------+
+typedef struct
+{
+  volatile uint16_t countdown; // frames left until pending TX data is flushed, 0 if not armed
+  uint16_t frames;
+  uint8_t  policy;
+  bool     sof;                // SOF is enabled for the frame countdown of this interface
+} usbd_tx_coalesce_t;
+
+// Set policy and disarm countdown, SOF is updated as with usbd_tx_coalesce_update()
+bool usbd_tx_coalesce_set(uint8_t rhport, usbd_tx_coalesce_t* tc, tud_tx_coalesce_t policy, uint16_t frames, bool opened);
+
+// Interface is opened or reset: SOF is enabled while it is opened with TUD_TX_COALESCE_FRAMES. Disarm countdown.
+void usbd_tx_coalesce_update(uint8_t rhport, usbd_tx_coalesce_t* tc, bool opened);
+
+// Data is queued, return true if it must be sent right away
+TU_ATTR_ALWAYS_INLINE static inline
+bool usbd_tx_coalesce_flush_now(usbd_tx_coalesce_t const* tc, uint32_t count, uint16_t packet_size)
+{
+  return (tc->policy == TUD_TX_COALESCE_IMMEDIATE) || (count >= packet_size);
+}
+
+// Arm frame countdown for data left queued, it is not re-armed by further writes to bound latency
+TU_ATTR_ALWAYS_INLINE static inline
+void usbd_tx_coalesce_arm(usbd_tx_coalesce_t* tc, uint32_t count)
+{
+  if ( (tc->policy == TUD_TX_COALESCE_FRAMES) && !tc->countdown && count ) tc->countdown = tc->frames;
+}
+
+// Data is sent now, countdown is re-armed by next write
+TU_ATTR_ALWAYS_INLINE static inline
+void usbd_tx_coalesce_disarm(usbd_tx_coalesce_t* tc)
+{
+  tc->countdown = 0;
+}
+
+// Count down one frame on SOF, return true when it expires and queued data must be flushed
+TU_ATTR_ALWAYS_INLINE static inline
+bool usbd_tx_coalesce_sof(usbd_tx_coalesce_t* tc)
+{
+  return tc->countdown && (0 == --tc->countdown);
+}
+
 /*------------------------------------------------------------------*/
 /* Helper
  *------------------------------------------------------------------*/
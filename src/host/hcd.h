@@ -40,7 +40,7 @@
 //--------------------------------------------------------------------+
 
 #ifndef CFG_TUH_ENDPOINT_MAX
-  #define CFG_TUH_ENDPOINT_MAX   (CFG_TUH_HUB + CFG_TUH_HID*2 + CFG_TUH_MSC*2 + CFG_TUH_CDC*3)
+  #define CFG_TUH_ENDPOINT_MAX   (CFG_TUH_HUB + CFG_TUH_HID*2 + CFG_TUH_MSC*2 + CFG_TUH_CDC*3 + CFG_TUH_NET*3 + CFG_TUH_VENDOR*2)
 //  #ifdef TUP_HCD_ENDPOINT_MAX
 //    #define CFG_TUH_ENDPPOINT_MAX   TUP_HCD_ENDPOINT_MAX
 //  #else
@@ -159,6 +159,13 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
 // clear stall, data toggle is also reset to DATA0
 bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr);
 
+// optional: abort all transfers submitted to an endpoint which are not yet complete. Return true once the abort
+// is started: controller must no longer process the TDs, but they can be retired asynchronously when it is
+// safe e.g after EHCI async advance doorbell or OHCI next frame. Transfers already done are reported first,
+// then hcd_event_xfer_complete() (can be in isr) invoked for each aborted transfer with XFER_RESULT_FAILED
+// in submission order. Transfers submitted to the endpoint before retirement are aborted as well.
+bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) TU_ATTR_WEAK;
+
 //--------------------------------------------------------------------+
 // USBH implemented API
 //--------------------------------------------------------------------+
@@ -33,6 +33,10 @@
 #include "host/usbh_classdriver.h"
 #include "hub.h"
 
+#if CFG_TUSB_LOCKFREE
+#include "common/tusb_mpsc.h"
+#endif
+
 //--------------------------------------------------------------------+
 // USBH Configuration
 //--------------------------------------------------------------------+
@@ -74,6 +78,41 @@ typedef struct
 
 } usbh_dev0_t;
 
+// Maximum transfers submitted but not yet completed on a non-control endpoint
+#define EDPT_XFER_MAX     (CFG_TUH_EDPT_XFER_QUEUE + 1)
+
+// Transfer requests are tracked per endpoint when they can be queued or need a callback
+#define USBH_URB_ENABLED  (CFG_TUH_EDPT_XFER_QUEUE || CFG_TUH_API_EDPT_XFER)
+
+#if USBH_URB_ENABLED
+typedef struct
+{
+  uint8_t* buffer;
+  uint16_t buflen;
+
+#if CFG_TUH_API_EDPT_XFER
+  tuh_xfer_cb_t complete_cb;
+  uintptr_t user_data;
+
+  uint32_t timeout_ms; // 0 is no timeout
+  uint32_t start_ms;   // frame number when submitted
+  uint8_t  timed_out;  // endpoint is being aborted due to this transfer
+#endif
+} usbh_urb_t;
+
+// Outstanding transfers of an endpoint, completed in submission order
+typedef struct
+{
+  usbh_urb_t urb[EDPT_XFER_MAX];
+  uint8_t rd_idx;
+  uint8_t count;
+
+#if !TUP_HCD_EDPT_XFER_QUEUE
+  uint8_t abort_count; // number of oldest transfers to fail, the ones outstanding when aborted
+#endif
+} usbh_urb_queue_t;
+#endif
+
 typedef struct {
   // port, must be same layout as usbh_dev0_t
   uint8_t rhport;
@@ -108,12 +147,9 @@ typedef struct {
 
   tu_edpt_state_t ep_status[CFG_TUH_ENDPOINT_MAX][2];
 
-#if CFG_TUH_API_EDPT_XFER
+#if USBH_URB_ENABLED
   // TODO array can be CFG_TUH_ENDPOINT_MAX-1
-  struct {
-    tuh_xfer_cb_t complete_cb;
-    uintptr_t user_data;
-  }ep_callback[CFG_TUH_ENDPOINT_MAX][2];
+  usbh_urb_queue_t ep_urb[CFG_TUH_ENDPOINT_MAX][2];
 #endif
 
 } usbh_device_t;
@@ -178,13 +214,25 @@ static usbh_class_driver_t const usbh_class_drivers[] =
     },
   #endif
 
+  #if CFG_TUH_NET
+    {
+      DRIVER_NAME("NET")
+      .init       = neth_init,
+      .open       = neth_open,
+      .set_config = neth_set_config,
+      .xfer_cb    = neth_xfer_cb,
+      .close      = neth_close
+    },
+  #endif
+
   #if CFG_TUH_VENDOR
     {
       DRIVER_NAME("VENDOR")
-      .init       = cush_init,
-      .open       = cush_open_subtask,
-      .xfer_cb    = cush_isr,
-      .close      = cush_close
+      .init       = vendorh_init,
+      .open       = vendorh_open,
+      .set_config = vendorh_set_config,
+      .xfer_cb    = vendorh_xfer_cb,
+      .close      = vendorh_close
     }
   #endif
 };
@@ -222,9 +270,25 @@ CFG_TUSB_MEM_SECTION usbh_device_t _usbh_devices[TOTAL_DEVICES];
 #endif
 
 // Event queue
-// usbh_int_set is used as mutex in OS NONE config
-OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
-static osal_queue_t _usbh_q;
+#if CFG_TUSB_LOCKFREE
+  // lock-free ring: ISR on any core and other tasks send events without disabling usb interrupt
+  TU_MPSC_DEF(_usbh_qdef, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
+  static tu_mpsc_t* _usbh_q;
+
+  #define usbh_queue_create   tu_mpsc_create
+  #define usbh_queue_send     tu_mpsc_send
+  #define usbh_queue_receive  tu_mpsc_receive
+  #define usbh_queue_empty    tu_mpsc_empty
+#else
+  // usbh_int_set is used as mutex in OS NONE config
+  OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
+  static osal_queue_t _usbh_q;
+
+  #define usbh_queue_create   osal_queue_create
+  #define usbh_queue_send     osal_queue_send
+  #define usbh_queue_receive  osal_queue_receive
+  #define usbh_queue_empty    osal_queue_empty
+#endif
 
 CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN
 static uint8_t _usbh_ctrl_buf[CFG_TUH_ENUMERATION_BUFSIZE];
@@ -242,8 +306,24 @@ CFG_TUSB_MEM_SECTION struct
   uint8_t daddr;
   volatile uint8_t stage;
   volatile uint16_t actual_len;
+
+  uint32_t timeout_ms;
+  uint32_t start_ms;
+  volatile uint8_t timed_out;
 }_ctrl_xfer;
 
+// Transfer timeouts are checked in usbh task against a millisecond clock derived from frame number.
+// Only the 11-bit USB frame number is used since some HCDs don't count any further.
+#define USBH_FRAME_NUMBER_MASK  0x7FFu
+
+static struct
+{
+  volatile bool armed; // there is pending transfer with timeout
+  uint32_t now_ms;     // millisecond clock
+  uint32_t last_frame; // frame number when clock was last updated
+  uint32_t last_ms;    // clock of last check
+}_usbh_timeout;
+
 //------------- Helper Function -------------//
 
 TU_ATTR_ALWAYS_INLINE
@@ -258,6 +338,16 @@ static void process_device_unplugged(uint8_t rhport, uint8_t hub_addr, uint8_t h
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size);
 static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 
+static bool usbh_timeout_check(void);
+static void timeout_arm(void);
+static uint32_t timeout_clock_ms(void);
+static bool edpt_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes,
+                      tuh_xfer_cb_t complete_cb, uintptr_t user_data, uint32_t timeout_ms);
+
+#if USBH_URB_ENABLED
+static void urb_complete(usbh_device_t* dev, uint8_t daddr, uint8_t ep_addr, usbh_urb_t* urb);
+#endif
+
 #if CFG_TUSB_OS == OPT_OS_NONE
 // TODO rework time-related function later
 void osal_task_delay(uint32_t msec)
@@ -334,7 +424,7 @@ bool tuh_init(uint8_t controller_id)
   TU_LOG_INT(USBH_DEBUG, sizeof(tu_edpt_stream_t));
 
   // Event queue
-  _usbh_q = osal_queue_create( &_usbh_qdef );
+  _usbh_q = usbh_queue_create( &_usbh_qdef );
   TU_ASSERT(_usbh_q != NULL);
 
 #if OSAL_MUTEX_REQUIRED
@@ -347,6 +437,7 @@ bool tuh_init(uint8_t controller_id)
   tu_memclr(&_dev0, sizeof(_dev0));
   tu_memclr(_usbh_devices, sizeof(_usbh_devices));
   tu_memclr(&_ctrl_xfer, sizeof(_ctrl_xfer));
+  tu_memclr(&_usbh_timeout, sizeof(_usbh_timeout));
 
   for(uint8_t i=0; i<TOTAL_DEVICES; i++)
   {
@@ -393,11 +484,15 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr)
   // Skip if stack is not initialized
   if ( !tusb_inited() ) return;
 
+  // Abort transfers whose timeout expired, they are then completed via event queue.
+  // Don't block longer than a frame while there are still timeouts to watch for.
+  if ( usbh_timeout_check() ) timeout_ms = tu_min32(timeout_ms, 1);
+
   // Loop until there is no more events in the queue
   while (1)
   {
     hcd_event_t event;
-    if ( !osal_queue_receive(_usbh_q, &event, timeout_ms) ) return;
+    if ( !usbh_queue_receive(_usbh_q, &event, timeout_ms) ) return;
 
     switch (event.event_id)
     {
@@ -427,6 +522,7 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr)
         uint8_t const ep_addr = event.xfer_complete.ep_addr;
         uint8_t const epnum   = tu_edpt_number(ep_addr);
         uint8_t const ep_dir  = tu_edpt_dir(ep_addr);
+        xfer_result_t result  = (xfer_result_t) event.xfer_complete.result;
 
         TU_LOG_USBH("on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event.xfer_complete.len);
 
@@ -434,43 +530,59 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr)
         {
           // device 0 only has control endpoint
           TU_ASSERT(epnum == 0, );
-          usbh_control_xfer_cb(event.dev_addr, ep_addr, event.xfer_complete.result, event.xfer_complete.len);
+          usbh_control_xfer_cb(event.dev_addr, ep_addr, result, event.xfer_complete.len);
         }
         else
         {
           usbh_device_t* dev = get_device(event.dev_addr);
           TU_ASSERT(dev, );
 
-          dev->ep_status[epnum][ep_dir].busy    = 0;
-          dev->ep_status[epnum][ep_dir].claimed = 0;
+#if USBH_URB_ENABLED
+          usbh_urb_t urb;
+          tu_varclr(&urb);
+
+          if ( epnum != 0 )
+          {
+            // retire the oldest transfer, endpoint is busy until all queued ones complete
+            urb_complete(dev, event.dev_addr, ep_addr, &urb);
+
+            #if CFG_TUH_API_EDPT_XFER
+            // transfer aborted by its timeout
+            if ( urb.timed_out && result != XFER_RESULT_SUCCESS ) result = XFER_RESULT_TIMEOUT;
+            #endif
+          }else
+#endif
+          {
+            tu_edpt_state_clear(&dev->ep_status[epnum][ep_dir], TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+          }
 
           if ( 0 == epnum )
           {
-            usbh_control_xfer_cb(event.dev_addr, ep_addr, event.xfer_complete.result, event.xfer_complete.len);
+            usbh_control_xfer_cb(event.dev_addr, ep_addr, result, event.xfer_complete.len);
           }else
           {
             uint8_t drv_id = dev->ep2drv[epnum][ep_dir];
             if(drv_id < USBH_CLASS_DRIVER_COUNT)
             {
               TU_LOG_USBH("%s xfer callback\r\n", usbh_class_drivers[drv_id].name);
-              usbh_class_drivers[drv_id].xfer_cb(event.dev_addr, ep_addr, event.xfer_complete.result, event.xfer_complete.len);
+              usbh_class_drivers[drv_id].xfer_cb(event.dev_addr, ep_addr, result, event.xfer_complete.len);
             }
             else
             {
 #if CFG_TUH_API_EDPT_XFER
-              tuh_xfer_cb_t complete_cb = dev->ep_callback[epnum][ep_dir].complete_cb;
+              tuh_xfer_cb_t complete_cb = urb.complete_cb;
               if ( complete_cb )
               {
                 tuh_xfer_t xfer =
                 {
                   .daddr       = event.dev_addr,
                   .ep_addr     = ep_addr,
-                  .result      = event.xfer_complete.result,
+                  .result      = result,
                   .actual_len  = event.xfer_complete.len,
-                  .buflen      = 0,    // not available
-                  .buffer      = NULL, // not available
+                  .buflen      = urb.buflen,
+                  .buffer      = urb.buffer,
                   .complete_cb = complete_cb,
-                  .user_data   = dev->ep_callback[epnum][ep_dir].user_data
+                  .user_data   = urb.user_data
                 };
 
                 complete_cb(&xfer);
@@ -496,7 +608,7 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr)
 
 #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
     // return if there is no more events, for application to run other background
-    if (osal_queue_empty(_usbh_q)) return;
+    if (usbh_queue_empty(_usbh_q)) return;
 #endif
   }
 }
@@ -511,7 +623,6 @@ static void _control_blocking_complete_cb(tuh_xfer_t* xfer)
   *((xfer_result_t*) xfer->user_data) = xfer->result;
 }
 
-// TODO timeout_ms is not supported yet
 bool tuh_control_xfer (tuh_xfer_t* xfer)
 {
   // EP0 with setup packet
@@ -535,6 +646,12 @@ bool tuh_control_xfer (tuh_xfer_t* xfer)
     _ctrl_xfer.buffer      = xfer->buffer;
     _ctrl_xfer.complete_cb = xfer->complete_cb;
     _ctrl_xfer.user_data   = xfer->user_data;
+
+    // timeout needs HCD to abort the transfer, otherwise HCD would complete it later as a different one
+    _ctrl_xfer.timeout_ms  = hcd_edpt_abort_xfer ? (xfer->timeout_ms ? xfer->timeout_ms : CFG_TUH_CONTROL_TIMEOUT_MS) : 0;
+    _ctrl_xfer.start_ms    = timeout_clock_ms();
+    _ctrl_xfer.timed_out   = 0;
+    if ( _ctrl_xfer.timeout_ms ) timeout_arm();
   }
 
   (void) osal_mutex_unlock(_usbh_mutex);
@@ -569,8 +686,6 @@ bool tuh_control_xfer (tuh_xfer_t* xfer)
       #if CFG_TUSB_OS == OPT_OS_NONE || CFG_TUSB_OS == OPT_OS_PICO
       tuh_task();
       #endif
-
-      // TODO probably some timeout to prevent hanged
     }
 
     // update transfer result
@@ -608,6 +723,16 @@ static void _xfer_complete(uint8_t daddr, xfer_result_t result)
 
   _set_control_xfer_stage(CONTROL_STAGE_IDLE);
 
+  // Clear Feature (ENDPOINT_HALT) resets the device's data toggle, host side must follow
+  if ( result == XFER_RESULT_SUCCESS &&
+       request.bmRequestType_bit.recipient == TUSB_REQ_RCPT_ENDPOINT &&
+       request.bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD &&
+       request.bRequest == TUSB_REQ_CLEAR_FEATURE && tu_le16toh(request.wValue) == TUSB_REQ_FEATURE_EDPT_HALT )
+  {
+    uint8_t const ep_addr = (uint8_t) tu_le16toh(request.wIndex);
+    if ( tu_edpt_number(ep_addr) ) hcd_edpt_clear_stall(daddr, ep_addr);
+  }
+
   if (xfer_temp.complete_cb)
   {
     xfer_temp.complete_cb(&xfer_temp);
@@ -621,9 +746,16 @@ static bool usbh_control_xfer_cb (uint8_t dev_addr, uint8_t ep_addr, xfer_result
   const uint8_t rhport = usbh_get_rhport(dev_addr);
   tusb_control_request_t const * request = &_ctrl_xfer.request;
 
+  // stale event of a control transfer already completed without HCD abort support
+  if ( _ctrl_xfer.stage == CONTROL_STAGE_IDLE ) return false;
+
+  // transfer timed out: HCD has aborted whatever stage it was in
+  if ( _ctrl_xfer.timed_out ) result = XFER_RESULT_TIMEOUT;
+
   if (XFER_RESULT_SUCCESS != result)
   {
-    TU_LOG1("[%u:%u] Control %s, xferred_bytes = %lu\r\n", rhport, dev_addr, result == XFER_RESULT_STALLED ? "STALLED" : "FAILED", xferred_bytes);
+    TU_LOG1("[%u:%u] Control %s, xferred_bytes = %lu\r\n", rhport, dev_addr,
+            result == XFER_RESULT_STALLED ? "STALLED" : result == XFER_RESULT_TIMEOUT ? "TIMEOUT" : "FAILED", xferred_bytes);
     #if CFG_TUSB_DEBUG == 1
     TU_LOG1_PTR(request);
     TU_LOG1("\r\n");
@@ -681,9 +813,9 @@ bool tuh_edpt_xfer(tuh_xfer_t* xfer)
 
   TU_VERIFY(daddr && ep_addr);
 
-  TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
+  TU_VERIFY(usbh_edpt_claim_queued(daddr, ep_addr));
 
-  if ( !usbh_edpt_xfer_with_callback(daddr, ep_addr, xfer->buffer, (uint16_t) xfer->buflen, xfer->complete_cb, xfer->user_data) )
+  if ( !edpt_xfer(daddr, ep_addr, xfer->buffer, (uint16_t) xfer->buflen, xfer->complete_cb, xfer->user_data, xfer->timeout_ms) )
   {
     usbh_edpt_release(daddr, ep_addr);
     return false;
@@ -692,6 +824,42 @@ bool tuh_edpt_xfer(tuh_xfer_t* xfer)
   return true;
 }
 
+bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr)
+{
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && hcd_edpt_abort_xfer);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  // control transfer is only aborted by its timeout
+  TU_VERIFY(epnum != 0);
+
+  // nothing to abort
+  if ( !dev->ep_status[epnum][dir].busy ) return true;
+
+#if USBH_URB_ENABLED && !TUP_HCD_EDPT_XFER_QUEUE
+  // HCD only holds the oldest transfer, the ones queued behind it are failed by urb_complete()
+  usbh_urb_queue_t* q = &dev->ep_urb[epnum][dir];
+
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  q->abort_count = q->count;
+  (void) osal_mutex_unlock(_usbh_mutex);
+
+  if ( !hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr) )
+  {
+    (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    q->abort_count = 0;
+    (void) osal_mutex_unlock(_usbh_mutex);
+    return false;
+  }
+
+  return true;
+#else
+  return hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr);
+#endif
+}
+
 //--------------------------------------------------------------------+
 // USBH API For Class Driver
 //--------------------------------------------------------------------+
@@ -737,6 +905,34 @@ bool usbh_edpt_claim(uint8_t dev_addr, uint8_t ep_addr)
   return tu_edpt_claim(&dev->ep_status[epnum][dir], _usbh_mutex);
 }
 
+bool usbh_edpt_claim_queued(uint8_t dev_addr, uint8_t ep_addr)
+{
+#if CFG_TUH_EDPT_XFER_QUEUE
+  usbh_device_t* dev = get_device(dev_addr);
+
+  // addr0 only use tuh_control_xfer
+  TU_ASSERT(dev);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  if ( epnum != 0 )
+  {
+    // endpoint can be claimed while busy as long as there is room for another transfer
+    tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+
+    (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    bool const available = (dev->ep_urb[epnum][dir].count < EDPT_XFER_MAX) &&
+                           !(tu_edpt_state_set(ep_state, TU_EDPT_STATE_CLAIMED) & TU_EDPT_STATE_CLAIMED);
+    (void) osal_mutex_unlock(_usbh_mutex);
+
+    return available;
+  }
+#endif
+
+  return usbh_edpt_claim(dev_addr, ep_addr);
+}
+
 // TODO has some duplication code with device, refactor later
 bool usbh_edpt_release(uint8_t dev_addr, uint8_t ep_addr)
 {
@@ -748,15 +944,143 @@ bool usbh_edpt_release(uint8_t dev_addr, uint8_t ep_addr)
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
+#if CFG_TUH_EDPT_XFER_QUEUE
+  if ( epnum != 0 )
+  {
+    // claim is dropped on submission, so a claimed endpoint has no transfer pending on it yet
+    tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+
+    (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    bool const ret = tu_edpt_state_clear(ep_state, TU_EDPT_STATE_CLAIMED) & TU_EDPT_STATE_CLAIMED;
+    (void) osal_mutex_unlock(_usbh_mutex);
+
+    return ret;
+  }
+#endif
+
   return tu_edpt_release(&dev->ep_status[epnum][dir], _usbh_mutex);
 }
 
+#if USBH_URB_ENABLED
+static bool urb_submit(usbh_device_t* dev, uint8_t daddr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen,
+                       tuh_xfer_cb_t complete_cb, uintptr_t user_data, uint32_t timeout_ms)
+{
+  (void) complete_cb;
+  (void) user_data;
+  (void) timeout_ms;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+  usbh_urb_queue_t* q = &dev->ep_urb[epnum][dir];
+  usbh_urb_t* urb = NULL;
+
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+  // Attempt to transfer on a full endpoint, sound like an race condition !
+  if ( q->count < EDPT_XFER_MAX )
+  {
+    urb = &q->urb[(q->rd_idx + q->count) % EDPT_XFER_MAX];
+    urb->buffer = buffer;
+    urb->buflen = buflen;
+#if CFG_TUH_API_EDPT_XFER
+    urb->complete_cb = complete_cb;
+    urb->user_data   = user_data;
+
+    // timeout needs HCD to abort the transfer
+    urb->timeout_ms  = hcd_edpt_abort_xfer ? timeout_ms : 0;
+    urb->start_ms    = timeout_clock_ms();
+    urb->timed_out   = 0;
+    if ( urb->timeout_ms ) timeout_arm();
+#endif
+
+    // Set busy first since the actual transfer can be complete before hcd_edpt_xfer()
+    // could return and USBH task can preempt and clear the busy
+    q->count++;
+    tu_edpt_state_set(ep_state, TU_EDPT_STATE_BUSY);
+  }
+
+  // claim is consumed by submission, allowing next transfer to be claimed
+  tu_edpt_state_clear(ep_state, TU_EDPT_STATE_CLAIMED);
+
+#if TUP_HCD_EDPT_XFER_QUEUE
+  bool const start_now = true;
+#else
+  // HCD can only hold one transfer, queued ones are started by urb_complete()
+  bool const start_now = (q->count == 1);
+#endif
+
+  (void) osal_mutex_unlock(_usbh_mutex);
+
+  TU_ASSERT(urb);
+
+  if ( start_now && !hcd_edpt_xfer(dev->rhport, daddr, ep_addr, buffer, buflen) )
+  {
+    // HCD error, drop the transfer just added which is the newest one
+    (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    if ( 0 == --q->count ) tu_edpt_state_clear(ep_state, TU_EDPT_STATE_BUSY);
+    (void) osal_mutex_unlock(_usbh_mutex);
+
+    TU_LOG1("Failed\r\n");
+    TU_BREAKPOINT();
+    return false;
+  }
+
+  TU_LOG_USBH("OK\r\n");
+  return true;
+}
+
+// Retire oldest transfer of endpoint into urb
+static void urb_complete(usbh_device_t* dev, uint8_t daddr, uint8_t ep_addr, usbh_urb_t* urb)
+{
+  (void) daddr;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  usbh_urb_queue_t* q = &dev->ep_urb[epnum][dir];
+
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+  // nothing is outstanding for a stale event e.g of a removed device
+  if ( q->count )
+  {
+    (*urb) = q->urb[q->rd_idx];
+    q->rd_idx = (uint8_t) ((q->rd_idx + 1) % EDPT_XFER_MAX);
+    q->count--;
+  }
+
+  uint8_t const remaining = q->count;
+  if ( remaining == 0 ) tu_edpt_state_clear(&dev->ep_status[epnum][dir], TU_EDPT_STATE_BUSY);
+
+#if !TUP_HCD_EDPT_XFER_QUEUE
+  usbh_urb_t const next = q->urb[q->rd_idx];
+
+  // completed transfer is one of the aborted ones, next one is failed without starting if also aborted
+  if ( q->abort_count ) q->abort_count--;
+  if ( remaining == 0 ) q->abort_count = 0;
+  bool const abort_next = (q->abort_count != 0);
+#endif
+
+  (void) osal_mutex_unlock(_usbh_mutex);
+
+#if !TUP_HCD_EDPT_XFER_QUEUE
+  // start next queued transfer before invoking callback of the completed one
+  if ( remaining && (abort_next || !hcd_edpt_xfer(dev->rhport, daddr, ep_addr, next.buffer, next.buflen)) )
+  {
+    // report as failed so that it is retired in order
+    hcd_event_xfer_complete(daddr, ep_addr, 0, XFER_RESULT_FAILED, false);
+  }
+#endif
+}
+#endif
+
 // TODO has some duplication code with device, refactor later
-bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes,
-                                  tuh_xfer_cb_t complete_cb, uintptr_t user_data)
+static bool edpt_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes,
+                      tuh_xfer_cb_t complete_cb, uintptr_t user_data, uint32_t timeout_ms)
 {
   (void) complete_cb;
   (void) user_data;
+  (void) timeout_ms;
 
   usbh_device_t* dev = get_device(dev_addr);
   TU_VERIFY(dev);
@@ -767,17 +1091,16 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * b
 
   TU_LOG_USBH("  Queue EP %02X with %u bytes ... ", ep_addr, total_bytes);
 
+#if USBH_URB_ENABLED
+  if ( epnum != 0 ) return urb_submit(dev, dev_addr, ep_addr, buffer, total_bytes, complete_cb, user_data, timeout_ms);
+#endif
+
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(ep_state->busy == 0);
 
   // Set busy first since the actual transfer can be complete before hcd_edpt_xfer()
   // could return and USBH task can preempt and clear the busy
-  ep_state->busy = 1;
-
-#if CFG_TUH_API_EDPT_XFER
-  dev->ep_callback[epnum][dir].complete_cb = complete_cb;
-  dev->ep_callback[epnum][dir].user_data   = user_data;
-#endif
+  tu_edpt_state_set(ep_state, TU_EDPT_STATE_BUSY);
 
   if ( hcd_edpt_xfer(dev->rhport, dev_addr, ep_addr, buffer, total_bytes) )
   {
@@ -786,14 +1109,155 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * b
   }else
   {
     // HCD error, mark endpoint as ready to allow next transfer
-    ep_state->busy    = 0;
-    ep_state->claimed = 0;
+    tu_edpt_state_clear(ep_state, TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
     TU_LOG1("Failed\r\n");
     TU_BREAKPOINT();
     return false;
   }
 }
 
+bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes,
+                                  tuh_xfer_cb_t complete_cb, uintptr_t user_data)
+{
+  return edpt_xfer(dev_addr, ep_addr, buffer, total_bytes, complete_cb, user_data, 0);
+}
+
+//--------------------------------------------------------------------+
+// Transfer Timeout
+//--------------------------------------------------------------------+
+
+// Advance millisecond clock by frames elapsed since last update (modulo frame number range).
+// Caller must hold _usbh_mutex. Clock must be updated at least every 2 seconds while timeouts are
+// armed (usbh task does every frame), otherwise pending timeouts are delayed but never expire early.
+static uint32_t timeout_clock_ms(void)
+{
+  uint32_t const frame = hcd_frame_number(_usbh_controller);
+  _usbh_timeout.now_ms    += (frame - _usbh_timeout.last_frame) & USBH_FRAME_NUMBER_MASK;
+  _usbh_timeout.last_frame = frame;
+  return _usbh_timeout.now_ms;
+}
+
+// Start watching for timeout, wake up usbh task in case it is blocked waiting for event
+static void timeout_arm(void)
+{
+  if ( _usbh_timeout.armed ) return;
+  _usbh_timeout.armed = true;
+
+  hcd_event_t event =
+  {
+    .rhport   = _usbh_controller,
+    .event_id = USBH_EVENT_FUNC_CALL,
+  };
+  event.func_call.func  = NULL;
+  event.func_call.param = NULL;
+
+  hcd_event_handler(&event, false);
+}
+
+static void control_timeout_check(uint32_t now_ms)
+{
+  bool expired = false;
+
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  uint8_t const daddr = _ctrl_xfer.daddr;
+  if ( _ctrl_xfer.stage != CONTROL_STAGE_IDLE && _ctrl_xfer.timeout_ms && !_ctrl_xfer.timed_out )
+  {
+    if ( now_ms - _ctrl_xfer.start_ms >= _ctrl_xfer.timeout_ms )
+    {
+      _ctrl_xfer.timed_out = 1;
+      expired = true;
+    }else
+    {
+      _usbh_timeout.armed = true;
+    }
+  }
+  (void) osal_mutex_unlock(_usbh_mutex);
+
+  if ( expired )
+  {
+    TU_LOG_USBH("[%u] Control transfer timeout\r\n", daddr);
+
+    // aborted stage is reported by HCD and completed as timeout by usbh_control_xfer_cb().
+    // Timeout is only armed with HCD abort support, which only fails if device is already gone
+    if ( !hcd_edpt_abort_xfer(usbh_get_rhport(daddr), daddr, 0) ) _xfer_complete(daddr, XFER_RESULT_TIMEOUT);
+  }
+}
+
+#if CFG_TUH_API_EDPT_XFER
+static void urb_timeout_check(uint32_t now_ms)
+{
+  for(uint8_t daddr = 1; daddr <= TOTAL_DEVICES; daddr++)
+  {
+    usbh_device_t* dev = get_device(daddr);
+    if ( !dev->connected ) continue;
+
+    for(uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++)
+    {
+      for(uint8_t dir = 0; dir < 2; dir++)
+      {
+        usbh_urb_queue_t* q = &dev->ep_urb[epnum][dir];
+        bool expired = false;
+
+        (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+        for(uint8_t i = 0; i < q->count; i++)
+        {
+          usbh_urb_t* urb = &q->urb[(q->rd_idx + i) % EDPT_XFER_MAX];
+          if ( urb->timeout_ms == 0 || urb->timed_out ) continue;
+
+          // only the oldest one is in progress, the others are waiting for their turn
+          if ( i == 0 && (now_ms - urb->start_ms >= urb->timeout_ms) )
+          {
+            urb->timed_out = 1;
+            expired = true;
+          }else
+          {
+            _usbh_timeout.armed = true;
+          }
+        }
+        (void) osal_mutex_unlock(_usbh_mutex);
+
+        if ( expired )
+        {
+          TU_LOG_USBH("[%u] EP %02X transfer timeout\r\n", daddr, tu_edpt_addr(epnum, dir));
+
+          // all transfers of the endpoint are aborted, the timed out one completes with XFER_RESULT_TIMEOUT
+          (void) tuh_edpt_abort_xfer(daddr, tu_edpt_addr(epnum, dir));
+        }
+      }
+    }
+  }
+}
+#endif
+
+// Check timeouts against millisecond clock, at most once per frame.
+// Return true if there are still pending transfers with timeout
+static bool usbh_timeout_check(void)
+{
+  if ( !_usbh_timeout.armed ) return false;
+
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  uint32_t const now_ms = timeout_clock_ms();
+  bool const same_frame = (now_ms == _usbh_timeout.last_ms);
+
+  // re-armed by pending transfers found below or submitted meanwhile
+  if ( !same_frame )
+  {
+    _usbh_timeout.last_ms = now_ms;
+    _usbh_timeout.armed   = false;
+  }
+  (void) osal_mutex_unlock(_usbh_mutex);
+
+  if ( same_frame ) return true;
+
+  control_timeout_check(now_ms);
+
+#if CFG_TUH_API_EDPT_XFER
+  urb_timeout_check(now_ms);
+#endif
+
+  return _usbh_timeout.armed;
+}
+
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size)
 {
   TU_LOG_USBH("[%u:%u] Open EP0 with Size = %u\r\n", usbh_get_rhport(dev_addr), dev_addr, max_packet_size);
@@ -857,7 +1321,7 @@ TU_ATTR_FAST_FUNC void hcd_event_handler(hcd_event_t const* event, bool in_isr)
   switch (event->event_id)
   {
     default:
-      osal_queue_send(_usbh_q, event, in_isr);
+      usbh_queue_send(_usbh_q, event, in_isr);
     break;
   }
 }
@@ -1033,6 +1497,39 @@ bool tuh_configuration_set(uint8_t daddr, uint8_t config_num,
   return tuh_control_xfer(&xfer);
 }
 
+bool tuh_edpt_clear_halt(uint8_t daddr, uint8_t ep_addr,
+                         tuh_xfer_cb_t complete_cb, uintptr_t user_data)
+{
+  TU_VERIFY(tu_edpt_number(ep_addr));
+  TU_LOG_USBH("Clear Halt EP %02X\r\n", ep_addr);
+
+  tusb_control_request_t const request =
+  {
+    .bmRequestType_bit =
+    {
+      .recipient = TUSB_REQ_RCPT_ENDPOINT,
+      .type      = TUSB_REQ_TYPE_STANDARD,
+      .direction = TUSB_DIR_OUT
+    },
+    .bRequest = TUSB_REQ_CLEAR_FEATURE,
+    .wValue   = tu_htole16(TUSB_REQ_FEATURE_EDPT_HALT),
+    .wIndex   = tu_htole16((uint16_t) ep_addr),
+    .wLength  = 0
+  };
+
+  tuh_xfer_t xfer =
+  {
+    .daddr       = daddr,
+    .ep_addr     = 0,
+    .setup       = &request,
+    .buffer      = NULL,
+    .complete_cb = complete_cb,
+    .user_data   = user_data
+  };
+
+  return tuh_control_xfer(&xfer);
+}
+
 //--------------------------------------------------------------------+
 // Descriptor Sync
 //--------------------------------------------------------------------+
@@ -59,14 +59,14 @@ struct tuh_xfer_s
   union
   {
     tusb_control_request_t const* setup; // setup packet pointer if control transfer
-    uint32_t buflen;                     // expected length if not control transfer (not available in callback)
+    uint32_t buflen;                     // expected length if not control transfer
   };
 
-  uint8_t* buffer;           // not available in callback if not control transfer
+  uint8_t* buffer;
   tuh_xfer_cb_t complete_cb;
   uintptr_t user_data;
 
-  // uint32_t timeout_ms;    // place holder, not supported yet
+  uint32_t timeout_ms;      // 0 = no timeout, or CFG_TUH_CONTROL_TIMEOUT_MS (disabled by default) for control transfer
 };
 
 // ConfigID for tuh_config()
@@ -160,11 +160,24 @@ bool tuh_control_xfer(tuh_xfer_t* xfer);
 // Submit a bulk/interrupt transfer
 //  - async: complete callback invoked when finished.
 //  - sync : blocking if complete callback is NULL.
+// Up to CFG_TUH_EDPT_XFER_QUEUE+1 transfers can be outstanding on an endpoint, completed in order
+// A transfer not complete within timeout_ms aborts the endpoint (requires HCD support), it completes
+// with XFER_RESULT_TIMEOUT and transfers queued behind it with XFER_RESULT_FAILED
 bool tuh_edpt_xfer(tuh_xfer_t* xfer);
 
+// Abort all transfers pending on a non-control endpoint, they complete with XFER_RESULT_FAILED.
+// Return false if not supported by HCD
+bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr);
+
 // Open an non-control endpoint
 bool tuh_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const * desc_ep);
 
+// Clear halt condition of a non-control endpoint (control transfer), host side data toggle
+// is reset when the request succeeds. Queued transfers resume if HCD keeps them across the halt
+// true on success, false if there is on-going control transfer or incorrect parameters
+bool tuh_edpt_clear_halt(uint8_t daddr, uint8_t ep_addr,
+                         tuh_xfer_cb_t complete_cb, uintptr_t user_data);
+
 // Set Configuration (control transfer)
 // config_num = 0 will un-configure device. Note: config_num = config_descriptor_index + 1
 // true on success, false if there is on-going control transfer or incorrect parameters
@@ -79,14 +79,18 @@ static inline bool usbh_edpt_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * b
 }
 
 
-// Claim an endpoint before submitting a transfer.
+// Claim an idle endpoint before submitting a transfer.
 // If caller does not make any transfer, it must release endpoint for others.
 bool usbh_edpt_claim(uint8_t dev_addr, uint8_t ep_addr);
 
+// Same as usbh_edpt_claim(), but with CFG_TUH_EDPT_XFER_QUEUE a busy endpoint can be claimed
+// until its transfer queue is full. Caller must use a separate buffer for each queued transfer.
+bool usbh_edpt_claim_queued(uint8_t dev_addr, uint8_t ep_addr);
+
 // Release claimed endpoint without submitting a transfer
 bool usbh_edpt_release(uint8_t dev_addr, uint8_t ep_addr);
 
-// Check if endpoint transferring is complete
+// Check if endpoint has any transfer outstanding
 bool usbh_edpt_busy(uint8_t dev_addr, uint8_t ep_addr);
 
 #ifdef __cplusplus
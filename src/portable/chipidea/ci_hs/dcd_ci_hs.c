@@ -136,7 +136,9 @@ typedef struct
   // Therefore there are 16 bytes padding that we can use.
   //--------------------------------------------------------------------+
   tu_fifo_t * ff;
-  uint8_t reserved[12];
+  uint8_t qtd_head;  ///< index of oldest qtd in endpoint's qtd list
+  uint8_t qtd_count; ///< number of qtd submitted and not yet completed
+  uint8_t reserved[10];
 } dcd_qhd_t;
 
 TU_VERIFY_STATIC( sizeof(dcd_qhd_t) == 64, "size is not correct");
@@ -147,12 +149,15 @@ TU_VERIFY_STATIC( sizeof(dcd_qhd_t) == 64, "size is not correct");
 
 #define QTD_NEXT_INVALID 0x01
 
+// Transfers can be queued by linking more TDs to the active one (TUP_DCD_EDPT_XFER_QUEUE)
+#define QTD_PER_EP  (CFG_TUD_EDPT_XFER_QUEUE + 1)
+
 typedef struct {
   // Must be at 2K alignment
   // Each endpoint with direction (IN/OUT) occupies a queue head
-  // for portability, TinyUSB only queue 1 TD for each Qhd
+  // Each queue head has a ring of QTD_PER_EP TDs, one per submitted transfer
   dcd_qhd_t qhd[TUP_DCD_ENDPOINT_MAX][2] TU_ATTR_ALIGNED(64);
-  dcd_qtd_t qtd[TUP_DCD_ENDPOINT_MAX][2] TU_ATTR_ALIGNED(32);
+  dcd_qtd_t qtd[TUP_DCD_ENDPOINT_MAX][2][QTD_PER_EP] TU_ATTR_ALIGNED(32);
 }dcd_data_t;
 
 CFG_TUSB_MEM_SECTION TU_ATTR_ALIGNED(2048)
@@ -321,6 +326,7 @@ void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
 
   // flush to abort any primed buffer
   dcd_reg->ENDPTFLUSH = TU_BIT(epnum + (dir ? 16 : 0));
+  _dcd_data.qhd[epnum][dir].qtd_count = 0;
 }
 
 void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
@@ -382,6 +388,8 @@ void dcd_edpt_close_all (uint8_t rhport)
   {
     _dcd_data.qhd[epnum][TUSB_DIR_OUT].qtd_overlay.halted = 1;
     _dcd_data.qhd[epnum][TUSB_DIR_IN ].qtd_overlay.halted = 1;
+    _dcd_data.qhd[epnum][TUSB_DIR_OUT].qtd_count = 0;
+    _dcd_data.qhd[epnum][TUSB_DIR_IN ].qtd_count = 0;
 
     dcd_reg->ENDPTFLUSH = TU_BIT(epnum) |  TU_BIT(epnum+16);
     dcd_reg->ENDPTCTRL[epnum] = (TUSB_XFER_BULK << ENDPTCTRL_TYPE_POS) | (TUSB_XFER_BULK << (16+ENDPTCTRL_TYPE_POS));
@@ -401,16 +409,16 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   uint32_t const flush_mask = TU_BIT(epnum + (dir ? 16 : 0));
   dcd_reg->ENDPTFLUSH = flush_mask;
   while(dcd_reg->ENDPTFLUSH & flush_mask);
+  _dcd_data.qhd[epnum][dir].qtd_count = 0;
 
   // Clear EP enable
   dcd_reg->ENDPTCTRL[epnum] &=~(ENDPTCTRL_ENABLE << (dir ? 16 : 0));
 }
 
-static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir)
+static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir, dcd_qtd_t* p_qtd)
 {
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
   dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t* p_qtd = &_dcd_data.qtd[epnum][dir];
 
   p_qhd->qtd_overlay.halted = false;            // clear any previous error
   p_qhd->qtd_overlay.next   = (uint32_t) p_qtd; // link qtd to qhd
@@ -429,20 +437,88 @@ static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir)
   dcd_reg->ENDPTPRIME = TU_BIT(epnum + (dir ? 16 : 0));
 }
 
+#if QTD_PER_EP > 1
+// Add qtd to an endpoint with transfer in progress, follows UM 23.10.11.3 Executing a transfer descriptor
+static void qhd_append_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir, dcd_qtd_t* p_last, dcd_qtd_t* p_qtd)
+{
+  ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
+  uint32_t const ep_mask = TU_BIT(epnum + (dir ? 16 : 0));
+
+  p_last->next = (uint32_t) p_qtd;
+  CleanInvalidateDCache_by_Addr((uint32_t*) &_dcd_data, sizeof(dcd_data_t));
+
+  // controller will fetch the new qtd if endpoint is still being primed
+  if ( dcd_reg->ENDPTPRIME & ep_mask ) return;
+
+  // read endpoint status with add dTD tripwire semaphore
+  uint32_t ep_status;
+  do
+  {
+    dcd_reg->USBCMD |= USBCMD_ADD_QTD_TRIPWIRE;
+    ep_status = dcd_reg->ENDPTSTAT & ep_mask;
+  } while ( !(dcd_reg->USBCMD & USBCMD_ADD_QTD_TRIPWIRE) );
+  dcd_reg->USBCMD &= ~USBCMD_ADD_QTD_TRIPWIRE;
+
+  // controller has already retired the list before seeing the new qtd: prime it
+  if ( !ep_status ) qhd_start_xfer(rhport, epnum, dir, p_qtd);
+}
+#endif
+
+// Get next free qtd of endpoint, return NULL if all are in use
+static dcd_qtd_t* qtd_next_free(uint8_t epnum, uint8_t dir)
+{
+  dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
+
+  // Control transfer is never queued, new SETUP aborts any pending data/status stage
+  if ( epnum == 0 ) p_qhd->qtd_count = 0;
+
+  if ( p_qhd->qtd_count >= QTD_PER_EP ) return NULL;
+
+  return &_dcd_data.qtd[epnum][dir][(p_qhd->qtd_head + p_qhd->qtd_count) % QTD_PER_EP];
+}
+
+// Start qtd prepared by qtd_next_free(), either directly or linked behind the active ones
+static void qhd_submit_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir, dcd_qtd_t* p_qtd)
+{
+  dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
+
+#if QTD_PER_EP > 1
+  // completion ISR also update the qtd list
+  CI_DCD_INT_DISABLE(rhport);
+
+  if ( p_qhd->qtd_count )
+  {
+    uint8_t const last_idx = (p_qhd->qtd_head + p_qhd->qtd_count - 1) % QTD_PER_EP;
+    p_qhd->qtd_count++;
+    qhd_append_xfer(rhport, epnum, dir, &_dcd_data.qtd[epnum][dir][last_idx], p_qtd);
+  }else
+  {
+    p_qhd->qtd_count++;
+    qhd_start_xfer(rhport, epnum, dir, p_qtd);
+  }
+
+  CI_DCD_INT_ENABLE(rhport);
+#else
+  p_qhd->qtd_count = 1;
+  qhd_start_xfer(rhport, epnum, dir, p_qtd);
+#endif
+}
+
 bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t* p_qtd = &_dcd_data.qtd[epnum][dir];
+  dcd_qtd_t* p_qtd = qtd_next_free(epnum, dir);
+  TU_ASSERT(p_qtd);
 
   // Prepare qtd
   qtd_init(p_qtd, buffer, total_bytes);
 
   // Start qhd transfer
   p_qhd->ff = NULL;
-  qhd_start_xfer(rhport, epnum, dir);
+  qhd_submit_xfer(rhport, epnum, dir, p_qtd);
 
   return true;
 }
@@ -454,7 +530,10 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   dcd_qhd_t * p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t * p_qtd = &_dcd_data.qtd[epnum][dir];
+
+  // fifo transfer is not queued behind other transfers
+  TU_ASSERT(p_qhd->qtd_count == 0);
+  dcd_qtd_t * p_qtd = qtd_next_free(epnum, dir);
 
   tu_fifo_buffer_info_t fifo_info;
 
@@ -505,7 +584,7 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
 
   // Start qhd transfer
   p_qhd->ff = ff;
-  qhd_start_xfer(rhport, epnum, dir);
+  qhd_submit_xfer(rhport, epnum, dir, p_qtd);
 
   return true;
 }
@@ -517,33 +596,54 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
 static void process_edpt_complete_isr(uint8_t rhport, uint8_t epnum, uint8_t dir)
 {
   dcd_qhd_t * p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t * p_qtd = &_dcd_data.qtd[epnum][dir];
-
-  uint8_t result = p_qtd->halted ? XFER_RESULT_STALLED :
-      ( p_qtd->xact_err || p_qtd->buffer_err ) ? XFER_RESULT_FAILED : XFER_RESULT_SUCCESS;
 
-  if ( result != XFER_RESULT_SUCCESS )
+  // there may be more than one completed qtd when transfers are queued
+  while ( p_qhd->qtd_count )
   {
-    ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
-    // flush to abort error buffer
-    dcd_reg->ENDPTFLUSH = TU_BIT(epnum + (dir ? 16 : 0));
-  }
+    dcd_qtd_t * p_qtd = &_dcd_data.qtd[epnum][dir][p_qhd->qtd_head];
 
-  uint16_t const xferred_bytes = p_qtd->expected_bytes - p_qtd->total_bytes;
+    // qtd still in progress
+    if ( p_qtd->active ) break;
 
-  if (p_qhd->ff)
-  {
-    if (dir == TUSB_DIR_IN)
+    p_qhd->qtd_head = (p_qhd->qtd_head + 1) % QTD_PER_EP;
+    p_qhd->qtd_count--;
+
+    uint8_t result = p_qtd->halted ? XFER_RESULT_STALLED :
+        ( p_qtd->xact_err || p_qtd->buffer_err ) ? XFER_RESULT_FAILED : XFER_RESULT_SUCCESS;
+
+    if ( result != XFER_RESULT_SUCCESS )
     {
-      tu_fifo_advance_read_pointer(p_qhd->ff, xferred_bytes);
-    } else
+      ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
+      // flush to abort error buffer
+      dcd_reg->ENDPTFLUSH = TU_BIT(epnum + (dir ? 16 : 0));
+    }
+
+    uint16_t const xferred_bytes = p_qtd->expected_bytes - p_qtd->total_bytes;
+
+    if (p_qhd->ff)
     {
-      tu_fifo_advance_write_pointer(p_qhd->ff, xferred_bytes);
+      if (dir == TUSB_DIR_IN)
+      {
+        tu_fifo_advance_read_pointer(p_qhd->ff, xferred_bytes);
+      } else
+      {
+        tu_fifo_advance_write_pointer(p_qhd->ff, xferred_bytes);
+      }
+    }
+
+    // only number of bytes in the IOC qtd
+    dcd_event_xfer_complete(rhport, tu_edpt_addr(epnum, dir), xferred_bytes, result, true);
+
+    if ( result != XFER_RESULT_SUCCESS )
+    {
+      // queued transfers are flushed together with the failed one
+      while ( p_qhd->qtd_count )
+      {
+        p_qhd->qtd_count--;
+        dcd_event_xfer_complete(rhport, tu_edpt_addr(epnum, dir), 0, XFER_RESULT_FAILED, true);
+      }
     }
   }
-  
-  // only number of bytes in the IOC qtd
-  dcd_event_xfer_complete(rhport, tu_edpt_addr(epnum, dir), xferred_bytes, result, true);
 }
 
 void dcd_int_handler(uint8_t rhport)
@@ -58,8 +58,30 @@
 
 #define FRAMELIST_SIZE                  (1024 >> FRAMELIST_SIZE_BIT_VALUE)
 
+// Number of qTDs (each covers 16-20 KB) an endpoint can have queued, for long transfers or
+// several transfers pending back-to-back. Control endpoints only ever need one qTD at a time.
+// Default is one per queued transfer (CFG_TUH_EDPT_XFER_QUEUE) plus one for a long transfer.
+#ifndef CFG_TUH_EHCI_QTD_PER_EP
+  #define CFG_TUH_EHCI_QTD_PER_EP   (CFG_TUH_EDPT_XFER_QUEUE + 2)
+#endif
+
+#define CTRL_QHD_MAX (CFG_TUH_DEVICE_MAX+CFG_TUH_HUB+1)
 #define QHD_MAX      (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX)
-#define QTD_MAX      QHD_MAX
+#define QTD_MAX      (QHD_MAX*CFG_TUH_EHCI_QTD_PER_EP + CTRL_QHD_MAX)
+
+// end of pool free list
+#define POOL_INDEX_NONE  0xFFFFu
+
+// Aborted periodic qhd can still be cached by host controller until the end of current frame (EHCI 4.8.3),
+// async advance doorbell is rung until this many micro frames have passed since the abort
+#define EHCI_ABORT_PERIODIC_UFRAMES  8
+#define EHCI_FRAME_INDEX_MASK        0x3FFFu
+
+TU_VERIFY_STATIC(QTD_MAX < POOL_INDEX_NONE && QHD_MAX < POOL_INDEX_NONE, "pool is too large");
+
+// Full/Low speed periodic split transaction: start-split can be scheduled in uframe 0 to 3
+// so that 3 complete-splits (start+2 to start+4) still fit within the same frame (EHCI 4.12.2.1)
+#define SPLIT_START_UFRAME_MAX  4
 
 typedef struct
 {
@@ -73,15 +95,36 @@ typedef struct
   // Note control qhd of dev0 is used as head of async list
   struct {
     ehci_qhd_t qhd;
-    ehci_qtd_t qtd;
-  }control[CFG_TUH_DEVICE_MAX+CFG_TUH_HUB+1];
+  }control[CTRL_QHD_MAX];
 
   ehci_qhd_t qhd_pool[QHD_MAX];
   ehci_qtd_t qtd_pool[QTD_MAX] TU_ATTR_ALIGNED(32);
 
+  // Inactive qTD used as alternate next pointer: host controller parks here when a short packet
+  // ends a multiple-qTD IN transfer early, instead of continuing with the rest of that transfer
+  ehci_qtd_t qtd_short_sentinel TU_ATTR_ALIGNED(32);
+
+  // Software bookkeeping of qtd_pool, all qTD words are used by host controller
+  struct {
+    uint16_t expected_bytes;
+    uint16_t next_free; // index of next free qTD while in free list
+  }qtd_info[QTD_MAX];
+
+  // Free lists of qhd_pool and qtd_pool for O(1) allocation, linked by index and terminated by POOL_INDEX_NONE.
+  // Both are also modified in isr, access from task context must disable interrupt.
+  uint16_t qhd_free_head;
+  uint16_t qtd_free_head;
+
   ehci_registers_t* regs;
 
   volatile uint32_t uframe_number;
+
+  // some qhd has aborted transfers waiting for async advance, frame index when the last abort was requested
+  volatile bool abort_pending;
+  uint32_t abort_uframe;
+
+  // number of full/low speed interrupt endpoints whose start-split is scheduled in each uframe
+  uint8_t split_start_count[SPLIT_START_UFRAME_MAX];
 }ehci_data_t;
 
 // Periodic frame list must be 4K alignment
@@ -108,31 +151,40 @@ static inline ehci_qhd_t* qhd_async_head(uint8_t rhport)
   return qhd_control(0);
 }
 
-static inline ehci_qtd_t* qtd_control(uint8_t dev_addr)
-{
-  return &ehci_data.control[dev_addr].qtd;
-}
-
 
 static inline ehci_qhd_t* qhd_next (ehci_qhd_t const * p_qhd);
-static inline ehci_qhd_t* qhd_find_free (void);
+static inline ehci_qhd_t* qhd_alloc (void);
+static inline void qhd_free (ehci_qhd_t* p_qhd);
 static inline ehci_qhd_t* qhd_get_from_addr (uint8_t dev_addr, uint8_t ep_addr);
 
 // determine if a queue head has bus-related error
 static inline bool qhd_has_xact_error (ehci_qhd_t * p_qhd)
 {
-  return (p_qhd->qtd_overlay.buffer_err || p_qhd->qtd_overlay.babble_err || p_qhd->qtd_overlay.xact_err);
-  //p_qhd->qtd_overlay.non_hs_period_missed_uframe || p_qhd->qtd_overlay.pingstate_err TODO split transaction error
+  bool xact_err = (p_qhd->qtd_overlay.buffer_err || p_qhd->qtd_overlay.babble_err || p_qhd->qtd_overlay.xact_err);
+
+  // split transaction: complete-split is missed by host controller
+  if (TUSB_SPEED_HIGH != p_qhd->ep_speed) xact_err = xact_err || p_qhd->qtd_overlay.non_hs_missed_uframe;
+
+  return xact_err;
 }
 
 static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc);
+static void qhd_split_free(ehci_qhd_t *p_qhd);
 
-static inline ehci_qtd_t* qtd_find_free (void);
+static inline ehci_qtd_t* qtd_alloc (void);
 static inline ehci_qtd_t* qtd_next (ehci_qtd_t const * p_qtd);
-static inline void qtd_insert_to_qhd (ehci_qhd_t *p_qhd, ehci_qtd_t *p_qtd_new);
+static inline void qtd_free (ehci_qtd_t* p_qtd);
+static inline uint16_t qtd_xferred_bytes (ehci_qtd_t const* p_qtd);
+static inline void qtd_insert_to_qhd (ehci_qhd_t *p_qhd, ehci_qtd_t *p_qtd_first, ehci_qtd_t *p_qtd_last);
 static inline void qtd_remove_1st_from_qhd (ehci_qhd_t *p_qhd);
 static void qtd_init (ehci_qtd_t* p_qtd, void const* buffer, uint16_t total_bytes);
 
+static bool qhd_queue_xfer(uint8_t rhport, ehci_qhd_t *p_qhd, uint8_t pid, uint8_t data_toggle, void const* buffer, uint16_t buflen);
+static void qhd_attach_qtd(ehci_qhd_t *p_qhd);
+static void qhd_remove_all_qtd(ehci_qhd_t *p_qhd);
+static void qhd_retire_done_qtd(ehci_qhd_t * p_qhd, bool in_isr);
+static void qhd_retire_all_qtd(ehci_qhd_t * p_qhd, xfer_result_t result, bool in_isr);
+
 static inline void list_insert (ehci_link_t *current, ehci_link_t *new, uint8_t new_type);
 static inline ehci_link_t* list_next (ehci_link_t *p_link_pointer);
 
@@ -187,9 +239,8 @@ tusb_speed_t hcd_port_speed_get(uint8_t rhport)
 
 static void list_remove_qhd_by_addr(ehci_link_t* list_head, uint8_t dev_addr)
 {
-  for(ehci_link_t* prev = list_head;
-      !prev->terminate && (tu_align32(prev->address) != (uint32_t) list_head) && prev != NULL;
-      prev = list_next(prev) )
+  ehci_link_t* prev = list_head;
+  while( !prev->terminate && (tu_align32(prev->address) != (uint32_t) list_head) && prev != NULL )
   {
     // TODO check type for ISO iTD and siTD
     // TODO Suppress cast-align warning
@@ -208,13 +259,20 @@ static void list_remove_qhd_by_addr(ehci_link_t* list_head, uint8_t dev_addr)
       if ( qhd->int_smask )
       {
         // period list queue element is guarantee to be free in the next frame (1 ms)
-        qhd->used = 0;
+        qhd_split_free(qhd);
+        qhd_remove_all_qtd(qhd);
+        qhd_free(qhd);
       }else
       {
         // async list use async advance handshake
         // mark as removing, will completely re-usable when async advance isr occurs
         qhd->removing = 1;
       }
+
+      // prev now links to removed qhd's next, which also need to be checked
+    }else
+    {
+      prev = list_next(prev);
     }
   }
 }
@@ -225,6 +283,9 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
   // skip dev0
   if (dev_addr == 0) return;
 
+  // pools are also modified by isr
+  hcd_int_disable(rhport);
+
   // Remove from async list
   list_remove_qhd_by_addr( (ehci_link_t*) qhd_async_head(rhport), dev_addr );
 
@@ -234,6 +295,8 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
     list_remove_qhd_by_addr( (ehci_link_t*) &ehci_data.period_head_arr[i], dev_addr);
   }
 
+  hcd_int_enable(rhport);
+
   // Async doorbell (EHCI 4.8.2 for operational details)
   ehci_data.regs->command_bm.async_adv_doorbell = 1;
 }
@@ -268,6 +331,19 @@ bool ehci_init(uint8_t rhport, uint32_t capability_reg, uint32_t operatial_reg)
 
   regs->async_list_addr = (uint32_t) async_head;
 
+  //------------- QHD & QTD pool free list -------------//
+  for(uint16_t i = 0; i < QHD_MAX; i++) ehci_data.qhd_pool[i].next_free = (uint16_t) (i+1);
+  ehci_data.qhd_pool[QHD_MAX-1].next_free = POOL_INDEX_NONE;
+  ehci_data.qhd_free_head = 0;
+
+  for(uint16_t i = 0; i < QTD_MAX; i++) ehci_data.qtd_info[i].next_free = (uint16_t) (i+1);
+  ehci_data.qtd_info[QTD_MAX-1].next_free = POOL_INDEX_NONE;
+  ehci_data.qtd_free_head = 0;
+
+  //------------- Short packet sentinel -------------//
+  ehci_data.qtd_short_sentinel.next.terminate      = 1;
+  ehci_data.qtd_short_sentinel.alternate.terminate = 1;
+
   //------------- Periodic List -------------//
   // Build the polling interval tree with 1 ms, 2 ms, 4 ms and 8 ms (framesize) only
   for ( uint32_t i = 0; i < TU_ARRAY_SIZE(ehci_data.period_head_arr); i++ )
@@ -341,24 +417,28 @@ static void ehci_stop(uint8_t rhport)
 
 bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
 {
-  (void) rhport;
-
   // TODO not support ISO yet
   TU_ASSERT (ep_desc->bmAttributes.xfer != TUSB_XFER_ISOCHRONOUS);
 
   //------------- Prepare Queue Head -------------//
   ehci_qhd_t * p_qhd;
 
+  // pools are also modified by isr
+  hcd_int_disable(rhport);
+
   if ( ep_desc->bEndpointAddress == 0 )
   {
     p_qhd = qhd_control(dev_addr);
   }else
   {
-    p_qhd = qhd_find_free();
+    p_qhd = qhd_alloc();
   }
-  TU_ASSERT(p_qhd);
 
-  qhd_init(p_qhd, dev_addr, ep_desc);
+  if ( p_qhd ) qhd_init(p_qhd, dev_addr, ep_desc);
+
+  hcd_int_enable(rhport);
+
+  TU_ASSERT(p_qhd);
 
   // control of dev0 is always present as async head
   if ( dev_addr == 0 ) return true;
@@ -394,78 +474,92 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
 
 bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet[8])
 {
-  (void) rhport;
+  ehci_qhd_t* qhd = qhd_control(dev_addr);
 
-  ehci_qhd_t* qhd = &ehci_data.control[dev_addr].qhd;
-  ehci_qtd_t* td  = &ehci_data.control[dev_addr].qtd;
+  // Setup always starts a new control transfer, drop any leftover of previous one
+  hcd_int_disable(rhport);
+  qhd_remove_all_qtd(qhd);
+  hcd_int_enable(rhport);
 
-  qtd_init(td, setup_packet, 8);
-  td->pid          = EHCI_PID_SETUP;
-  td->int_on_complete = 1;
-  td->next.terminate  = 1;
-
-  // sw region
-  qhd->p_qtd_list_head = td;
-  qhd->p_qtd_list_tail = td;
-
-  // attach TD
-  qhd->qtd_overlay.next.address = (uint32_t) td;
-
-  return true;
+  return qhd_queue_xfer(rhport, qhd, EHCI_PID_SETUP, 0, setup_packet, 8);
 }
 
 bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen)
 {
-  (void) rhport;
-
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   if ( epnum == 0 )
   {
-    ehci_qhd_t* qhd = qhd_control(dev_addr);
-    ehci_qtd_t* qtd = qtd_control(dev_addr);
-
-    qtd_init(qtd, buffer, buflen);
-
     // first first data toggle is always 1 (data & setup stage)
-    qtd->data_toggle = 1;
-    qtd->pid = dir ? EHCI_PID_IN : EHCI_PID_OUT;
-    qtd->int_on_complete = 1;
-    qtd->next.terminate  = 1;
-
-    // sw region
-    qhd->p_qtd_list_head = qtd;
-    qhd->p_qtd_list_tail = qtd;
-
-    // attach TD
-    qhd->qtd_overlay.next.address = (uint32_t) qtd;
+    return qhd_queue_xfer(rhport, qhd_control(dev_addr), dir ? EHCI_PID_IN : EHCI_PID_OUT, 1, buffer, buflen);
   }else
   {
     ehci_qhd_t *p_qhd = qhd_get_from_addr(dev_addr, ep_addr);
-    ehci_qtd_t *p_qtd = qtd_find_free();
-    TU_ASSERT(p_qtd);
+    TU_ASSERT(p_qhd);
 
-    qtd_init(p_qtd, buffer, buflen);
-    p_qtd->pid = p_qhd->pid;
+    // data toggle is tracked by queue head's overlay for non-control endpoint
+    return qhd_queue_xfer(rhport, p_qhd, p_qhd->pid, 0, buffer, buflen);
+  }
+}
 
-    // Insert TD to QH
-    qtd_insert_to_qhd(p_qhd, p_qtd);
+bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
+{
+  ehci_qhd_t *p_qhd = qhd_get_from_addr(dev_addr, ep_addr);
+  TU_ASSERT(p_qhd);
 
-    p_qhd->p_qtd_list_tail->int_on_complete = 1;
+  p_qhd->qtd_overlay.data_toggle = 0;
+  p_qhd->qtd_overlay.halted      = 0;
 
-    // attach head QTD to QHD start transferring
-    p_qhd->qtd_overlay.next.address = (uint32_t) p_qhd->p_qtd_list_head;
-  }
+  // resume with transfers queued after endpoint is halted (if any)
+  qhd_attach_qtd(p_qhd);
 
   return true;
 }
 
-bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
+bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr)
 {
-  ehci_qhd_t *p_qhd = qhd_get_from_addr(dev_addr, ep_addr);
-  p_qhd->qtd_overlay.halted = 0;
-  // TODO reset data toggle ?
+  ehci_qhd_t *p_qhd = tu_edpt_number(ep_addr) ? qhd_get_from_addr(dev_addr, ep_addr) : qhd_control(dev_addr);
+  TU_ASSERT(p_qhd);
+
+  ehci_registers_t* const regs = ehci_data.regs;
+  volatile ehci_qtd_t* overlay = &p_qhd->qtd_overlay;
+
+  hcd_int_disable(rhport);
+
+  // report transfers already retired by host controller (but not yet by isr) as they are
+  qhd_retire_done_qtd(p_qhd, false);
+
+  if ( p_qhd->p_qtd_list_head != NULL )
+  {
+    // Unlink remaining qTDs from host controller: deactivate them and the overlay so that host controller
+    // stops fetching them.
+    for(ehci_qtd_t* p_qtd = p_qhd->p_qtd_list_head; p_qtd != NULL;
+        p_qtd = (p_qtd == p_qhd->p_qtd_list_tail) ? NULL : qtd_next(p_qtd))
+    {
+      p_qtd->active = 0;
+    }
+
+    overlay->next.terminate      = 1;
+    overlay->alternate.terminate = 1;
+    overlay->active              = 0;
+
+    if ( regs->status_bm.hc_halted )
+    {
+      qhd_retire_all_qtd(p_qhd, XFER_RESULT_FAILED, false);
+    }else
+    {
+      // Transaction in progress (if any) is written back to overlay and qhd may still be cached by host
+      // controller. Aborted TDs are retired by async advance isr once it is safe (EHCI 4.8.2)
+      p_qhd->aborting           = 1;
+      ehci_data.abort_pending   = true;
+      ehci_data.abort_uframe    = regs->frame_index;
+      regs->command_bm.async_adv_doorbell = 1;
+    }
+  }
+
+  hcd_int_enable(rhport);
+
   return true;
 }
 
@@ -473,6 +567,16 @@ bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
 // EHCI Interrupt Handler
 //--------------------------------------------------------------------+
 
+// Complete transfers of qhd aborted by hcd_edpt_abort_xfer() now that host controller has released it
+static void qhd_retire_aborted(ehci_qhd_t* p_qhd)
+{
+  if ( !p_qhd->aborting ) return;
+
+  p_qhd->aborting = 0;
+  p_qhd->qtd_overlay.active = 0;
+  qhd_retire_all_qtd(p_qhd, XFER_RESULT_FAILED, true);
+}
+
 // async_advance is handshake between usb stack & ehci controller.
 // This isr mean it is safe to modify previously removed queue head from async list.
 // In tinyusb, queue head is only removed when device is unplugged.
@@ -485,8 +589,27 @@ static void async_advance_isr(uint8_t rhport)
   {
     if ( qhd_pool[i].removing )
     {
+      qhd_remove_all_qtd(&qhd_pool[i]);
       qhd_pool[i].removing = 0;
-      qhd_pool[i].used     = 0;
+      qhd_free(&qhd_pool[i]);
+    }
+  }
+
+  if ( ehci_data.abort_pending )
+  {
+    ehci_registers_t* const regs = ehci_data.regs;
+
+    if ( !regs->status_bm.hc_halted &&
+         ((regs->frame_index - ehci_data.abort_uframe) & EHCI_FRAME_INDEX_MASK) < EHCI_ABORT_PERIODIC_UFRAMES )
+    {
+      // periodic qhd may still be in use until the end of the frame, wait for another async advance
+      regs->command_bm.async_adv_doorbell = 1;
+    }else
+    {
+      ehci_data.abort_pending = false;
+
+      for(uint32_t i = 0; i < CTRL_QHD_MAX; i++) qhd_retire_aborted(&ehci_data.control[i].qhd);
+      for(uint32_t i = 0; i < QHD_MAX; i++) qhd_retire_aborted(&qhd_pool[i]);
     }
   }
 }
@@ -504,27 +627,76 @@ static void port_connect_status_change_isr(uint8_t rhport)
   }
 }
 
-static void qhd_xfer_complete_isr(ehci_qhd_t * p_qhd)
+// Retire all TDs from the head td to the first active TD, completion is reported for each transfer
+static void qhd_retire_done_qtd(ehci_qhd_t * p_qhd, bool in_isr)
 {
-  // free all TDs from the head td to the first active TD
   while(p_qhd->p_qtd_list_head != NULL && !p_qhd->p_qtd_list_head->active)
   {
     ehci_qtd_t * volatile qtd = (ehci_qtd_t * volatile) p_qhd->p_qtd_list_head;
-    bool const is_ioc = (qtd->int_on_complete != 0);
+    bool is_ioc = (qtd->int_on_complete != 0);
+    bool const is_short = (qtd->total_bytes != 0);
     uint8_t const ep_addr = tu_edpt_addr(p_qhd->ep_number, qtd->pid == EHCI_PID_IN ? 1 : 0);
 
-    p_qhd->total_xferred_bytes += qtd->expected_bytes - qtd->total_bytes;
+    p_qhd->total_xferred_bytes += qtd_xferred_bytes(qtd);
 
     // TD need to be freed and removed from qhd, before invoking callback
-    qtd->used = 0; // free QTD
+    qtd_free(qtd);
+    qtd_remove_1st_from_qhd(p_qhd);
+
+    if ( is_short && !is_ioc )
+    {
+      // Short packet ends this transfer early: host controller is parked at the short packet sentinel.
+      // Remaining qTDs of this transfer are never executed, retire them up to the one with IOC
+      while ( p_qhd->p_qtd_list_head != NULL && !is_ioc )
+      {
+        is_ioc = (p_qhd->p_qtd_list_head->int_on_complete != 0);
+        qtd_free(p_qhd->p_qtd_list_head);
+        qtd_remove_1st_from_qhd(p_qhd);
+      }
+    }
+
+    if (is_ioc)
+    {
+      hcd_event_xfer_complete(p_qhd->dev_addr, ep_addr, p_qhd->total_xferred_bytes, XFER_RESULT_SUCCESS, in_isr);
+      p_qhd->total_xferred_bytes = 0;
+    }
+  }
+}
+
+// Retire all TDs of qhd regardless of their status, each transfer is reported with result
+static void qhd_retire_all_qtd(ehci_qhd_t * p_qhd, xfer_result_t result, bool in_isr)
+{
+  while ( p_qhd->p_qtd_list_head != NULL )
+  {
+    ehci_qtd_t * volatile qtd = (ehci_qtd_t * volatile) p_qhd->p_qtd_list_head;
+    bool const is_ioc = (qtd->int_on_complete != 0);
+    uint8_t const ep_addr = tu_edpt_addr(p_qhd->ep_number, qtd->pid == EHCI_PID_IN ? 1 : 0);
+
+    p_qhd->total_xferred_bytes += qtd_xferred_bytes(qtd);
+
+    qtd_free(qtd);
     qtd_remove_1st_from_qhd(p_qhd);
 
     if (is_ioc)
     {
-      hcd_event_xfer_complete(p_qhd->dev_addr, ep_addr, p_qhd->total_xferred_bytes, XFER_RESULT_SUCCESS, true);
+      // call USBH callback
+      hcd_event_xfer_complete(p_qhd->dev_addr, ep_addr, p_qhd->total_xferred_bytes, result, in_isr);
       p_qhd->total_xferred_bytes = 0;
     }
   }
+
+  p_qhd->total_xferred_bytes = 0;
+}
+
+static void qhd_xfer_complete_isr(ehci_qhd_t * p_qhd)
+{
+  // deactivated TDs of aborted transfers are not completed, they are retired by async advance isr
+  if ( p_qhd->aborting ) return;
+
+  qhd_retire_done_qtd(p_qhd, true);
+
+  // kick off transfers queued while host controller already ran out of qTDs
+  qhd_attach_qtd(p_qhd);
 }
 
 static void async_list_xfer_complete_isr(ehci_qhd_t * const async_head)
@@ -577,6 +749,8 @@ static void period_list_xfer_complete_isr(uint8_t hostid, uint32_t interval_ms)
 
 static void qhd_xfer_error_isr(ehci_qhd_t * p_qhd)
 {
+  if ( p_qhd->aborting ) return;
+
   if ( (p_qhd->dev_addr != 0 && p_qhd->qtd_overlay.halted) || // addr0 cannot be protocol STALL
         qhd_has_xact_error(p_qhd) )
   {
@@ -586,31 +760,18 @@ static void qhd_xfer_error_isr(ehci_qhd_t * p_qhd)
     // no error bits are set, endpoint is halted due to STALL
     error_event = qhd_has_xact_error(p_qhd) ? XFER_RESULT_FAILED : XFER_RESULT_STALLED;
 
-    p_qhd->total_xferred_bytes += p_qhd->p_qtd_list_head->expected_bytes - p_qhd->p_qtd_list_head->total_bytes;
-
 //    if ( XFER_RESULT_FAILED == error_event )    TU_BREAKPOINT(); // TODO skip unplugged device
 
-    p_qhd->p_qtd_list_head->used = 0; // free QTD
-    qtd_remove_1st_from_qhd(p_qhd);
+    // Halted queue head won't process any further qTD: fail all queued transfers
+    qhd_retire_all_qtd(p_qhd, error_event, true);
 
     if ( 0 == p_qhd->ep_number )
     {
-      // control cannot be halted --> clear all qtd list
-      p_qhd->p_qtd_list_head = NULL;
-      p_qhd->p_qtd_list_tail = NULL;
-
+      // control cannot be halted
       p_qhd->qtd_overlay.next.terminate      = 1;
       p_qhd->qtd_overlay.alternate.terminate = 1;
       p_qhd->qtd_overlay.halted              = 0;
-
-      ehci_qtd_t *p_setup = qtd_control(p_qhd->dev_addr);
-      p_setup->used = 0;
     }
-
-    // call USBH callback
-    hcd_event_xfer_complete(p_qhd->dev_addr, tu_edpt_addr(p_qhd->ep_number, p_qhd->pid == EHCI_PID_IN ? 1 : 0), p_qhd->total_xferred_bytes, error_event, true);
-
-    p_qhd->total_xferred_bytes = 0;
   }
 }
 
@@ -738,14 +899,20 @@ void hcd_int_handler(uint8_t rhport)
 
 
 //------------- queue head helper -------------//
-static inline ehci_qhd_t* qhd_find_free (void)
+static inline ehci_qhd_t* qhd_alloc (void)
 {
-  for (uint32_t i=0; i<QHD_MAX; i++)
-  {
-    if ( !ehci_data.qhd_pool[i].used ) return &ehci_data.qhd_pool[i];
-  }
+  uint16_t const idx = ehci_data.qhd_free_head;
+  if ( idx == POOL_INDEX_NONE ) return NULL;
 
-  return NULL;
+  ehci_data.qhd_free_head = ehci_data.qhd_pool[idx].next_free;
+  return &ehci_data.qhd_pool[idx];
+}
+
+static inline void qhd_free (ehci_qhd_t* p_qhd)
+{
+  p_qhd->used      = 0;
+  p_qhd->next_free = ehci_data.qhd_free_head;
+  ehci_data.qhd_free_head = (uint16_t) (p_qhd - ehci_data.qhd_pool);
 }
 
 static inline ehci_qhd_t* qhd_next(ehci_qhd_t const * p_qhd)
@@ -759,7 +926,7 @@ static inline ehci_qhd_t* qhd_get_from_addr(uint8_t dev_addr, uint8_t ep_addr)
 
   for(uint32_t i=0; i<QHD_MAX; i++)
   {
-    if ( (qhd_pool[i].dev_addr == dev_addr) &&
+    if ( qhd_pool[i].used && (qhd_pool[i].dev_addr == dev_addr) &&
           ep_addr == tu_edpt_addr(qhd_pool[i].ep_number, qhd_pool[i].pid) )
     {
       return &qhd_pool[i];
@@ -770,14 +937,31 @@ static inline ehci_qhd_t* qhd_get_from_addr(uint8_t dev_addr, uint8_t ep_addr)
 }
 
 //------------- TD helper -------------//
-static inline ehci_qtd_t* qtd_find_free(void)
+static inline uint32_t qtd_index(ehci_qtd_t const * p_qtd)
 {
-  for (uint32_t i=0; i<QTD_MAX; i++)
-  {
-    if ( !ehci_data.qtd_pool[i].used ) return &ehci_data.qtd_pool[i];
-  }
+  return (uint32_t) (p_qtd - ehci_data.qtd_pool);
+}
 
-  return NULL;
+static inline ehci_qtd_t* qtd_alloc(void)
+{
+  uint16_t const idx = ehci_data.qtd_free_head;
+  if ( idx == POOL_INDEX_NONE ) return NULL;
+
+  ehci_data.qtd_free_head = ehci_data.qtd_info[idx].next_free;
+  return &ehci_data.qtd_pool[idx];
+}
+
+static inline void qtd_free(ehci_qtd_t* p_qtd)
+{
+  uint16_t const idx = (uint16_t) qtd_index(p_qtd);
+
+  ehci_data.qtd_info[idx].next_free = ehci_data.qtd_free_head;
+  ehci_data.qtd_free_head = idx;
+}
+
+static inline uint16_t qtd_xferred_bytes(ehci_qtd_t const* p_qtd)
+{
+  return (uint16_t) (ehci_data.qtd_info[qtd_index(p_qtd)].expected_bytes - p_qtd->total_bytes);
 }
 
 static inline ehci_qtd_t* qtd_next(ehci_qtd_t const * p_qtd )
@@ -785,6 +969,12 @@ static inline ehci_qtd_t* qtd_next(ehci_qtd_t const * p_qtd )
   return (ehci_qtd_t*) tu_align32(p_qtd->next.address);
 }
 
+// Max bytes a qTD can transfer: 5 pages of 4 KB minus the offset of buffer in the first page
+static inline uint32_t qtd_max_bytes(uint32_t buffer)
+{
+  return 5*4096 - tu_offset4k(buffer);
+}
+
 static inline void qtd_remove_1st_from_qhd(ehci_qhd_t *p_qhd)
 {
   if (p_qhd->p_qtd_list_head == p_qhd->p_qtd_list_tail) // last TD --> make it NULL
@@ -796,20 +986,170 @@ static inline void qtd_remove_1st_from_qhd(ehci_qhd_t *p_qhd)
   }
 }
 
-static inline void qtd_insert_to_qhd(ehci_qhd_t *p_qhd, ehci_qtd_t *p_qtd_new)
+// insert a chain of TDs (already linked from first to last) to the end of qhd list
+static inline void qtd_insert_to_qhd(ehci_qhd_t *p_qhd, ehci_qtd_t *p_qtd_first, ehci_qtd_t *p_qtd_last)
 {
   if (p_qhd->p_qtd_list_head == NULL) // empty list
   {
-    p_qhd->p_qtd_list_head               = p_qhd->p_qtd_list_tail = p_qtd_new;
+    p_qhd->p_qtd_list_head               = p_qtd_first;
   }else
   {
-    p_qhd->p_qtd_list_tail->next.address = (uint32_t) p_qtd_new;
-    p_qhd->p_qtd_list_tail               = p_qtd_new;
+    p_qhd->p_qtd_list_tail->next.address = (uint32_t) p_qtd_first;
+  }
+
+  p_qhd->p_qtd_list_tail = p_qtd_last;
+}
+
+// Free all TDs of a qhd without notifying usbh, used when qhd is removed or a new control transfer starts
+static void qhd_remove_all_qtd(ehci_qhd_t *p_qhd)
+{
+  while ( p_qhd->p_qtd_list_head != NULL )
+  {
+    qtd_free(p_qhd->p_qtd_list_head);
+    qtd_remove_1st_from_qhd(p_qhd);
+  }
+
+  p_qhd->total_xferred_bytes = 0;
+}
+
+// Attach first active TD to qhd if host controller has run out of work on this qhd i.e overlay is inactive
+// and has reached the end of list (or parked at short packet sentinel). Otherwise host controller follows
+// the TD links on its own.
+static void qhd_attach_qtd(ehci_qhd_t *p_qhd)
+{
+  volatile ehci_qtd_t* overlay = &p_qhd->qtd_overlay;
+  if ( overlay->active || overlay->halted || p_qhd->aborting ) return;
+
+  ehci_qtd_t* p_qtd = p_qhd->p_qtd_list_head;
+  while ( p_qtd != NULL && !p_qtd->active )
+  {
+    p_qtd = (p_qtd == p_qhd->p_qtd_list_tail) ? NULL : qtd_next(p_qtd);
+  }
+
+  if ( p_qtd == NULL ) return;
+
+  overlay->alternate.terminate = 1;
+  overlay->next.address        = (uint32_t) p_qtd;
+}
+
+// Split a transfer into a chain of TDs and queue it to qhd. All but the last TD end on a max packet size
+// boundary, only the last TD has IOC set so that a single completion event is generated for the transfer.
+static bool qhd_queue_xfer(uint8_t rhport, ehci_qhd_t *p_qhd, uint8_t pid, uint8_t data_toggle, void const* buffer, uint16_t buflen)
+{
+  uint16_t const mps = p_qhd->max_packet_size;
+  ehci_qtd_t* qtd_first = NULL;
+  ehci_qtd_t* qtd_last  = NULL;
+  uint8_t const* p_buf  = (uint8_t const*) buffer;
+  uint32_t remaining    = buflen;
+
+  // TD pool and qhd's TD list are also modified by isr
+  hcd_int_disable(rhport);
+
+  do
+  {
+    ehci_qtd_t* p_qtd = qtd_alloc();
+    if ( p_qtd == NULL )
+    {
+      // out of TD, release partially built chain
+      for(ehci_qtd_t* p = qtd_first; p != NULL; p = (p == qtd_last) ? NULL : qtd_next(p)) qtd_free(p);
+      hcd_int_enable(rhport);
+
+      TU_LOG2("EHCI: run out of qTD\r\n");
+      return false;
+    }
+
+    uint32_t xact_len = remaining;
+    uint32_t const max_len = qtd_max_bytes((uint32_t) p_buf);
+    if ( xact_len > max_len ) xact_len = max_len - (max_len % mps);
+
+    qtd_init(p_qtd, p_buf, (uint16_t) xact_len);
+    p_qtd->pid         = pid;
+    p_qtd->data_toggle = data_toggle;
+
+    // next TD toggle, only matters for control endpoint which uses qTD's data toggle
+    if ( tu_div_ceil(xact_len, mps) & 1 ) data_toggle ^= 1;
+
+    if ( qtd_first == NULL )
+    {
+      qtd_first = p_qtd;
+    }else
+    {
+      // a short packet of IN transfer ends the whole transfer, park host controller at sentinel
+      if ( pid == EHCI_PID_IN ) qtd_last->alternate.address = (uint32_t) &ehci_data.qtd_short_sentinel;
+      qtd_last->next.address = (uint32_t) p_qtd;
+    }
+    qtd_last = p_qtd;
+
+    p_buf     += xact_len;
+    remaining -= xact_len;
+  } while ( remaining > 0 );
+
+  qtd_last->int_on_complete = 1;
+
+  qtd_insert_to_qhd(p_qhd, qtd_first, qtd_last);
+  qhd_attach_qtd(p_qhd);
+  hcd_int_enable(rhport);
+
+  return true;
+}
+
+//------------- split transaction helper -------------//
+
+// Get Transaction Translator (TT) that serves a full/low speed device: it is the nearest
+// high speed hub upstream. If there is none, the TT is embedded in the root port and hub address is 0.
+static void tt_get_info(hcd_devtree_info_t const* devtree_info, uint8_t* tt_addr, uint8_t* tt_port)
+{
+  uint8_t hub_addr = devtree_info->hub_addr;
+  uint8_t hub_port = devtree_info->hub_port;
+
+  // USB allows at most 5 tiers of hubs
+  for(uint8_t tier = 0; (hub_addr != 0) && (tier < 5); tier++)
+  {
+    hcd_devtree_info_t hub_info;
+    hcd_devtree_get_info(hub_addr, &hub_info);
+
+    if ( hub_info.speed == TUSB_SPEED_HIGH ) break;
+
+    // full speed hub, keep looking upstream
+    hub_addr = hub_info.hub_addr;
+    hub_port = hub_info.hub_port;
+  }
+
+  *tt_addr = hub_addr;
+  *tt_port = (hub_addr != 0) ? hub_port : 0;
+}
+
+// Allocate a start-split uframe for a full/low speed interrupt endpoint.
+// Start-splits are spread over the least loaded uframe to balance TT periodic traffic.
+static uint8_t split_start_alloc(void)
+{
+  uint8_t uframe = 0;
+  for(uint8_t i = 1; i < SPLIT_START_UFRAME_MAX; i++)
+  {
+    if ( ehci_data.split_start_count[i] < ehci_data.split_start_count[uframe] ) uframe = i;
+  }
+
+  ehci_data.split_start_count[uframe]++;
+  return uframe;
+}
+
+// Release start-split uframe of a full/low speed interrupt endpoint, no-op for high speed
+static void qhd_split_free(ehci_qhd_t *p_qhd)
+{
+  if ( p_qhd->ep_speed == TUSB_SPEED_HIGH || p_qhd->int_smask == 0 ) return;
+
+  uint8_t const uframe = tu_log2(p_qhd->int_smask);
+  if ( uframe < SPLIT_START_UFRAME_MAX && ehci_data.split_start_count[uframe] )
+  {
+    ehci_data.split_start_count[uframe]--;
   }
 }
 
 static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
 {
+  // release TDs left over from previous usage
+  qhd_remove_all_qtd(p_qhd);
+
   // address 0 is used as async head, which always on the list --> cannot be cleared (ehci halted otherwise)
   if (dev_addr != 0)
   {
@@ -852,9 +1192,10 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
     }else
     {
       TU_ASSERT( 0 != interval, );
-      // Full/Low: 4.12.2.1 (EHCI) case 1 schedule start split at 1 us & complete split at 2,3,4 uframes
-      p_qhd->int_smask    = 0x01;
-      p_qhd->fl_int_cmask = TU_BIN8(11100);
+      // Full/Low: 4.12.2.1 (EHCI) case 1 schedule start split at uframe Y & complete split at Y+2, Y+3, Y+4
+      uint8_t const ss_uframe = split_start_alloc();
+      p_qhd->int_smask    = (uint8_t) TU_BIT(ss_uframe);
+      p_qhd->fl_int_cmask = (uint8_t) (TU_BIN8(111) << (ss_uframe + 2));
       p_qhd->interval_ms  = interval;
     }
   }else
@@ -862,13 +1203,25 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
     p_qhd->int_smask = p_qhd->fl_int_cmask = 0;
   }
 
-  p_qhd->fl_hub_addr     = devtree_info.hub_addr;
-  p_qhd->fl_hub_port     = devtree_info.hub_port;
+  // Hub address & port of the Transaction Translator are only used for full/low speed split transaction
+  if (TUSB_SPEED_HIGH != p_qhd->ep_speed)
+  {
+    uint8_t tt_addr, tt_port;
+    tt_get_info(&devtree_info, &tt_addr, &tt_port);
+
+    p_qhd->fl_hub_addr = tt_addr;
+    p_qhd->fl_hub_port = tt_port;
+  }else
+  {
+    p_qhd->fl_hub_addr = p_qhd->fl_hub_port = 0;
+  }
+
   p_qhd->mult            = 1; // TODO not use high bandwidth/park mode yet
 
   //------------- HCD Management Data -------------//
   p_qhd->used            = 1;
   p_qhd->removing        = 0;
+  p_qhd->aborting        = 0;
   p_qhd->p_qtd_list_head = NULL;
   p_qhd->p_qtd_list_tail = NULL;
   p_qhd->pid = tu_edpt_dir(ep_desc->bEndpointAddress) ? EHCI_PID_IN : EHCI_PID_OUT; // PID for TD under this endpoint
@@ -887,15 +1240,14 @@ static void qtd_init(ehci_qtd_t* p_qtd, void const* buffer, uint16_t total_bytes
 {
   tu_memclr(p_qtd, sizeof(ehci_qtd_t));
 
-  p_qtd->used                = 1;
+  ehci_data.qtd_info[qtd_index(p_qtd)].expected_bytes = total_bytes;
 
   p_qtd->next.terminate      = 1; // init to null
-  p_qtd->alternate.terminate = 1; // not used, always set to terminated
+  p_qtd->alternate.terminate = 1; // only used by multiple-qTD IN transfer
   p_qtd->active              = 1;
   p_qtd->err_count           = 3; // TODO 3 consecutive errors tolerance
   p_qtd->data_toggle         = 0;
   p_qtd->total_bytes         = total_bytes;
-  p_qtd->expected_bytes      = total_bytes;
 
   p_qtd->buffer[0] = (uint32_t) buffer;
   for(uint8_t i=1; i<5; i++)
@@ -88,16 +88,8 @@ typedef struct
 	// Word 0: Next QTD Pointer
 	ehci_link_t next;
 
-	// Word 1: Alternate Next QTD Pointer (not used)
-	union{
-	  ehci_link_t alternate;
-	  struct {
-	    uint32_t                : 5;
-	    uint32_t used           : 1;
-	    uint32_t                : 10;
-	    uint32_t expected_bytes : 16;
-	  };
-	};
+	// Word 1: Alternate Next QTD Pointer, used to stop a multiple-qTD IN transfer on short packet
+	ehci_link_t alternate;
 
 	// Word 2: qTQ Token
 	volatile uint32_t ping_err             : 1  ; ///< For Highspeed: 0 Out, 1 Ping. Full/Slow used as error indicator
@@ -158,12 +150,14 @@ typedef struct TU_ATTR_ALIGNED(32)
 	/// thus there are 16 bytes padding free that we can make use of.
   //--------------------------------------------------------------------+
 	uint8_t used;
-	uint8_t removing; // removed from asyn list, waiting for async advance
+	uint8_t removing : 1; // removed from asyn list, waiting for async advance
+	uint8_t aborting : 1; // transfers aborted, retired once host controller has released the qhd
+	uint8_t          : 6;
 	uint8_t pid;
 	uint8_t interval_ms; // polling interval in frames (or millisecond)
 
 	uint16_t total_xferred_bytes; // number of bytes xferred until a qtd with ioc bit set
-	uint8_t reserved2[2];
+	uint16_t next_free; // index of next free qhd in pool while not in use
 
 	ehci_qtd_t * volatile p_qtd_list_head;	// head of the scheduled TD list
 	ehci_qtd_t * volatile p_qtd_list_tail;	// tail of the scheduled TD list
@@ -143,6 +143,20 @@ enum {
 //--------------------------------------------------------------------+
 CFG_TUSB_MEM_SECTION TU_ATTR_ALIGNED(256) static ohci_data_t ohci_data;
 
+// end of ED free list
+#define ED_INDEX_NONE   0xFFu
+
+TU_VERIFY_STATIC(ED_MAX < ED_INDEX_NONE, "ED pool is too large");
+
+// Free lists of ed_pool and gtd_pool for O(1) allocation. Free TDs are linked by their next pointer
+// (HC no longer accesses a TD once retired to done queue), EDs are linked by index since all ED words
+// are read by HC. Also modified in isr, access from task context must disable interrupt.
+static struct {
+  ohci_gtd_t* gtd_head;
+  uint8_t ed_head;
+  uint8_t ed_next[ED_MAX];
+}_free_list;
+
 static ohci_ed_t * const p_ed_head[] =
 {
     [TUSB_XFER_CONTROL]     = &ohci_data.control[0].ed,
@@ -153,6 +167,9 @@ static ohci_ed_t * const p_ed_head[] =
 
 static void ed_list_insert(ohci_ed_t * p_pre, ohci_ed_t * p_ed);
 static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr);
+static uint8_t ed_remove_all_td(ohci_ed_t* p_ed);
+static void gtd_free(ohci_gtd_t * p_gtd);
+static void done_queue_isr(uint8_t hostid, bool in_isr);
 
 //--------------------------------------------------------------------+
 // USBH-HCD API
@@ -173,6 +190,18 @@ bool hcd_init(uint8_t rhport)
   ohci_data.bulk_head_ed.skip   = 1;
   ohci_data.period_head_ed.skip = 1;
 
+  // all EDs & TDs in pool are free
+  for(uint8_t i=0; i<ED_MAX; i++) _free_list.ed_next[i] = (uint8_t) (i+1);
+  _free_list.ed_next[ED_MAX-1] = ED_INDEX_NONE;
+  _free_list.ed_head = 0;
+
+  _free_list.gtd_head = NULL;
+  for(uint32_t i=GTD_MAX; i>0; i--)
+  {
+    ohci_data.gtd_pool[i-1].next = (uint32_t) _free_list.gtd_head;
+    _free_list.gtd_head = &ohci_data.gtd_pool[i-1];
+  }
+
   // reset controller
   OHCI_REG->command_status_bit.controller_reset = 1;
   while( OHCI_REG->command_status_bit.controller_reset ) {} // should not take longer than 10 us
@@ -237,15 +266,15 @@ tusb_speed_t hcd_port_speed_get(uint8_t hostid)
 // thus there is no need to make sure ED is not in HC's cahed as it will not for sure
 void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
 {
-  // TODO OHCI
-  (void) rhport;
-
   // addr0 serves as static head --> only set skip bit
   if ( dev_addr == 0 )
   {
     ohci_data.control[0].ed.skip = 1;
   }else
   {
+    // ED free list is also modified by isr
+    hcd_int_disable(rhport);
+
     // remove control
     ed_list_remove_by_addr( p_ed_head[TUSB_XFER_CONTROL], dev_addr);
 
@@ -256,6 +285,8 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
     ed_list_remove_by_addr(p_ed_head[TUSB_XFER_INTERRUPT], dev_addr);
 
     // TODO remove ISO
+
+    hcd_int_enable(rhport);
   }
 }
 
@@ -320,7 +351,7 @@ static ohci_ed_t * ed_from_addr(uint8_t dev_addr, uint8_t ep_addr)
 
   for(uint32_t i=0; i<ED_MAX; i++)
   {
-    if ( (ed_pool[i].dev_addr == dev_addr) &&
+    if ( ed_pool[i].used && (ed_pool[i].dev_addr == dev_addr) &&
           ep_addr == tu_edpt_addr(ed_pool[i].ep_number, ed_pool[i].pid == PID_IN) )
     {
       return &ed_pool[i];
@@ -330,16 +361,27 @@ static ohci_ed_t * ed_from_addr(uint8_t dev_addr, uint8_t ep_addr)
   return NULL;
 }
 
-static ohci_ed_t * ed_find_free(void)
+static inline bool ed_is_pool(ohci_ed_t const * p_ed)
 {
-  ohci_ed_t* ed_pool = ohci_data.ed_pool;
+  return (p_ed >= ohci_data.ed_pool) && (p_ed < ohci_data.ed_pool + ED_MAX);
+}
 
-  for(uint8_t i = 0; i < ED_MAX; i++)
-  {
-    if ( !ed_pool[i].used ) return &ed_pool[i];
-  }
+static ohci_ed_t * ed_alloc(void)
+{
+  uint8_t const idx = _free_list.ed_head;
+  if ( idx == ED_INDEX_NONE ) return NULL;
 
-  return NULL;
+  _free_list.ed_head = _free_list.ed_next[idx];
+  return &ohci_data.ed_pool[idx];
+}
+
+static void ed_free(ohci_ed_t * p_ed)
+{
+  uint8_t const idx = (uint8_t) (p_ed - ohci_data.ed_pool);
+
+  p_ed->used = 0;
+  _free_list.ed_next[idx] = _free_list.ed_head;
+  _free_list.ed_head = idx;
 }
 
 static void ed_list_insert(ohci_ed_t * p_pre, ohci_ed_t * p_ed)
@@ -363,7 +405,17 @@ static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr)
 
       // point the removed ED's next pointer to list head to make sure HC can always safely move away from this ED
       ed->next = (uint32_t) p_head;
-      ed->used = 0;
+
+      // control ED is reserved per device address, only pool ED and its TDs go back to free list
+      if ( ed_is_pool(ed) )
+      {
+        (void) ed_remove_all_td(ed);
+        gtd_free((ohci_gtd_t*) tu_align16(ed->td_tail));
+        ed_free(ed);
+      }else
+      {
+        ed->used = 0;
+      }
     }
 
     // check next valid since we could remove it
@@ -371,27 +423,64 @@ static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr)
   }
 }
 
-static ohci_gtd_t * gtd_find_free(void)
+static ohci_gtd_t * gtd_alloc(void)
 {
-  for(uint8_t i=0; i < GTD_MAX; i++)
-  {
-    if ( !ohci_data.gtd_pool[i].used ) return &ohci_data.gtd_pool[i];
-  }
+  ohci_gtd_t* p_gtd = _free_list.gtd_head;
+  if ( p_gtd ) _free_list.gtd_head = (ohci_gtd_t*) p_gtd->next;
 
-  return NULL;
+  return p_gtd;
 }
 
-static void td_insert_to_ed(ohci_ed_t* p_ed, ohci_gtd_t * p_gtd)
+static void gtd_free(ohci_gtd_t * p_gtd)
 {
-  // tail is always NULL
-  if ( tu_align16(p_ed->td_head.address) == 0 )
-  { // TD queue is empty --> head = TD
-    p_ed->td_head.address |= (uint32_t) p_gtd;
-  }
-  else
-  { // TODO currently only support queue up to 2 TD each endpoint at a time
-    ((ohci_gtd_t*) tu_align16(p_ed->td_head.address))->next = (uint32_t) p_gtd;
+  p_gtd->used = 0;
+  p_gtd->next = (uint32_t) _free_list.gtd_head;
+  _free_list.gtd_head = p_gtd;
+}
+
+// Pool ED always ends with an empty TD pointed by TailP, which HC never processes. A transfer is
+// filled into this TD and a new empty one is appended behind it, then TailP is advanced to hand the
+// transfer over: HC never sees a partially linked list even while processing the ED.
+// Control ED has its reserved TD and NULL tail instead, since control transfer is never queued.
+static void ed_init_tail(ohci_ed_t* p_ed, ohci_gtd_t* p_tail)
+{
+  gtd_init(p_tail, NULL, 0);
+  p_tail->index = (uint8_t) (p_ed - ohci_data.ed_pool);
+
+  p_ed->td_head.address = (uint32_t) p_tail;
+  p_ed->td_tail         = (uint32_t) p_tail;
+}
+
+static void td_insert_to_ed(ohci_ed_t* p_ed, ohci_gtd_t* p_new_tail)
+{
+  ohci_gtd_t* p_gtd = (ohci_gtd_t*) tu_align16(p_ed->td_tail);
+
+  gtd_init(p_new_tail, NULL, 0);
+  p_new_tail->index = p_gtd->index;
+
+  p_gtd->next   = (uint32_t) p_new_tail;
+  p_ed->td_tail = (uint32_t) p_new_tail;
+}
+
+// Release all TDs of a pool ED including its tail, transfers are dropped. Return number of dropped transfers
+static uint8_t ed_remove_all_td(ohci_ed_t* p_ed)
+{
+  ohci_gtd_t* p_gtd        = (ohci_gtd_t*) tu_align16(p_ed->td_head.address);
+  ohci_gtd_t* const p_tail = (ohci_gtd_t*) tu_align16(p_ed->td_tail);
+  uint8_t count = 0;
+
+  while ( p_gtd && p_gtd != p_tail )
+  {
+    ohci_gtd_t* next = (ohci_gtd_t*) p_gtd->next;
+    gtd_free(p_gtd);
+    p_gtd = next;
+    count++;
   }
+
+  // HeadP = TailP: empty list, halted and toggle bits are kept
+  p_ed->td_head.address = (p_ed->td_head.address & 0x0Ful) | (uint32_t) p_tail;
+
+  return count;
 }
 
 //--------------------------------------------------------------------+
@@ -400,26 +489,36 @@ static void td_insert_to_ed(ohci_ed_t* p_ed, ohci_gtd_t * p_gtd)
 
 bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
 {
-  (void) rhport;
-
   // TODO iso support
   TU_ASSERT(ep_desc->bmAttributes.xfer != TUSB_XFER_ISOCHRONOUS);
 
   //------------- Prepare Queue Head -------------//
   ohci_ed_t * p_ed;
+  ohci_gtd_t * p_tail = NULL;
 
   if ( ep_desc->bEndpointAddress == 0 )
   {
     p_ed = &ohci_data.control[dev_addr].ed;
   }else
   {
-    p_ed = ed_find_free();
+    // ED & TD free lists are also modified by isr
+    hcd_int_disable(rhport);
+    p_ed = ed_alloc();
+    p_tail = p_ed ? gtd_alloc() : NULL;
+    if ( p_ed && !p_tail )
+    {
+      ed_free(p_ed);
+      p_ed = NULL;
+    }
+    hcd_int_enable(rhport);
   }
   TU_ASSERT(p_ed);
 
   ed_init( p_ed, dev_addr, tu_edpt_packet_size(ep_desc), ep_desc->bEndpointAddress,
             ep_desc->bmAttributes.xfer, ep_desc->bInterval );
 
+  if ( p_tail ) ed_init_tail(p_ed, p_tail);
+
   // control of dev0 is used as static async head
   if ( dev_addr == 0 )
   {
@@ -455,8 +554,6 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
 
 bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen)
 {
-  (void) rhport;
-
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
@@ -478,15 +575,27 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   }else
   {
     ohci_ed_t * ed = ed_from_addr(dev_addr, ep_addr);
-    ohci_gtd_t* gtd = gtd_find_free();
+    TU_ASSERT(ed);
 
-    TU_ASSERT(gtd);
+    // TD free list and TD list of halted ED are also modified by isr
+    hcd_int_disable(rhport);
 
-    gtd_init(gtd, buffer, buflen);
-    gtd->index = ed-ohci_data.ed_pool;
-    gtd->delay_interrupt = 0;
+    ohci_gtd_t* new_tail = gtd_alloc();
+    if ( new_tail )
+    {
+      // transfer is filled into current tail TD, queued behind any pending transfer
+      ohci_gtd_t* gtd = (ohci_gtd_t*) tu_align16(ed->td_tail);
 
-    td_insert_to_ed(ed, gtd);
+      gtd_init(gtd, buffer, buflen);
+      gtd->index = (uint8_t) (ed-ohci_data.ed_pool);
+      gtd->delay_interrupt = 0;
+
+      td_insert_to_ed(ed, new_tail);
+    }
+
+    hcd_int_enable(rhport);
+
+    TU_ASSERT(new_tail);
 
     tusb_xfer_type_t xfer_type = ed_get_xfer_type( ed_from_addr(dev_addr, ep_addr) );
     if (TUSB_XFER_BULK == xfer_type) OHCI_REG->command_status_bit.bulk_list_filled = 1;
@@ -500,7 +609,9 @@ bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
   ohci_ed_t * const p_ed = ed_from_addr(dev_addr, ep_addr);
 
   p_ed->is_stalled = 0;
-  p_ed->td_tail    &= 0x0Ful; // set tail pointer back to NULL
+
+  // control ED: set tail pointer back to NULL, see done_queue_isr()
+  if ( !ed_is_pool(p_ed) ) p_ed->td_tail &= 0x0Ful;
 
   p_ed->td_head.toggle = 0; // reset data toggle
   p_ed->td_head.halted = 0;
@@ -510,6 +621,81 @@ bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
   return true;
 }
 
+bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr)
+{
+  ohci_ed_t * const p_ed = ed_from_addr(dev_addr, ep_addr);
+  TU_ASSERT(p_ed);
+
+  hcd_int_disable(rhport);
+
+  // 5.2.7.1.2 Removing TDs: set sKip and wait for next frame so that HC no longer processes this ED.
+  // Wait one more frame for TDs retired in the meantime to be written back to the done queue,
+  // TDs are then removed by SOF interrupt.
+  if ( !p_ed->aborting )
+  {
+    p_ed->abort_skip = p_ed->skip;
+    p_ed->skip       = 1;
+    p_ed->aborting   = 1;
+  }
+
+  ohci_data.abort_pending = true;
+  ohci_data.abort_frame   = (uint16_t) OHCI_REG->frame_number;
+
+  OHCI_REG->interrupt_status = OHCI_INT_SOF_MASK; // clear stale SOF
+  OHCI_REG->interrupt_enable = OHCI_INT_SOF_MASK;
+
+  hcd_int_enable(rhport);
+
+  return true;
+}
+
+// Remove TDs of ED aborted by hcd_edpt_abort_xfer() and complete them as failed
+static void ed_abort_complete(ohci_ed_t* p_ed)
+{
+  if ( !p_ed->aborting ) return;
+
+  uint8_t const dev_addr = p_ed->dev_addr;
+  uint8_t dropped = 0;
+  uint8_t dir = (p_ed->pid == PID_IN) ? 1 : 0;
+
+  if ( ed_is_pool(p_ed) )
+  {
+    dropped = ed_remove_all_td(p_ed);
+  }else
+  {
+    // control ED: its reserved TD is the only one that can be pending
+    ohci_gtd_t* gtd = &ohci_data.control[dev_addr].gtd;
+    if ( gtd->used && tu_align16(p_ed->td_head.address) == (uint32_t) gtd )
+    {
+      gtd->used = 0;
+      p_ed->td_head.address &= 0x0Ful;
+      dir = (gtd->pid == PID_IN) ? 1 : 0;
+      dropped = 1;
+    }
+  }
+
+  while ( dropped-- )
+  {
+    hcd_event_xfer_complete(dev_addr, tu_edpt_addr(p_ed->ep_number, dir), 0, XFER_RESULT_FAILED, true);
+  }
+
+  p_ed->skip     = p_ed->abort_skip;
+  p_ed->aborting = 0;
+}
+
+static void sof_abort_isr(void)
+{
+  // HC no longer processes skipped EDs after the next frame, and TDs it retired in that frame are written
+  // back to the done queue one frame later
+  if ( (uint16_t) (OHCI_REG->frame_number - ohci_data.abort_frame) < 2 ) return;
+
+  ohci_data.abort_pending = false;
+  OHCI_REG->interrupt_disable = OHCI_INT_SOF_MASK;
+
+  for(uint32_t i = 0; i < TU_ARRAY_SIZE(ohci_data.control); i++) ed_abort_complete(&ohci_data.control[i].ed);
+  for(uint32_t i = 0; i < ED_MAX; i++) ed_abort_complete(&ohci_data.ed_pool[i]);
+}
+
 
 //--------------------------------------------------------------------+
 // OHCI Interrupt Handler
@@ -559,7 +745,7 @@ static inline uint32_t gtd_xfer_byte_left(uint32_t buffer_end, uint32_t current_
       tu_offset4k(buffer_end) - tu_offset4k(current_buffer) + 1;
 }
 
-static void done_queue_isr(uint8_t hostid)
+static void done_queue_isr(uint8_t hostid, bool in_isr)
 {
   (void) hostid;
 
@@ -574,7 +760,21 @@ static void done_queue_isr(uint8_t hostid)
     xfer_result_t const event = (qtd->condition_code == OHCI_CCODE_NO_ERROR) ? XFER_RESULT_SUCCESS :
                                 (qtd->condition_code == OHCI_CCODE_STALL) ? XFER_RESULT_STALLED : XFER_RESULT_FAILED;
 
-    qtd->used = 0; // free TD
+    // next pointer is reused by free list
+    td_head = (ohci_td_item_t*) td_head->next;
+
+    // TD already released together with its ED by hcd_device_close()
+    if ( !qtd->used ) continue;
+
+    // free TD, control TD is reserved per device address
+    if ( gtd_is_control(qtd) )
+    {
+      qtd->used = 0;
+    }else
+    {
+      gtd_free(qtd);
+    }
+
     if ( (qtd->delay_interrupt == OHCI_INT_ON_COMPLETE_YES) || (event != XFER_RESULT_SUCCESS) )
     {
       ohci_ed_t * const ed  = gtd_get_ed(qtd);
@@ -588,19 +788,30 @@ static void done_queue_isr(uint8_t hostid)
       // --> HC will not process Control list (due to service ratio when Bulk list not empty)
       // To walk-around this, the halted ED will have TailP = HeadP (empty list condition), when clearing halt
       // the TailP must be set back to NULL for processing remaining TDs
+      // For pool ED, transfers queued behind the failed one are dropped (HeadP = TailP) and reported as failed.
+      uint8_t dropped = 0;
       if ((event != XFER_RESULT_SUCCESS))
       {
-        ed->td_tail &= 0x0Ful;
-        ed->td_tail |= tu_align16(ed->td_head.address); // mark halted EP as empty queue
+        if ( ed_is_pool(ed) )
+        {
+          dropped = ed_remove_all_td(ed);
+        }else
+        {
+          ed->td_tail &= 0x0Ful;
+          ed->td_tail |= tu_align16(ed->td_head.address); // mark halted EP as empty queue
+        }
         if ( event == XFER_RESULT_STALLED ) ed->is_stalled = 1;
       }
 
       uint8_t dir = (ed->ep_number == 0) ? (qtd->pid == PID_IN) : (ed->pid == PID_IN);
 
-      hcd_event_xfer_complete(ed->dev_addr, tu_edpt_addr(ed->ep_number, dir), xferred_bytes, event, true);
-    }
+      hcd_event_xfer_complete(ed->dev_addr, tu_edpt_addr(ed->ep_number, dir), xferred_bytes, event, in_isr);
 
-    td_head = (ohci_td_item_t*) td_head->next;
+      while ( dropped-- )
+      {
+        hcd_event_xfer_complete(ed->dev_addr, tu_edpt_addr(ed->ep_number, dir), 0, XFER_RESULT_FAILED, in_isr);
+      }
+    }
   }
 }
 
@@ -648,7 +859,13 @@ void hcd_int_handler(uint8_t hostid)
   //------------- Transfer Complete -------------//
   if (int_status & OHCI_INT_WRITEBACK_DONEHEAD_MASK)
   {
-    done_queue_isr(hostid);
+    done_queue_isr(hostid, true);
+  }
+
+  // need to place after done queue so that TDs retired before abort are reported first
+  if ( (int_status & OHCI_INT_SOF_MASK) && ohci_data.abort_pending )
+  {
+    sof_abort_isr();
   }
 
   OHCI_REG->interrupt_status = int_status; // Acknowledge handled interrupt
@@ -42,8 +42,13 @@ enum {
   OHCI_MAX_ITD = 4
 };
 
+// Number of TDs (each covers up to 8 KB) an endpoint can have queued for back-to-back transfers
+#ifndef CFG_TUH_OHCI_GTD_PER_EP
+  #define CFG_TUH_OHCI_GTD_PER_EP   (CFG_TUH_EDPT_XFER_QUEUE + 1)
+#endif
+
 #define ED_MAX       (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX)
-#define GTD_MAX      ED_MAX
+#define GTD_MAX      (ED_MAX*(CFG_TUH_OHCI_GTD_PER_EP+1)) // each pool ED also holds an empty tail TD
 
 //--------------------------------------------------------------------+
 // OHCI Data Structure
@@ -104,7 +109,8 @@ typedef struct TU_ATTR_ALIGNED(16)
 	uint32_t used              : 1;
 	uint32_t is_interrupt_xfer : 1;
 	uint32_t is_stalled        : 1;
-	uint32_t                   : 2;
+	uint32_t aborting          : 1; // skipped for abort, TDs are removed on a later SOF
+	uint32_t abort_skip        : 1; // skip bit to restore once abort is complete
 
 	// Word 1
 	uint32_t td_tail;
@@ -170,6 +176,10 @@ typedef struct TU_ATTR_ALIGNED(256)
 
   volatile uint16_t frame_number_hi;
 
+  // some ED is being aborted, frame number when the last abort was requested
+  volatile bool abort_pending;
+  uint16_t abort_frame;
+
 } ohci_data_t;
 
 //--------------------------------------------------------------------+
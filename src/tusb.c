@@ -30,6 +30,11 @@
 
 #include "tusb.h"
 #include "common/tusb_private.h"
+
+#if CFG_TUSB_LOCKFREE
+#include <stdatomic.h>
+TU_VERIFY_STATIC(sizeof(_Atomic uint8_t) == sizeof(uint8_t), "atomic endpoint state must fit in tu_edpt_state_t");
+#endif
 // TODO clean up
 #if CFG_TUD_ENABLED
 #include "device/usbd_pvt.h"
@@ -69,11 +74,59 @@ bool tusb_inited(void)
 // Internal Helper for both Host and Device stack
 //--------------------------------------------------------------------+
 
+#if CFG_TUSB_LOCKFREE
+
+bool tu_edpt_claim(tu_edpt_state_t* ep_state, osal_mutex_t mutex)
+{
+  (void) mutex;
+
+  volatile _Atomic uint8_t* state = (volatile _Atomic uint8_t*) &ep_state->value;
+  uint8_t expected = atomic_load_explicit(state, memory_order_relaxed);
+  uint8_t desired;
+
+  do
+  {
+    tu_edpt_state_t ep = { .value = expected };
+
+    // can only claim the endpoint if it is not busy and not claimed yet.
+    if ( ep.busy || ep.claimed ) return false;
+
+    ep.claimed = 1;
+    desired = ep.value;
+  } while ( !atomic_compare_exchange_weak_explicit(state, &expected, desired, memory_order_acq_rel, memory_order_relaxed) );
+
+  return true;
+}
+
+bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex)
+{
+  (void) mutex;
+
+  volatile _Atomic uint8_t* state = (volatile _Atomic uint8_t*) &ep_state->value;
+  uint8_t expected = atomic_load_explicit(state, memory_order_relaxed);
+  uint8_t desired;
+
+  do
+  {
+    tu_edpt_state_t ep = { .value = expected };
+
+    // can only release the endpoint if it is claimed and not busy
+    if ( !ep.claimed || ep.busy ) return false;
+
+    ep.claimed = 0;
+    desired = ep.value;
+  } while ( !atomic_compare_exchange_weak_explicit(state, &expected, desired, memory_order_acq_rel, memory_order_relaxed) );
+
+  return true;
+}
+
+#else
+
 bool tu_edpt_claim(tu_edpt_state_t* ep_state, osal_mutex_t mutex)
 {
   (void) mutex;
 
-#if TUSB_OPT_MUTEX
+#if OSAL_MUTEX_REQUIRED
   // pre-check to help reducing mutex lock
   TU_VERIFY((ep_state->busy == 0) && (ep_state->claimed == 0));
   osal_mutex_lock(mutex, OSAL_TIMEOUT_WAIT_FOREVER);
@@ -86,7 +139,7 @@ bool tu_edpt_claim(tu_edpt_state_t* ep_state, osal_mutex_t mutex)
     ep_state->claimed = 1;
   }
 
-#if TUSB_OPT_MUTEX
+#if OSAL_MUTEX_REQUIRED
   osal_mutex_unlock(mutex);
 #endif
 
@@ -97,7 +150,7 @@ bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex)
 {
   (void) mutex;
 
-#if TUSB_OPT_MUTEX
+#if OSAL_MUTEX_REQUIRED
   osal_mutex_lock(mutex, OSAL_TIMEOUT_WAIT_FOREVER);
 #endif
 
@@ -108,13 +161,15 @@ bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex)
     ep_state->claimed = 0;
   }
 
-#if TUSB_OPT_MUTEX
+#if OSAL_MUTEX_REQUIRED
   osal_mutex_unlock(mutex);
 #endif
 
   return ret;
 }
 
+#endif
+
 bool tu_edpt_validate(tusb_desc_endpoint_t const * desc_ep, tusb_speed_t speed)
 {
   uint16_t const max_packet_size = tu_edpt_packet_size(desc_ep);
@@ -56,6 +56,10 @@
     #include "class/cdc/cdc_host.h"
   #endif
 
+  #if CFG_TUH_NET
+    #include "class/net/net_host.h"
+  #endif
+
   #if CFG_TUH_VENDOR
     #include "class/vendor/vendor_host.h"
   #endif
@@ -94,6 +98,10 @@
     #include "class/vendor/vendor_device.h"
   #endif
 
+  #if CFG_TUD_ZERO
+    #include "class/zero/zero_device.h"
+  #endif
+
   #if CFG_TUD_USBTMC
     #include "class/usbtmc/usbtmc_device.h"
   #endif
@@ -176,6 +176,7 @@ typedef int make_iso_compilers_happy;
 #define OPT_OS_PICO       5  ///< Raspberry Pi Pico SDK
 #define OPT_OS_RTTHREAD   6  ///< RT-Thread
 #define OPT_OS_RTX4       7  ///< Keil RTX 4
+#define OPT_OS_POSIX      8  ///< POSIX threads e.g Linux
 
 // Allow to use command line to change the config name/location
 #ifdef CFG_TUSB_CONFIG_FILE
@@ -303,6 +304,18 @@ typedef int make_iso_compilers_happy;
   #define CFG_TUSB_OS_INC_PATH
 #endif
 
+// Use C11 atomics instead of locks: usbd/usbh event queue becomes a lock-free multi-producer single-consumer
+// ring and endpoint claim/release use compare-and-swap. Useful on multi-core MCUs where USB ISR and
+// usb task run on different cores. Requires <stdatomic.h> and event queue depth to be power of two.
+#ifndef CFG_TUSB_LOCKFREE
+  #define CFG_TUSB_LOCKFREE       0
+#endif
+
+// Use 32-bit read/write index for tu_fifo, lifting maximum depth from 2^15 to 2^31 items
+#ifndef CFG_TUSB_FIFO_INDEX_32BIT
+  #define CFG_TUSB_FIFO_INDEX_32BIT   0
+#endif
+
 //--------------------------------------------------------------------
 // Device Options (Default)
 //--------------------------------------------------------------------
@@ -311,6 +324,23 @@ typedef int make_iso_compilers_happy;
   #define CFG_TUD_ENDPOINT0_SIZE  64
 #endif
 
+// Transfer control data stage larger than CFG_TUD_ENDPOINT0_SIZE directly from/to application
+// buffer without copying to the internal endpoint0 buffer. Opt-in: DCD must support it
+// (TUP_DCD_EDPT0_ZERO_COPY) and such buffers must stay valid until the control transfer completes.
+#ifndef CFG_TUD_EDPT0_ZERO_COPY
+  #define CFG_TUD_EDPT0_ZERO_COPY 0
+#endif
+
+#if CFG_TUD_EDPT0_ZERO_COPY && !TUP_DCD_EDPT0_ZERO_COPY
+  #error "CFG_TUD_EDPT0_ZERO_COPY is not supported by this MCU's DCD"
+#endif
+
+// Number of transfers that can be queued on a non-control endpoint behind the active one.
+// Queued transfers are handed to DCD on completion of the previous one in ISR context.
+#ifndef CFG_TUD_EDPT_XFER_QUEUE
+  #define CFG_TUD_EDPT_XFER_QUEUE 0
+#endif
+
 #ifndef CFG_TUD_INTERFACE_MAX
   #define CFG_TUD_INTERFACE_MAX   16
 #endif
@@ -343,6 +373,10 @@ typedef int make_iso_compilers_happy;
   #define CFG_TUD_VENDOR          0
 #endif
 
+#ifndef CFG_TUD_ZERO
+  #define CFG_TUD_ZERO            0
+#endif
+
 #ifndef CFG_TUD_USBTMC
   #define CFG_TUD_USBTMC          0
 #endif
@@ -407,6 +441,10 @@ typedef int make_iso_compilers_happy;
 #define CFG_TUH_MSC    0
 #endif
 
+#ifndef CFG_TUH_NET
+#define CFG_TUH_NET    0
+#endif
+
 #ifndef CFG_TUH_VENDOR
 #define CFG_TUH_VENDOR 0
 #endif
@@ -415,6 +453,19 @@ typedef int make_iso_compilers_happy;
 #define CFG_TUH_API_EDPT_XFER 0
 #endif
 
+// Number of transfers that can be queued on a non-control endpoint behind the active one.
+// Class drivers and tuh_edpt_xfer() can then keep an endpoint primed without gap between transfers.
+#ifndef CFG_TUH_EDPT_XFER_QUEUE
+#define CFG_TUH_EDPT_XFER_QUEUE 0
+#endif
+
+// Timeout in milliseconds of control transfer with tuh_xfer_t.timeout_ms = 0, 0 is no timeout (default).
+// Transfer is aborted and completed with XFER_RESULT_TIMEOUT, usb 2.0 spec 9.2.6.4 allows up to 5 seconds
+// e.g 5000 to recover from devices that never answer. Timeouts only apply if HCD implements hcd_edpt_abort_xfer().
+#ifndef CFG_TUH_CONTROL_TIMEOUT_MS
+#define CFG_TUH_CONTROL_TIMEOUT_MS 0
+#endif
+
 // Enable PIO-USB software host controller
 #ifndef CFG_TUH_RPI_PIO_USB
 #define CFG_TUH_RPI_PIO_USB 0
@@ -432,6 +483,10 @@ typedef int make_iso_compilers_happy;
   #error Control Endpoint Max Packet Size cannot be larger than 64
 #endif
 
+#if TUP_DCD_EDPT0_XFER_MAX % CFG_TUD_ENDPOINT0_SIZE
+  #error TUP_DCD_EDPT0_XFER_MAX must be multiple of Control Endpoint Max Packet Size
+#endif
+
 #endif /* _TUSB_OPTION_H_ */
 
 /** @} */
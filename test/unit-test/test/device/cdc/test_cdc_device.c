@@ -0,0 +1,333 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "usbd.h"
+TEST_FILE("usbd_control.c")
+TEST_FILE("cdc_device.c")
+
+// Mock File
+#include "mock_dcd.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum
+{
+  EDPT_CDC_NOTIF = 0x81,
+  EDPT_CDC_OUT   = 0x02,
+  EDPT_CDC_IN    = 0x82,
+};
+
+uint8_t const rhport = 0;
+
+enum
+{
+  ITF_NUM_CDC,
+  ITF_NUM_CDC_DATA,
+  ITF_NUM_TOTAL
+};
+
+#define CONFIG_TOTAL_LEN    (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN)
+
+uint8_t const data_desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0, 100),
+
+  // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
+  TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, 0, EDPT_CDC_NOTIF, 8, EDPT_CDC_OUT, EDPT_CDC_IN, 64),
+};
+
+tusb_control_request_t const request_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest      = TUSB_REQ_SET_CONFIGURATION,
+  .wValue        = 1,
+  .wIndex        = 0,
+  .wLength       = 0
+};
+
+//--------------------------------------------------------------------+
+// Simulated host OUT transfers
+//--------------------------------------------------------------------+
+
+// pending OUT transfer prepared by the driver, either into rx_ff or into a buffer
+static tu_fifo_t* out_ff;
+static uint8_t*   out_buf;
+static uint16_t   out_len;
+
+static bool stub_edpt_xfer(uint8_t port, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes, int num_calls)
+{
+  (void) port; (void) num_calls;
+
+  if ( ep_addr == EDPT_CDC_OUT )
+  {
+    out_ff  = NULL;
+    out_buf = buffer;
+    out_len = total_bytes;
+  }
+
+  return true;
+}
+
+static bool stub_edpt_xfer_fifo(uint8_t port, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes, int num_calls)
+{
+  (void) port; (void) num_calls;
+
+  if ( ep_addr == EDPT_CDC_OUT )
+  {
+    // transfer must fit into linear part of fifo
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_write_info(ff, &info);
+    TEST_ASSERT_TRUE(total_bytes <= info.len_lin);
+
+    out_ff  = ff;
+    out_buf = NULL;
+    out_len = total_bytes;
+  }
+
+  return true;
+}
+
+// host sends one short packet
+static void host_send(void const* data, uint16_t len)
+{
+  TEST_ASSERT_TRUE(len <= out_len);
+
+  if ( out_ff )
+  {
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_write_info(out_ff, &info);
+    memcpy(info.ptr_lin, data, len);
+    tu_fifo_advance_write_pointer(out_ff, len);
+  }else
+  {
+    memcpy(out_buf, data, len);
+  }
+
+  out_len = 0;
+
+  dcd_event_xfer_complete(rhport, EDPT_CDC_OUT, len, XFER_RESULT_SUCCESS, false);
+  tud_task();
+}
+
+static void host_send_str(char const* str)
+{
+  host_send(str, (uint16_t) strlen(str));
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return NULL;
+}
+
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  (void) index;
+  return data_desc_configuration;
+}
+
+uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+  (void) index;
+  (void) langid;
+
+  return NULL;
+}
+
+void setUp(void)
+{
+  dcd_int_disable_Ignore();
+  dcd_int_enable_Ignore();
+
+  if ( !tusb_inited() )
+  {
+    dcd_init_Expect(rhport);
+    tusb_init();
+  }
+
+  dcd_edpt_open_IgnoreAndReturn(true);
+  dcd_edpt_xfer_StubWithCallback(stub_edpt_xfer);
+  dcd_edpt_xfer_fifo_StubWithCallback(stub_edpt_xfer_fifo);
+
+  out_ff  = NULL;
+  out_buf = NULL;
+  out_len = 0;
+
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, false);
+  tud_task();
+
+  // open interfaces, driver prepares first OUT transfer
+  dcd_event_setup_received(rhport, (uint8_t const*) &request_set_configuration, false);
+  tud_task();
+
+  TEST_ASSERT_TRUE(tud_mounted());
+  TEST_ASSERT_EQUAL(64*2, out_len);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Framed receive
+//--------------------------------------------------------------------+
+void test_record_split_across_transfers(void)
+{
+  uint8_t buf[32];
+
+  TEST_ASSERT_TRUE(tud_cdc_set_rx_framing(CDC_RX_FRAMING_DELIMITER, '\n'));
+
+  host_send_str("hel");
+  TEST_ASSERT_EQUAL(0, tud_cdc_record_count());
+
+  host_send_str("lo\nwo");
+  TEST_ASSERT_EQUAL(1, tud_cdc_record_count());
+
+  host_send_str("rld\n");
+  TEST_ASSERT_EQUAL(2, tud_cdc_record_count());
+
+  TEST_ASSERT_EQUAL(6, tud_cdc_read_record(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL_MEMORY("hello\n", buf, 6);
+
+  TEST_ASSERT_EQUAL(6, tud_cdc_read_record(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL_MEMORY("world\n", buf, 6);
+
+  TEST_ASSERT_EQUAL(0, tud_cdc_read_record(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(0, tud_cdc_available());
+}
+
+void test_record_oversized(void)
+{
+  uint8_t buf[CFG_TUD_CDC_RX_BUFSIZE + 8];
+
+  TEST_ASSERT_TRUE(tud_cdc_set_rx_framing(CDC_RX_FRAMING_DELIMITER, '\n'));
+
+  // record larger than application buffer: rest of it is dropped
+  host_send_str("0123456789\nAB\n");
+  TEST_ASSERT_EQUAL(2, tud_cdc_record_count());
+
+  TEST_ASSERT_EQUAL(4, tud_cdc_read_record(buf, 4));
+  TEST_ASSERT_EQUAL_MEMORY("0123", buf, 4);
+
+  TEST_ASSERT_EQUAL(3, tud_cdc_read_record(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL_MEMORY("AB\n", buf, 3);
+  TEST_ASSERT_EQUAL(0, tud_cdc_available());
+
+  // record without delimiter filling whole rx fifo is split
+  uint8_t data[64];
+  memset(data, 'x', sizeof(data));
+
+  host_send(data, sizeof(data));
+  host_send(data, sizeof(data));
+  TEST_ASSERT_EQUAL(1, tud_cdc_record_count());
+
+  TEST_ASSERT_EQUAL(CFG_TUD_CDC_RX_BUFSIZE, tud_cdc_read_record(buf, sizeof(buf)));
+  TEST_ASSERT_EACH_EQUAL_UINT8('x', buf, CFG_TUD_CDC_RX_BUFSIZE);
+  TEST_ASSERT_EQUAL(0, tud_cdc_available());
+
+  // length prefixed record larger than application buffer
+  TEST_ASSERT_TRUE(tud_cdc_set_rx_framing(CDC_RX_FRAMING_LENGTH16, 0));
+
+  host_send("\x05\x00" "abcde" "\x01\x00" "z", 10);
+  TEST_ASSERT_EQUAL(2, tud_cdc_record_count());
+
+  TEST_ASSERT_EQUAL(2, tud_cdc_read_record(buf, 2));
+  TEST_ASSERT_EQUAL_MEMORY("ab", buf, 2);
+
+  TEST_ASSERT_EQUAL(1, tud_cdc_read_record(buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL('z', buf[0]);
+  TEST_ASSERT_EQUAL(0, tud_cdc_available());
+}
+
+void test_record_wrap_fifo(void)
+{
+  uint8_t buf[32];
+  char rec[] = "record-00-abcdefghij\n";
+  uint16_t const rec_len = (uint16_t) strlen(rec);
+
+  TEST_ASSERT_TRUE(tud_cdc_set_rx_framing(CDC_RX_FRAMING_DELIMITER, '\n'));
+
+  // records are read back one by one while fifo wraps several times
+  for ( uint8_t i = 0; i < 20; i++ )
+  {
+    rec[7] = (char) ('0' + i / 10);
+    rec[8] = (char) ('0' + i % 10);
+
+    host_send(rec, rec_len);
+    TEST_ASSERT_EQUAL(1, tud_cdc_record_count());
+
+    TEST_ASSERT_EQUAL(rec_len, tud_cdc_read_record(buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_MEMORY(rec, buf, rec_len);
+  }
+
+  TEST_ASSERT_EQUAL(0, tud_cdc_available());
+}
+
+void test_record_wrap_fifo_untracked(void)
+{
+  uint8_t buf[64];
+
+  TEST_ASSERT_TRUE(tud_cdc_set_rx_framing(CDC_RX_FRAMING_DELIMITER, '\n'));
+
+  // move fifo pointers 10 bytes before end of buffer
+  uint8_t data[59];
+  memset(data, '.', sizeof(data));
+  data[sizeof(data)-1] = '\n';
+
+  for ( uint8_t i = 0; i < 2; i++ )
+  {
+    host_send(data, sizeof(data));
+    TEST_ASSERT_EQUAL(sizeof(data), tud_cdc_read_record(buf, sizeof(buf)));
+  }
+
+  // more records than tracked lengths (CFG_TUD_CDC_RX_RECORD_MAX), first untracked one wraps at end of fifo
+  host_send_str("a\nb\nc\nd\neeeee\nffffff\n");
+  TEST_ASSERT_EQUAL(6, tud_cdc_record_count());
+
+  char const* expected[] = { "a\n", "b\n", "c\n", "d\n", "eeeee\n", "ffffff\n" };
+
+  for ( uint8_t i = 0; i < TU_ARRAY_SIZE(expected); i++ )
+  {
+    uint32_t const len = strlen(expected[i]);
+    TEST_ASSERT_EQUAL(len, tud_cdc_read_record(buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_MEMORY(expected[i], buf, len);
+  }
+
+  TEST_ASSERT_EQUAL(0, tud_cdc_record_count());
+  TEST_ASSERT_EQUAL(0, tud_cdc_available());
+}
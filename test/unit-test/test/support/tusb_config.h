@@ -78,7 +78,9 @@
 
 //------------- CLASS -------------//
 //#define CFG_TUD_CDC              0
+#ifndef CFG_TUD_MSC
 #define CFG_TUD_MSC              1
+#endif
 //#define CFG_TUD_HID              0
 //#define CFG_TUD_MIDI             0
 //#define CFG_TUD_VENDOR           0
@@ -86,8 +88,24 @@
 //------------- CDC -------------//
 
 // FIFO size of CDC TX and RX
+#ifndef CFG_TUD_CDC_RX_BUFSIZE
 #define CFG_TUD_CDC_RX_BUFSIZE   512
+#endif
+
+#ifndef CFG_TUD_CDC_TX_BUFSIZE
 #define CFG_TUD_CDC_TX_BUFSIZE   512
+#endif
+
+//------------- VENDOR -------------//
+
+// FIFO size of VENDOR TX and RX
+#ifndef CFG_TUD_VENDOR_RX_BUFSIZE
+#define CFG_TUD_VENDOR_RX_BUFSIZE   64
+#endif
+
+#ifndef CFG_TUD_VENDOR_TX_BUFSIZE
+#define CFG_TUD_VENDOR_TX_BUFSIZE   64
+#endif
 
 //------------- MSC -------------//
 
@@ -318,3 +318,185 @@ void test_rd_idx_wrap()
   TEST_ASSERT_EQUAL(n, 2);
   TEST_ASSERT_EQUAL(ff10.rd_idx, 6);
 }
+
+void test_write_reserve_commit(void)
+{
+  uint8_t data[FIFO_SIZE];
+  for(uint8_t i=0; i < FIFO_SIZE; i++) data[i] = i;
+
+  void* p_buf;
+  uint16_t n;
+
+  // reserve is limited to linear space until end of buffer
+  tu_fifo_write_n(ff, data, 4);
+  tu_fifo_read_n(ff, data, 4);
+
+  n = tu_fifo_write_reserve(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(FIFO_SIZE-4, n);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer + 4, p_buf);
+
+  // nothing is visible before commit
+  memcpy(p_buf, data, 3);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+  tu_fifo_write_commit(ff, 3);
+  TEST_ASSERT_EQUAL(3, tu_fifo_count(ff));
+
+  // continue to end of buffer then wrap
+  n = tu_fifo_write_reserve(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(3, n);
+  tu_fifo_write_commit(ff, n);
+
+  n = tu_fifo_write_reserve(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(4, n);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer, p_buf);
+  tu_fifo_write_commit(ff, n);
+
+  // full
+  n = tu_fifo_write_reserve(ff, &p_buf, 1);
+  TEST_ASSERT_EQUAL(0, n);
+  tu_fifo_write_commit(ff, 0);
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+}
+
+void test_read_peek_release(void)
+{
+  uint8_t data[FIFO_SIZE];
+  for(uint8_t i=0; i < FIFO_SIZE; i++) data[i] = i;
+
+  void const* p_buf;
+  uint16_t n;
+
+  // empty
+  n = tu_fifo_read_peek_linear(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(0, n);
+  tu_fifo_read_release(ff, 0);
+
+  // wrapped content: 6..9 at end of buffer, 0..1 at start
+  tu_fifo_write_n(ff, data, 6);
+  tu_fifo_read_n(ff, data, 6);
+  for(uint8_t i=0; i < FIFO_SIZE; i++) data[i] = (uint8_t) (i+6);
+  tu_fifo_write_n(ff, data, 6);
+
+  n = tu_fifo_read_peek_linear(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(4, n);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer + 6, p_buf);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, p_buf, n);
+
+  // partial release keeps the rest
+  tu_fifo_read_release(ff, 1);
+  TEST_ASSERT_EQUAL(5, tu_fifo_count(ff));
+
+  n = tu_fifo_read_peek_linear(ff, &p_buf, 2);
+  TEST_ASSERT_EQUAL(2, n);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data+1, p_buf, n);
+  tu_fifo_read_release(ff, n);
+  TEST_ASSERT_EQUAL(3, tu_fifo_count(ff));
+
+  // last item before end of buffer
+  n = tu_fifo_read_peek_linear(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(1, n);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer + 9, p_buf);
+  TEST_ASSERT_EQUAL(data[3], *(uint8_t const*) p_buf);
+  tu_fifo_read_release(ff, n);
+
+  n = tu_fifo_read_peek_linear(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(2, n);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer, p_buf);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data+4, p_buf, n);
+  tu_fifo_read_release(ff, n);
+
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_read_peek_release_wrapped(void)
+{
+  uint8_t data[FIFO_SIZE];
+  void const* p_buf;
+  uint16_t n;
+
+  // full fifo wrapped at 7: 7..9 at end of buffer, 0..6 at start
+  for(uint8_t i=0; i < 7; i++) tu_fifo_write(ff, &i);
+  tu_fifo_read_n(ff, data, 7);
+  for(uint8_t i=0; i < FIFO_SIZE; i++) data[i] = (uint8_t) (0x10+i);
+  tu_fifo_write_n(ff, data, FIFO_SIZE);
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+
+  // peek is limited to end of buffer even when more is requested
+  n = tu_fifo_read_peek_linear(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(3, n);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer + 7, p_buf);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, p_buf, n);
+
+  // nothing consumed: same view on next peek
+  tu_fifo_read_release(ff, 0);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_count(ff));
+
+  n = tu_fifo_read_peek_linear(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(3, n);
+  tu_fifo_read_release(ff, n);
+  TEST_ASSERT_EQUAL(7, tu_fifo_count(ff));
+
+  // read pointer wrapped to start of buffer
+  n = tu_fifo_read_peek_linear(ff, &p_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(7, n);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer, p_buf);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data+3, p_buf, n);
+  tu_fifo_read_release(ff, n);
+
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+
+  // writer can fill again after release across the wrap
+  tu_fifo_write_n(ff, data, FIFO_SIZE);
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+}
+
+void test_discard_n(void)
+{
+  uint8_t data[FIFO_SIZE];
+  for(uint8_t i=0; i < FIFO_SIZE; i++) data[i] = i;
+
+  // empty
+  TEST_ASSERT_EQUAL(0, tu_fifo_discard_n(ff, 3));
+
+  tu_fifo_write_n(ff, data, 8);
+  TEST_ASSERT_EQUAL(3, tu_fifo_discard_n(ff, 3));
+  TEST_ASSERT_EQUAL(5, tu_fifo_count(ff));
+
+  // wrapped content, remaining data is not touched
+  tu_fifo_write_n(ff, data, 5);
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+  TEST_ASSERT_EQUAL(7, tu_fifo_discard_n(ff, 7));
+
+  uint8_t rd_buf[FIFO_SIZE];
+  TEST_ASSERT_EQUAL(3, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data+2, rd_buf, 3);
+
+  // limited to available items
+  tu_fifo_write_n(ff, data, 4);
+  TEST_ASSERT_EQUAL(4, tu_fifo_discard_n(ff, FIFO_SIZE));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_config_depth_max(void)
+{
+  tu_fifo_t ff_deep;
+
+  // buffer is not accessed by config
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff_deep, NULL, 0x8000, 1, false));
+
+#if CFG_TUSB_FIFO_INDEX_32BIT
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff_deep, NULL, 0x30000, 1, false));
+
+  // index space and overflow detection beyond 16-bit
+  ff_deep.wr_idx = 0x30000 + 5;
+  ff_deep.rd_idx = 0x30000 - 5;
+  TEST_ASSERT_EQUAL(10, tu_fifo_count(&ff_deep));
+  TEST_ASSERT_FALSE(tu_fifo_overflowed(&ff_deep));
+
+  ff_deep.wr_idx = 5;
+  ff_deep.rd_idx = 0x30000 - 5;
+  TEST_ASSERT_TRUE(tu_fifo_overflowed(&ff_deep));
+#else
+  TEST_ASSERT_FALSE(tu_fifo_config(&ff_deep, NULL, 0x8001, 1, false));
+#endif
+}